@@ -1,10 +1,10 @@
 @echo off
 echo Building server...
-gcc -Wall -Wextra -O2 -o server.exe server.c monocypher.c siete.c crypto_utils.c platform.c -lws2_32 -lbcrypt
+gcc -Wall -Wextra -O2 -DMONOCYPHER_THREADS -o server.exe server.c monocypher.c siete.c crypto_utils.c platform.c pipeline.c -lws2_32 -lbcrypt -lpthread
 if %ERRORLEVEL% neq 0 goto error
 
 echo Building client...
-gcc -Wall -Wextra -O2 -o client.exe client.c monocypher.c siete.c crypto_utils.c platform.c -lws2_32 -lbcrypt
+gcc -Wall -Wextra -O2 -DMONOCYPHER_THREADS -o client.exe client.c monocypher.c siete.c crypto_utils.c platform.c pipeline.c -lws2_32 -lbcrypt -lpthread
 if %ERRORLEVEL% neq 0 goto error
 
 echo Build successful!
@@ -25,12 +25,14 @@
 #include <stdlib.h> // Kniznica pre vseobecne funkcie (sprava pamate, konverzie, nahodne cisla)
 #include <string.h> // Kniznica pre pracu s retazcami (kopirovanie, porovnavanie, spajanie)
 #include <unistd.h> // Kniznica pre systemove volania UNIX (procesy, subory, sokety)
+#include <pthread.h> // Kniznica pre vlakna (pipeline prenosu)
 
 #include "monocypher.h"   // Pre Monocypher kryptograficke funkcie
 #include "siete.h"        // Pre sietove funkcie
 #include "constants.h"    // Shared constants
 #include "crypto_utils.h" // Pre kryptograficke funkcie
 #include "platform.h"     // Pre funkcie specificke pre operacny system
+#include "pipeline.h"     // Pre fronty pipeline prenosu
 
 // Globalne premenne pre kryptograficke operacie
 // Tieto premenne sa pouzivaju v celom programe pre sifrovacie operacie
@@ -81,6 +83,330 @@ char *getpass(const char *prompt)
 }
 #endif
 
+// Pipeline odosielania suboru
+// Citac cita okna blokov, pocita kontrolny sucet a urcuje kluc kazdeho okna,
+// sifrovacie vlakna sifruju okna paralelne a hlavne vlakno ich odosiela v poradi
+// Okno n ide vzdy vlaknu n % workers a odosielatel ich vybera v rovnakom poradi,
+// takze vsetky fronty maju jedneho producenta a jedneho konzumenta a poradie na sieti sa zachova
+
+// Okno v obehu pipeline
+typedef struct
+{
+    chunk_window window;                 // Bloky okna (citac ich naplni, vlakno zasifruje na mieste)
+    crypto_aead_ctx stream;              // Prudovy kontext na zaciatku okna (prudovy rezim)
+    uint8_t key[SESSION_KEY_SIZE];       // Relacny kluc okna (rezim s nonce)
+    uint8_t rotation_nonce[NONCE_SIZE];  // Nonce rotacie kluca pred oknom
+    uint8_t validation[VALIDATION_SIZE]; // Validacia noveho kluca pre server
+    uint64_t first_block;                // Poradove cislo prveho bloku okna
+    int rotate;                          // Pred oknom sa vykona rotacia kluca
+    int last;                            // Koniec suboru (prazdne okno)
+} send_item;
+
+typedef struct send_pipeline send_pipeline;
+
+typedef struct
+{
+    send_pipeline *pipeline;
+    int index;
+    pthread_t thread;
+    pipeline_signal signal; // Citac oznami nove okno vo fronte vlakna
+} send_worker;
+
+struct send_pipeline
+{
+    FILE *file;
+    file_digest_ctx *digest;
+    uint8_t *session_key;     // Aktualny relacny kluc (citac ho rotuje)
+    crypto_aead_ctx *stream;  // Aktualny prudovy kontext, NULL v rezime s nonce
+    uint64_t rotation_blocks; // Pocet blokov medzi rotaciami kluca
+    send_item *items;
+    int item_count;
+    int workers;
+    int stop; // Priznak zastavenia vsetkych vlakien pipeline
+    spsc_queue free_items;                       // Odosielatel -> citac (prazdne okna)
+    spsc_queue work[PIPELINE_MAX_WORKERS];       // Citac -> sifrovacie vlakno
+    spsc_queue done[PIPELINE_MAX_WORKERS];       // Sifrovacie vlakno -> odosielatel
+    send_worker worker_threads[PIPELINE_MAX_WORKERS];
+    pthread_t reader_thread;
+    pipeline_signal reader_signal; // Odosielatel vratil prazdne okno
+    pipeline_signal sender_signal; // Sifrovacie vlakno dokoncilo okno
+};
+
+// Citac: jedine vlakno, ktore meni kluc a prudovy kontext, takze plan klucov je rovnaky ako pri
+// postupnom sifrovani - okno dostane kopiu kontextu a citac ho posunie o pocet blokov okna
+// Okno nikdy nepresahuje hranicu rotacie kluca, vsetky jeho bloky maju rovnaky kluc
+static void *send_pipeline_reader(void *arg)
+{
+    send_pipeline *pipeline = arg;
+    uint64_t block_count = 0;
+    uint64_t sequence = 0;
+
+    for (;;)
+    {
+        send_item *item = spsc_queue_pop_wait(&pipeline->free_items, &pipeline->reader_signal, &pipeline->stop);
+        if (item == NULL)
+        {
+            break;
+        }
+
+        size_t window_limit = pipeline->rotation_blocks - block_count % pipeline->rotation_blocks;
+        if (window_limit > AEAD_WINDOW_CHUNKS)
+        {
+            window_limit = AEAD_WINDOW_CHUNKS;
+        }
+
+        chunk_window *window = &item->window;
+        size_t bytes_read;
+        window->count = 0;
+        while (window->count < window_limit &&
+               (bytes_read = fread(window->data[window->count], 1, window->chunk_size, pipeline->file)) > 0)
+        {
+            file_digest_update(pipeline->digest, window->data[window->count], bytes_read);
+            window->sizes[window->count++] = bytes_read;
+        }
+
+        item->first_block = block_count;
+        item->last = (window->count == 0);
+        item->rotate = 0;
+
+        // Rotacia kluca po kazdych rotation_blocks blokoch
+        // Novy kluc sa pripravi tu, odosielatel vykona vymenu so serverom pred odoslanim okna
+        if (!item->last && block_count > 0 && block_count % pipeline->rotation_blocks == 0)
+        {
+            uint8_t previous_key[KEY_SIZE];
+            generate_random_bytes(item->rotation_nonce, NONCE_SIZE);
+            memcpy(previous_key, pipeline->session_key, KEY_SIZE);
+            rotate_key(pipeline->session_key, previous_key, item->rotation_nonce);
+            secure_wipe(previous_key, KEY_SIZE);
+
+            // Prudovy kontext pokracuje s novym klucom a rotacnym nonce
+            if (pipeline->stream != NULL)
+            {
+                crypto_aead_init_x(pipeline->stream, pipeline->session_key, item->rotation_nonce);
+            }
+            generate_key_validation(item->validation, pipeline->session_key);
+            item->rotate = 1;
+        }
+
+        memcpy(item->key, pipeline->session_key, SESSION_KEY_SIZE);
+        if (pipeline->stream != NULL)
+        {
+            item->stream = *pipeline->stream;
+            aead_stream_skip(pipeline->stream, window->count);
+        }
+        block_count += window->count;
+
+        // Fronty maju miesto pre vsetky okna, vlozenie nezlyha
+        send_worker *worker = &pipeline->worker_threads[sequence++ % pipeline->workers];
+        spsc_queue_push(&pipeline->work[worker->index], item);
+        pipeline_notify(&worker->signal);
+        if (item->last)
+        {
+            break;
+        }
+    }
+    return NULL;
+}
+
+// Sifrovacie vlakno: zasifruje okno na mieste a preda ho odosielatelovi
+static void *send_pipeline_worker(void *arg)
+{
+    send_worker *worker = arg;
+    send_pipeline *pipeline = worker->pipeline;
+
+    for (;;)
+    {
+        send_item *item = spsc_queue_pop_wait(&pipeline->work[worker->index], &worker->signal, &pipeline->stop);
+        if (item == NULL)
+        {
+            break;
+        }
+        if (!item->last)
+        {
+            // Kazdy blok ma vlastny nahodny nonce a overovaci kod (tag), alebo pokracuje kopia prudoveho kontextu
+            chunk_window_lock(&item->window, item->key, pipeline->stream != NULL ? &item->stream : NULL);
+        }
+        spsc_queue_push(&pipeline->done[worker->index], item);
+        pipeline_notify(&pipeline->sender_signal);
+        if (item->last)
+        {
+            break;
+        }
+    }
+    return NULL;
+}
+
+// Zastavi vsetky vlakna pipeline, pocka na ne a uvolni pamat
+// Po navrate su kluc a prudovy kontext v stave po poslednom precitanom okne
+static void send_pipeline_destroy(send_pipeline *pipeline, int reader_started, int workers_started)
+{
+    pipeline_stop(&pipeline->stop);
+    pipeline_notify(&pipeline->reader_signal);
+    for (int i = 0; i < workers_started; i++)
+    {
+        pipeline_notify(&pipeline->worker_threads[i].signal);
+    }
+    if (reader_started)
+    {
+        pthread_join(pipeline->reader_thread, NULL);
+    }
+    for (int i = 0; i < workers_started; i++)
+    {
+        pthread_join(pipeline->worker_threads[i].thread, NULL);
+    }
+    for (int i = 0; i < pipeline->workers; i++)
+    {
+        spsc_queue_free(&pipeline->work[i]);
+        spsc_queue_free(&pipeline->done[i]);
+        pipeline_signal_destroy(&pipeline->worker_threads[i].signal);
+    }
+    spsc_queue_free(&pipeline->free_items);
+    pipeline_signal_destroy(&pipeline->reader_signal);
+    pipeline_signal_destroy(&pipeline->sender_signal);
+    if (pipeline->items != NULL)
+    {
+        for (int i = 0; i < pipeline->item_count; i++)
+        {
+            chunk_window_free(&pipeline->items[i].window);
+        }
+        secure_wipe(pipeline->items, pipeline->item_count * sizeof(send_item));
+        free(pipeline->items);
+        pipeline->items = NULL;
+    }
+}
+
+// Alokuje okna a fronty a spusti citac a sifrovacie vlakna
+// Pocet okien v obehu je ohraniceny, citac caka na volne okno (spatny tlak od siete)
+// Vracia -1 ak sa pipeline nepodarilo spustit (vsetko je uz uvolnene)
+static int send_pipeline_start(send_pipeline *pipeline, FILE *file, file_digest_ctx *digest,
+                               uint8_t *session_key, crypto_aead_ctx *stream,
+                               uint64_t rotation_blocks, uint32_t chunk_size)
+{
+    memset(pipeline, 0, sizeof(*pipeline));
+    pipeline->file = file;
+    pipeline->digest = digest;
+    pipeline->session_key = session_key;
+    pipeline->stream = stream;
+    pipeline->rotation_blocks = rotation_blocks;
+    pipeline->workers = pipeline_worker_count();
+    pipeline->item_count = pipeline->workers * PIPELINE_WINDOWS_PER_WORKER + 2;
+
+    // Signaly sa inicializuju vsetky vopred, send_pipeline_destroy ich potom moze zrusit bez podmienok
+    pipeline_signal_init(&pipeline->reader_signal);
+    pipeline_signal_init(&pipeline->sender_signal);
+    for (int i = 0; i < pipeline->workers; i++)
+    {
+        pipeline_signal_init(&pipeline->worker_threads[i].signal);
+    }
+
+    int ok = spsc_queue_init(&pipeline->free_items, pipeline->item_count) == 0;
+    for (int i = 0; ok && i < pipeline->workers; i++)
+    {
+        ok = spsc_queue_init(&pipeline->work[i], pipeline->item_count) == 0 &&
+             spsc_queue_init(&pipeline->done[i], pipeline->item_count) == 0;
+    }
+    if (ok)
+    {
+        pipeline->items = calloc(pipeline->item_count, sizeof(send_item));
+        ok = pipeline->items != NULL;
+        if (!ok)
+        {
+            fprintf(stderr, ERR_PIPELINE_MEMORY);
+        }
+    }
+    for (int i = 0; ok && i < pipeline->item_count; i++)
+    {
+        ok = chunk_window_init(&pipeline->items[i].window, chunk_size, AEAD_WINDOW_CHUNKS) == 0 &&
+             spsc_queue_push(&pipeline->free_items, &pipeline->items[i]) == 0;
+    }
+    if (!ok)
+    {
+        send_pipeline_destroy(pipeline, 0, 0);
+        return -1;
+    }
+
+    int workers_started = 0;
+    for (; workers_started < pipeline->workers; workers_started++)
+    {
+        send_worker *worker = &pipeline->worker_threads[workers_started];
+        worker->pipeline = pipeline;
+        worker->index = workers_started;
+        if (pthread_create(&worker->thread, NULL, send_pipeline_worker, worker) != 0)
+        {
+            break;
+        }
+    }
+    if (workers_started < pipeline->workers ||
+        pthread_create(&pipeline->reader_thread, NULL, send_pipeline_reader, pipeline) != 0)
+    {
+        fprintf(stderr, ERR_PIPELINE_THREAD);
+        send_pipeline_destroy(pipeline, 0, workers_started);
+        return -1;
+    }
+
+    printf(LOG_PIPELINE, pipeline->workers, "encrypt", pipeline->item_count);
+    return 0;
+}
+
+// Rotacia kluca so serverom pred oknom, ktore uz je zasifrovane novym klucom
+// Rotacia kluca zvysuje bezpecnost komunikacie tym, ze obmedzuje mnozstvo dat sifrovanych jednym klucom
+static int send_key_rotation(int sock, const send_item *item)
+{
+    printf(MSG_KEY_ROTATION, (unsigned long long)item->first_block);
+
+    // Signalizacia rotacie kluca serveru
+    if (send_chunk_size_reliable(sock, KEY_ROTATION_MARKER) < 0)
+    {
+        fprintf(stderr, ERR_KEY_ROTATION_ACK);
+        return -1;
+    }
+
+    // Cakanie na potvrdenie od servera
+    uint32_t ack;
+    if (receive_chunk_size_reliable(sock, &ack, 0) < 0 || ack != KEY_ROTATION_ACK)
+    {
+        fprintf(stderr, ERR_KEY_ROTATION_ACK);
+        return -1;
+    }
+
+    // Odoslanie rotacneho nonce
+    if (send_all(sock, item->rotation_nonce, NONCE_SIZE) != NONCE_SIZE)
+    {
+        fprintf(stderr, ERR_SESSION_NONCE_SEND);
+        return -1;
+    }
+
+    // Odoslanie validacneho signalu
+    if (send_chunk_size_reliable(sock, KEY_ROTATION_VALIDATE) < 0)
+    {
+        fprintf(stderr, ERR_KEY_VALIDATE_SIGNAL);
+        return -1;
+    }
+
+    // Vypis novy relacny kluc
+    printf("New session key: ");
+    for (int i = 0; i < KEY_SIZE; i++)
+    {
+        printf("%02x", item->key[i]);
+    }
+    printf("\n");
+
+    // Odoslanie validacie kluca
+    if (send_all(sock, item->validation, VALIDATION_SIZE) != VALIDATION_SIZE)
+    {
+        fprintf(stderr, ERR_KEY_VALIDATE_SIGNAL);
+        return -1;
+    }
+
+    // Cakanie na signal pripravenosti od servera
+    if (receive_chunk_size_reliable(sock, &ack, 0) < 0 || ack != KEY_ROTATION_READY)
+    {
+        fprintf(stderr, ERR_KEY_ROTATION_READY);
+        return -1;
+    }
+    return 0;
+}
+
 int main()
 {
     // KROK 1: Inicializacia spojenia so serverom
@@ -93,6 +419,7 @@ int main()
 
     // Inicializacia sietovej kniznice pre Windows
     initialize_network();
+    printf(LOG_CRYPTO_KERNEL, crypto_cpu_kernel());
 
     char server_ip[16]; // IP adresa servera
 
@@ -284,7 +611,7 @@ int main()
 
     // Cakanie na potvrdenie relacie
     uint32_t setup_status;
-    if (receive_chunk_size_reliable(sock, &setup_status) < 0 ||
+    if (receive_chunk_size_reliable(sock, &setup_status, 0) < 0 ||
         setup_status != SESSION_SETUP_DONE)
     {
         fprintf(stderr, ERR_SESSION_CONFIRM);
@@ -375,147 +702,146 @@ int main()
         return -1;
     }
 
-    // KROK 4: Hlavny cyklus prenosu dat
-    // - Citanie suboru po blokoch (max TRANSFER_BUFFER_SIZE)
-    // - Generovanie noveho nonce pre kazdy blok
-    // - Sifrovanie dat pomocou ChaCha20-Poly1305
-    // - Odoslanie zasifrovanych dat na server
+    // Dohoda rezimu sifrovania prenosu a velkosti bloku
+    // Prudovy rezim: jeden kontext AEAD na celu relaciu (do dalsej rotacie kluca),
+    // bloky nemaju vlastny nonce a nepotrebuju nove nahodne cisla ani podkluc
+    // Velke bloky znizuju pocet systemovych volani a rezii na ramec
+    uint32_t transfer_mode = TRANSFER_MODE_STREAM;
+    uint32_t chunk_size = TRANSFER_CHUNK_SIZE;
+    uint8_t stream_nonce[NONCE_SIZE];
+    generate_random_bytes(stream_nonce, NONCE_SIZE);
+    if (propose_transfer_mode(sock, &transfer_mode, &chunk_size, stream_nonce) < 0)
+    {
+        fprintf(stderr, ERR_TRANSFER_MODE);
+        fclose(file);
+        cleanup_socket(sock);
+        return -1;
+    }
+    printf(LOG_TRANSFER_MODE, transfer_mode == TRANSFER_MODE_STREAM ? "stream" : "nonce per chunk");
+    printf(LOG_CHUNK_SIZE, (unsigned)chunk_size);
+
+    // Rotacia kluca po KEY_ROTATION_BYTES, zaokruhlene na cele bloky
+    uint64_t rotation_blocks = KEY_ROTATION_BYTES / chunk_size;
+    if (rotation_blocks == 0)
+    {
+        rotation_blocks = 1;
+    }
+
+    crypto_aead_ctx stream_ctx;
+    crypto_aead_ctx *stream = NULL;
+    if (transfer_mode == TRANSFER_MODE_STREAM)
+    {
+        crypto_aead_init_x(&stream_ctx, session_key, stream_nonce);
+        stream = &stream_ctx;
+    }
+
+    // KROK 4: Hlavny cyklus prenosu dat (pipeline)
+    // - Citanie suboru po oknach blokov (max dohodnuta velkost bloku) vo vlakne citaca
+    // - Generovanie noveho nonce pre kazdy blok (len v rezime s nonce, prudovy rezim ma implicitne pocitadlo)
+    // - Sifrovanie dat pomocou ChaCha20-Poly1305 vo viacerych vlaknach naraz
+    // - Odoslanie zasifrovanych dat na server v povodnom poradi (hlavne vlakno)
     uint64_t total_bytes = 0;
     uint64_t block_count = 0;
     printf(LOG_TRANSFER_START);
 
-    // Vytvorenie bufferov pre prenos - docasne ulozisko pre data
-    uint8_t buffer[TRANSFER_BUFFER_SIZE];     // Buffer pre necifrovane data
-    uint8_t ciphertext[TRANSFER_BUFFER_SIZE]; // Buffer pre zasifrovane data
-    uint8_t tag[TAG_SIZE];                    // Buffer pre overovaci kod (ako digitalny podpis)
+    uint8_t tag[TAG_SIZE]; // Buffer pre overovaci kod (ako digitalny podpis)
 
     // Premenna pre sledovanie progresu
     uint64_t last_progress_update = 0;
 
-    // Citanie suboru po blokoch (chunk) a ich sifrovanie
-    // Kazdy blok je sifrovany samostatne, aby sa zabranilo preteceniu pamate pri velkych suboroch
-    size_t bytes_read;
-    while ((bytes_read = fread(buffer, 1, TRANSFER_BUFFER_SIZE, file)) > 0)
-    {
-        // Rotacia kluca po kazdych KEY_ROTATION_BLOCKS blokoch
-        // Rotacia kluca zvysuje bezpecnost komunikacie tym, ze obmedzuje mnozstvo dat sifrovanych jednym klucom
-        if (block_count > 0 && block_count % KEY_ROTATION_BLOCKS == 0)
-        {
-            printf(MSG_KEY_ROTATION, (unsigned long long)block_count);
-
-            // Signalizacia rotacie kluca serveru
-            if (send_chunk_size_reliable(sock, KEY_ROTATION_MARKER) < 0)
-            {
-                fprintf(stderr, ERR_KEY_ROTATION_ACK);
-                break;
-            }
-
-            // Cakanie na potvrdenie od servera
-            uint32_t ack;
-            if (receive_chunk_size_reliable(sock, &ack) < 0 || ack != KEY_ROTATION_ACK)
-            {
-                fprintf(stderr, ERR_KEY_ROTATION_ACK);
-                break;
-            }
-
-            // Generovanie nahodneho nonce pre rotaciu kluca
-            uint8_t rotation_nonce[NONCE_SIZE];
-            generate_random_bytes(rotation_nonce, NONCE_SIZE);
-
-            // Odoslanie rotacneho nonce
-            if (send_all(sock, rotation_nonce, NONCE_SIZE) != NONCE_SIZE)
-            {
-                fprintf(stderr, ERR_SESSION_NONCE_SEND);
-                break;
-            }
-
-            // Odoslanie validacneho signalu
-            if (send_chunk_size_reliable(sock, KEY_ROTATION_VALIDATE) < 0)
-            {
-                fprintf(stderr, ERR_KEY_VALIDATE_SIGNAL);
-                break;
-            }
-
-            // Vykonanie rotacie kluca s nahodnym nonce
-            uint8_t previous_key[KEY_SIZE];
-            memcpy(previous_key, session_key, KEY_SIZE);
-            rotate_key(session_key, previous_key, rotation_nonce);
-
-            // Vypis novy relacny kluc
-            printf("New session key: ");
-            for (int i = 0; i < KEY_SIZE; i++)
-            {
-                printf("%02x", session_key[i]);
-            }
-            printf("\n");
-
-            // Generovanie a odoslanie validacie kluca
-            uint8_t validation[VALIDATION_SIZE];
-            generate_key_validation(validation, session_key);
-            if (send_all(sock, validation, VALIDATION_SIZE) != VALIDATION_SIZE)
-            {
-                fprintf(stderr, ERR_KEY_VALIDATE_SIGNAL);
-                break;
-            }
+    // Kontrolny sucet celeho suboru, server ho overi pred potvrdenim prenosu
+    file_digest_ctx digest;
+    file_digest_init(&digest);
 
-            // Cakanie na signal pripravenosti od servera
-            if (receive_chunk_size_reliable(sock, &ack) < 0 || ack != KEY_ROTATION_READY)
-            {
-                fprintf(stderr, ERR_KEY_ROTATION_READY);
-                break;
-            }
+    send_pipeline pipeline;
+    if (send_pipeline_start(&pipeline, file, &digest, session_key, stream, rotation_blocks, chunk_size) < 0)
+    {
+        file_digest_wipe(&digest);
+        fclose(file);
+        cleanup_socket(sock);
+        secure_wipe(&stream_ctx, sizeof(stream_ctx));
+        return -1;
+    }
 
-            secure_wipe(previous_key, KEY_SIZE);
-            wait();
+    // Odosielanie okien v poradi, v akom ich citac precital
+    uint64_t sequence = 0;
+    int send_failed = 0; // Rotacia kluca alebo odoslanie okna zlyhalo, prenos sa nedokonci
+    for (;;)
+    {
+        send_item *item = spsc_queue_pop_wait(&pipeline.done[sequence % pipeline.workers],
+                                              &pipeline.sender_signal, &pipeline.stop);
+        sequence++;
+        if (item == NULL)
+        {
+            send_failed = 1; // Pipeline sa zastavila pred koncom suboru
+            break;
         }
+        if (item->last)
+        {
+            break; // Koniec suboru
+        }
+        chunk_window *window = &item->window;
 
-        // Spracovanie bloku s aktualnym klucom
-        generate_random_bytes(nonce, NONCE_SIZE);
-
-        // Sifrovanie dat pomocou algoritmu ChaCha20-Poly1305
-        // ciphertext: Zasifrovane data
-        // tag: Overovaci kod pre integritu dat
-        // session_key: Kluc pouzity na sifrovanie
-        // nonce: Jednorazova hodnota pre zabezpecenie jedinecnosti sifrovania
-        crypto_aead_lock(ciphertext, tag, session_key, nonce, NULL, 0, buffer, bytes_read);
-
-        // Odoslanie velkosti bloku a zasifrovanych dat
-        int retry_count = MAX_RETRIES;
-        while (retry_count > 0)
+        if (item->rotate && send_key_rotation(sock, item) < 0)
         {
-            if (send_chunk_size_reliable(sock, (uint32_t)bytes_read) == 0 &&
-                send_encrypted_chunk(sock, nonce, tag, ciphertext, bytes_read) == 0)
-            {
-                break; // Uspesne odoslanie
-            }
-            retry_count--;
-            if (retry_count > 0)
-            {
-                fprintf(stderr, MSG_RETRY_FAILED, retry_count);
-                usleep(RETRY_DELAY_MS * 1000);
-            }
+            send_failed = 1;
+            break;
         }
 
-        // Ak sa nepodari odoslat blok dat po maximalnom pocte pokusov, program sa ukonci
-        if (retry_count == 0)
+        // Odoslanie ramcov okna (velkost bloku, nonce, tag, data) zlucene do
+        // malo systemovych volani (SEND_COALESCE_FRAMES ramcov na jedno volanie)
+        // Ciastocne odoslane okno by rozbilo ramcovanie aj rotaciu kluca, preto sa neopakuje
+        if (send_encrypted_frames(sock, stream ? NULL : &window->nonces[0][0], &window->tags[0][0],
+                                  window->data, window->sizes, window->count) != 0)
         {
             fprintf(stderr, MSG_CHUNK_FAILED);
+            send_failed = 1;
             break;
         }
 
-        total_bytes += bytes_read;
-        block_count++;
-
-        // Vypis progresu v intervaloch
-        if (total_bytes - last_progress_update >= PROGRESS_UPDATE_INTERVAL)
+        for (size_t i = 0; i < window->count; i++)
         {
-            printf(LOG_PROGRESS_FORMAT, "Sent", (float)total_bytes / PROGRESS_UPDATE_INTERVAL);
-            fflush(stdout);
-            last_progress_update = total_bytes;
+            total_bytes += window->sizes[i];
+            block_count++;
+
+            // Vypis progresu v intervaloch
+            if (total_bytes - last_progress_update >= PROGRESS_UPDATE_INTERVAL)
+            {
+                printf(LOG_PROGRESS_FORMAT, "Sent", (float)total_bytes / PROGRESS_UPDATE_INTERVAL);
+                fflush(stdout);
+                last_progress_update = total_bytes;
+            }
         }
+
+        // Okno sa vrati citacovi, fronta ma miesto pre vsetky okna
+        spsc_queue_push(&pipeline.free_items, item);
+        pipeline_notify(&pipeline.reader_signal);
     }
+
+    // Citac uz skoncil alebo sa zastavi, kluc a prudovy kontext su po poslednom okne
+    // Pri chybe sa citac a sifrovacie vlakna zastavia pred koncom suboru
+    send_pipeline_destroy(&pipeline, 1, pipeline.workers);
     printf("\n"); // Novy riadok po vypise progresu
 
+    // Neuplny prenos sa neukonci EOF markerom ani kontrolnym suctom,
+    // server ho po zatvoreni spojenia zahodi
+    if (send_failed)
+    {
+        fprintf(stderr, ERR_TRANSFER_INTERRUPTED);
+        file_digest_wipe(&digest);
+        if (file != NULL)
+        {
+            fclose(file);
+        }
+        cleanup_socket(sock);
+        cleanup_network();
+        secure_wipe(key, KEY_SIZE);
+        secure_wipe(session_key, KEY_SIZE);
+        secure_wipe(&stream_ctx, sizeof(stream_ctx));
+        secure_wipe(tag, TAG_SIZE);
+        return -1;
+    }
+
     // Odoslanie EOF markera a upratanie
     if (send_chunk_size_reliable(sock, 0) < 0)
     {
@@ -524,14 +850,47 @@ int main()
 
     printf(LOG_TRANSFER_COMPLETE);
 
+    // Odoslanie kontrolneho suctu celeho suboru (zasifrovany ako posledny blok)
+    // Server ho porovna so svojim suctom a az potom potvrdi prenos
+    // Sucet sa po vypisani zasifruje na mieste
+    uint8_t file_digest[FILE_DIGEST_SIZE];
+    file_digest_final(&digest, file_digest);
+    print_hex(LOG_FILE_DIGEST, file_digest, FILE_DIGEST_SIZE);
+
+    int transfer_ok = 0;
+    if (stream != NULL)
+    {
+        crypto_aead_write(stream, file_digest, tag, NULL, 0, file_digest, FILE_DIGEST_SIZE);
+    }
+    else
+    {
+        generate_random_bytes(nonce, NONCE_SIZE);
+        crypto_aead_lock(file_digest, tag, session_key, nonce, NULL, 0, file_digest, FILE_DIGEST_SIZE);
+    }
+    if (send_encrypted_chunk(sock, stream ? NULL : nonce, tag, file_digest, FILE_DIGEST_SIZE) < 0)
+    {
+        fprintf(stderr, ERR_FILE_DIGEST_SEND);
+    }
+    else if (wait_for_transfer_ack(sock) < 0)
+    {
+        fprintf(stderr, ERR_TRANSFER_ACK);
+    }
+    else
+    {
+        transfer_ok = 1;
+    }
+
     // Upratanie a ukoncenie
     // Zatvorenie suboru
     // Uvolnenie sietovych prostriedkov
     // Navratova hodnota indikuje uspesnost prenosu
 
     // Sprava pre uzivatela o prijati potvrdenia
-    printf(MSG_ACK_RECEIVED);
-    printf(LOG_SUCCESS_FORMAT, "sent", (float)total_bytes / PROGRESS_UPDATE_INTERVAL);
+    if (transfer_ok)
+    {
+        printf(MSG_ACK_RECEIVED);
+        printf(LOG_SUCCESS_FORMAT, "sent", (float)total_bytes / PROGRESS_UPDATE_INTERVAL);
+    }
 
     if (file != NULL)
     {
@@ -546,9 +905,9 @@ int main()
     // Zabranuje utoku typu "memory dump", kedy by utocnik mohol ziskat citlive informacie z pamate
     secure_wipe(key, KEY_SIZE);
     secure_wipe(session_key, KEY_SIZE);
-    secure_wipe(buffer, TRANSFER_BUFFER_SIZE);
-    secure_wipe(ciphertext, TRANSFER_BUFFER_SIZE);
+    secure_wipe(&stream_ctx, sizeof(stream_ctx));
     secure_wipe(tag, TAG_SIZE);
+    secure_wipe(file_digest, FILE_DIGEST_SIZE);
 
-    return (total_bytes > 0) ? 0 : -1;
+    return (transfer_ok && total_bytes > 0) ? 0 : -1;
 }
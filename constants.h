@@ -22,41 +22,58 @@
 #define CONSTANTS_H
 
 // Sietove nastavenia
-#define PORT 8080                 // Cislo portu pre komunikaciu medzi klientom a serverom
-#define MAX_PENDING_CONNECTIONS 3 // Maximalny pocet cakajucich spojeni v rade
+#define PORT 8080                   // Cislo portu pre komunikaciu medzi klientom a serverom
+#define MAX_PENDING_CONNECTIONS 512 // Maximalny pocet cakajucich spojeni v rade
+#define MAX_CLIENT_CONNECTIONS 1024 // Maximalny pocet sucasne obsluhovanych klientov (na jedno vlakno servera)
+#define MAX_SERVER_WORKERS 256      // Horna hranica poctu vlakien servera (jedno na jadro)
+#define EVENT_BATCH_SIZE 64         // Kolko udalosti sa spracuje po jednom cakani slucky
+#define EVENT_LOOP_TICK_MS 1000     // Najdlhsie cakanie slucky (kontrola casovych limitov spojeni)
+#define CONNECTION_OUT_SIZE 128     // Buffer pre odpovede servera cakajuce na odoslanie
+#define IO_RING_ENTRIES 1024        // Velkost kruhu odoslani io_uring (kruh dokonceni je 4x vacsi)
 
 // Casove nastavenia
-#define SOCKET_SHUTDOWN_DELAY_MS 1000 // Cas cakania pred ukoncenim socketu v milisekundach
-#define WAIT_DELAY_MS 250             // Cas cakania medzi pokusmi o synchronizaciu
-#define SOCKET_TIMEOUT_MS 10000       // Maximalny cas cakania na sietovu operaciu
-#define WAIT_FILE_NAME 30000          // Cas cakania na prijatie nazvu suboru
-#define KEY_EXCHANGE_TIMEOUT_MS 5000  // Cas cakania na vymenu klucov
+#define SOCKET_SHUTDOWN_DELAY_MS 1000   // Cas cakania pred ukoncenim socketu v milisekundach
+#define WAIT_DELAY_MS 250               // Cas cakania medzi pokusmi o synchronizaciu
+#define SOCKET_TIMEOUT_MS 10000         // Maximalny cas cakania na sietovu operaciu
+#define WAIT_FILE_NAME 30000            // Cas cakania na prijatie nazvu suboru
+#define KEY_EXCHANGE_TIMEOUT_MS 5000    // Cas cakania na vymenu klucov
+#define PASSWORD_WAIT_TIMEOUT_MS 300000 // Cas cakania na sol, klient medzitym zadava heslo
+#define KEY_DERIVATION_TIMEOUT_MS 30000 // Cas cakania na odvodenie hlavneho kluca (fronta vlakien Argon2)
 
 // Nastavenia opakovanych pokusov
 #define MAX_RETRIES 3       // Kolko krat sa ma operacia opakovat pri zlyhaniach
-#define RETRY_DELAY_MS 1000 // Cas cakania medzi opakovaniami v milisekundach
 #define ACK_SIZE 4          // Velkost potvrdzujucej spravy v bajtoch
 
 // Kryptograficke parametre
-#define KEY_SIZE 32              // Velkost sifrovacieho kluca v bajtoch (256 bitov)
-#define NONCE_SIZE 24            // Velkost jednorazovej hodnoty v bajtoch (192 bitov)
-#define TAG_SIZE 16              // Velkost autentifizacneho kodu v bajtoch (128 bitov)
-#define SALT_SIZE 16             // Velkost soli pre odvodenie kluca (128 bitov)
-#define VALIDATION_SIZE 16       // Velkost overovacich dat v bajtoch
-#define SESSION_KEY_SIZE 32      // Velkost kluca pre jedno spojenie
-#define WORK_AREA_SIZE (1 << 16) // Velkost pracovnej pamate pre Argon2
+#define KEY_SIZE 32                   // Velkost sifrovacieho kluca v bajtoch (256 bitov)
+#define NONCE_SIZE 24                 // Velkost jednorazovej hodnoty v bajtoch (192 bitov)
+#define TAG_SIZE 16                   // Velkost autentifizacneho kodu v bajtoch (128 bitov)
+#define SALT_SIZE 16                  // Velkost soli pre odvodenie kluca (128 bitov)
+#define VALIDATION_SIZE 16            // Velkost overovacich dat v bajtoch
+#define SESSION_KEY_SIZE 32           // Velkost kluca pre jedno spojenie
+#define WORK_AREA_SIZE (1 << 16)      // Velkost pracovnej pamate pre Argon2
+#define FILE_DIGEST_SIZE 64           // Velkost kontrolneho suctu celeho suboru (BLAKE2bp)
+#define KEYPAIR_POOL_SIZE 16          // Pocet predpocitanych docasnych parov klucov (server)
+#define KEY_DERIVATION_WORKERS 2      // Vlakna servera pre Argon2 (kazde drzi ARGON2_MEMORY_BLOCKS KB pamate)
+#define RANDOM_POOL_SIZE 1024         // Pripraveny prud ChaCha20 generatora nahodnych cisel (na vlakno)
+#define RANDOM_RESEED_BYTES (1 << 20) // Po kolkych vydanych bajtoch sa generator znovu nasadi z jadra
 
 // Parametre rotacie klucov
-#define KEY_ROTATION_BLOCKS 1024         // Po kolkych blokoch sa ma kluc zmenit
-#define KEY_ROTATION_MARKER 0xFFFFFFFF   // Specialna hodnota oznacujuca rotaciu kluca
-#define KEY_ROTATION_ACK 0xFFFFFFFE      // Potvrdenie prijatia noveho kluca
-#define KEY_ROTATION_READY 0xFFFFFFFD    // Signal pripravenosti na novy kluc
-#define KEY_ROTATION_VALIDATE 0xFFFFFFFB // Kontrola spravnosti noveho kluca
+#define KEY_ROTATION_BYTES (64 * 1024 * 1024) // Po kolkych bajtoch sa ma kluc zmenit (zaokruhlene na cele bloky)
+#define KEY_ROTATION_MARKER 0xFFFFFFFF        // Specialna hodnota oznacujuca rotaciu kluca
+#define KEY_ROTATION_ACK 0xFFFFFFFE           // Potvrdenie prijatia noveho kluca
+#define KEY_ROTATION_READY 0xFFFFFFFD         // Signal pripravenosti na novy kluc
+#define KEY_ROTATION_VALIDATE 0xFFFFFFFB      // Kontrola spravnosti noveho kluca
 
 // Priznaky nastavenia spojenia
 #define SESSION_SETUP_START 0xFFFFFFF0 // Zaciatok vytvarania spojenia
 #define SESSION_SETUP_DONE 0xFFFFFFF3  // Uspesne vytvorene spojenie
 
+// Rezimy sifrovania prenosu (klient navrhne, server potvrdi pred prenosom)
+#define TRANSFER_MODE_NONCE 0xFFFFFFE0  // Kazdy blok ma vlastny nahodny nonce (24 bajtov v ramci)
+#define TRANSFER_MODE_STREAM 0xFFFFFFE1 // Prudove AEAD s implicitnym pocitadlom, bez nonce v ramci
+#define CONTROL_MESSAGE_MIN 0xFFFFFFE0  // Hodnoty od tejto vyssie su riadiace spravy, nie velkosti blokov
+
 // Specialne hodnoty pre protokol
 #define MAGIC_READY "READY" // Kontrolne retazce pre overenie spravnosti komunikacie
 #define MAGIC_KEYOK "KEYOK"
@@ -68,14 +85,29 @@
 #define PASSWORD_BUFFER_SIZE 128               // Maximalna dlzka hesla
 #define FILE_NAME_BUFFER_SIZE 240              // Maximalna dlzka nazvu suboru
 #define NEW_FILE_NAME_BUFFER_SIZE 256          // Maximalna dlzka noveho nazvu suboru
-#define TRANSFER_BUFFER_SIZE 4096              // Velkost bloku pre prenos dat
+#define TRANSFER_BUFFER_SIZE 4096              // Najmensia velkost bloku pre prenos dat
+#define TRANSFER_CHUNK_SIZE (256 * 1024)       // Velkost bloku, ktoru navrhuje klient
+#define MAX_TRANSFER_CHUNK_SIZE (4 * 1024 * 1024) // Najvacsi blok, ktory server prijme (zvysok sa oreze)
 #define SIGNAL_SIZE 5                          // Velkost kontrolnych sprav
 #define PROGRESS_UPDATE_INTERVAL (1024 * 1024) // Interval aktualizacie priebehu
+#define FILE_DIGEST_BATCH_SIZE (4 * 1024 * 1024) // Davka dat pre kontrolny sucet (velke davky sa hashuju vo vlaknach)
+#define AEAD_WINDOW_CHUNKS 8                     // Pocet blokov sifrovanych/desifrovanych jednym volanim (batch AEAD)
+#define SEND_COALESCE_FRAMES 8                   // Pocet ramcov odoslanych jednym systemovym volanim (1 = kazdy ramec zvlast)
+#define RECV_SLAB_SIZE (256 * 1024)              // Najmensie volne miesto pre jedno citanie do prijimacieho buffera
+#define RECV_WINDOW_BUDGET (2 * 1024 * 1024)     // Pamat okna blokov spojenia na serveri (pri velkych blokoch ma okno menej blokov)
+
+// Pipeline prenosu (klient: citanie, sifrovanie, odosielanie; server: prijem, desifrovanie, zapis)
+#define PIPELINE_MAX_WORKERS 16        // Najviac vlakien sifrovania/desifrovania v pipeline
+#define PIPELINE_WINDOWS_PER_WORKER 2  // Okna blokov v obehu na jedno vlakno (ohranicuje pamat pipeline)
+#define PIPELINE_MAX_LOOP_WINDOWS 16   // Najviac okien v obehu na jednu slucku udalosti servera
+#define PIPELINE_MAX_WRITERS 4         // Najviac zapisovacov suborov na serveri (zdielaju ich slucky udalosti)
+#define PIPELINE_CACHE_LINE 64         // Velkost riadku cache (oddelenie indexov fronty medzi vlaknami)
+#define PIPELINE_SPIN_ATTEMPTS 64      // Pokusy aktivneho cakania na frontu pred uvolnenim jadra (potom yield a uspanie)
 
 // Konfiguracia Argon2 (funkcia pre odvodzovanie klucov)
 #define ARGON2_MEMORY_BLOCKS 65536 // Kolko pamate pouzit (v 1KB blokoch)
 #define ARGON2_ITERATIONS 3        // Kolko krat sa ma heslo prehashovat
-#define ARGON2_LANES 1             // Kolko paralelnych vypoctov povolit
+#define ARGON2_LANES 4             // Kolko paralelnych vypoctov povolit (jedno vlakno na kazdy)
 
 // Operacie so subormi
 #define FILE_PREFIX "received_" // Predpona pre nazvy prijatych suborov
@@ -100,6 +132,14 @@
 #define LOG_PROGRESS_FORMAT "\rProgress: %s %.2f MB..."                                     // Format spravy o priebehu prenosu
 #define LOG_SUCCESS_FORMAT "Success: File transfer completed. Total bytes %s: %.3f MB\n"    // Format spravy o uspesnom dokonceni
 #define MSG_MASTER_KEY_MATCH "Master key validation successful. Keys match!\n"              // Potvrdenie zhody klucov
+#define LOG_CRYPTO_KERNEL "Crypto kernel: %s\n"                                             // Zvolena implementacia sifrovacich jadier (podla CPU)
+#define LOG_SERVER_WORKERS "Server workers: %d (%s)\n"                                      // Pocet vlakien servera a sposob rozdelenia spojeni
+#define LOG_EVENT_BACKEND "Event loop: %s\n"                                                // Mechanizmus slucky udalosti (io_uring, epoll, poll)
+#define LOG_FILE_DIGEST "File digest (BLAKE2bp): "                                          // Vypis kontrolneho suctu celeho suboru
+#define LOG_TRANSFER_MODE "Transfer mode: %s\n"                                             // Dohodnuty rezim sifrovania prenosu
+#define LOG_CHUNK_SIZE "Chunk size: %u bytes\n"                                             // Dohodnuta velkost bloku prenosu
+#define LOG_PIPELINE "Pipeline: %d %s worker(s), %d windows in flight\n"                    // Pocet vlakien a okien pipeline prenosu
+#define LOG_FILE_WRITERS "File writers: %d\n"                                                 // Pocet zapisovacov suborov servera
 
 // Spravy o stave spojenia
 #define MSG_CONNECTION_ACCEPTED "Connection accepted from %s:%d\n"                                           // Informacia o prijatom spojeni
@@ -114,8 +154,7 @@
 #define MSG_ENTER_FILENAME "Enter filename to send (max 239 characters): " // Vyzva na zadanie nazvu suboru
 #define MSG_ACK_RECEIVED "Received acknowledgment from server.\n"          // Potvrdenie prijatia spravy
 #define MSG_KEY_ROTATION "Initiating key rotation at block %llu\n"         // Informacia o zmene kluca
-#define MSG_RETRY_FAILED "Send failed, retrying... (%d attempts left)\n"   // Nepodarilo sa odoslat, opakovanie
-#define MSG_CHUNK_FAILED "Error: Failed to send chunk after all retries\n" // Chyba pri odosielani bloku po vsetkych opakovaniach
+#define MSG_CHUNK_FAILED "Error: Failed to send chunk window\n"            // Chyba pri odosielani okna blokov
 #define MSG_EOF_FAILED "Error: Failed to send EOF marker\n"                // Chyba pri odosielani EOF markera
 
 // Protokolove konstanty
@@ -24,6 +24,7 @@
 #include <stdio.h>  // Kniznica pre standardny vstup a vystup (nacitanie zo suborov, vypis na obrazovku)
 #include <stdlib.h> // Kniznica pre vseobecne funkcie (sprava pamate, konverzie, nahodne cisla)
 #include <string.h> // Kniznica pre pracu s retazcami (kopirovanie, porovnavanie, spajanie)
+#include <pthread.h> // Kniznica pre vlakna (zasoba klucov na pozadi)
 
 #include "crypto_utils.h" // Pre kryptograficke funkcie
 #include "constants.h"    // Add this include for constants
@@ -42,13 +43,100 @@ void print_hex(const char *label, uint8_t *data, int len)
     printf("\n");
 }
 
+// Generator nahodnych cisel v uzivatelskom priestore (ChaCha20 DRBG)
+// - Kazde vlakno ma vlastny stav, takze netreba zamky
+// - Systemovy generator (BCrypt na Windows, getrandom na Linuxe) sa vola
+//   len pri nasadeni: na zaciatku, po RANDOM_RESEED_BYTES a po fork()
+// - Fast key erasure: po kazdom doplneni sa kluc nahradi prvymi 32 bajtmi
+//   noveho prudu a vydane bajty sa hned mazu, takze stav neprezradi
+//   uz vydane cisla
+typedef struct
+{
+    uint8_t key[KEY_SIZE];          // Aktualny kluc generatora
+    uint8_t pool[RANDOM_POOL_SIZE]; // Pripraveny prud ChaCha20 (vydava sa postupne)
+    size_t pool_left;               // Pocet nevydanych bajtov v poole
+    uint64_t since_reseed;          // Pocet bajtov vydanych od posledneho nasadenia
+    unsigned fork_generation;       // Generacia procesu pri poslednom nasadeni
+    int seeded;                     // Ci uz bol generator nasadeny
+} random_state;
+
+static _Thread_local random_state thread_random;
+static volatile unsigned random_fork_generation = 0;
+static pthread_once_t random_once = PTHREAD_ONCE_INIT;
+
+// Detsky proces po fork() nesmie pokracovat v prude rodica
+static void random_after_fork(void)
+{
+    random_fork_generation++;
+}
+
+static void random_register_fork(void)
+{
+#ifndef _WIN32
+    pthread_atfork(NULL, NULL, random_after_fork);
+#endif
+}
+
+// Nasadenie: novy kluc = BLAKE2b(stary kluc || cerstve bajty z jadra)
+static void random_reseed(random_state *rng)
+{
+    uint8_t seed[KEY_SIZE];
+    if (platform_generate_random_bytes(seed, KEY_SIZE) != 0)
+    {
+        exit(1); // Error pri generovani nahodnych cisel
+    }
+
+    crypto_blake2b_ctx ctx;
+    crypto_blake2b_init(&ctx, KEY_SIZE);
+    crypto_blake2b_update(&ctx, rng->key, KEY_SIZE);
+    crypto_blake2b_update(&ctx, seed, KEY_SIZE);
+    crypto_blake2b_final(&ctx, rng->key);
+    secure_wipe(seed, KEY_SIZE);
+
+    secure_wipe(rng->pool, RANDOM_POOL_SIZE);
+    rng->pool_left = 0;
+    rng->since_reseed = 0;
+    rng->fork_generation = random_fork_generation;
+    rng->seeded = 1;
+}
+
+// Doplnenie poolu, prvych 32 bajtov prudu sa stane novym klucom
+static void random_refill(random_state *rng)
+{
+    static const uint8_t zero_nonce[8] = {0};
+    crypto_chacha20_djb(rng->pool, NULL, RANDOM_POOL_SIZE, rng->key, zero_nonce, 0);
+    memcpy(rng->key, rng->pool, KEY_SIZE);
+    secure_wipe(rng->pool, KEY_SIZE);
+    rng->pool_left = RANDOM_POOL_SIZE - KEY_SIZE;
+}
+
 // Generovanie kryptograficky bezpecnych nahodnych cisel
-// Pouziva systemove generatory (BCrypt na Windows, getrandom na Linuxe)
+// Pri chybe systemoveho generatora sa program ukonci
 void generate_random_bytes(uint8_t *buffer, size_t size)
 {
-    if (platform_generate_random_bytes(buffer, size) != 0)
+    random_state *rng = &thread_random;
+    pthread_once(&random_once, random_register_fork);
+
+    if (!rng->seeded || rng->fork_generation != random_fork_generation ||
+        rng->since_reseed >= RANDOM_RESEED_BYTES)
     {
-        exit(1); // Error pri generovani nahodnych cisel
+        random_reseed(rng);
+    }
+    rng->since_reseed += size;
+
+    while (size > 0)
+    {
+        if (rng->pool_left == 0)
+        {
+            random_refill(rng);
+        }
+        size_t n = size < rng->pool_left ? size : rng->pool_left;
+        uint8_t *src = rng->pool + RANDOM_POOL_SIZE - rng->pool_left;
+        memcpy(buffer, src, n);
+        secure_wipe(src, n);
+        rng->pool_left -= n;
+        buffer += n;
+        size -= n;
     }
 }
 
@@ -111,7 +199,8 @@ static int derive_key_internal(const char *password, const uint8_t *salt_input,
         return -1;
     }
 
-    crypto_argon2(key, KEY_SIZE, work_area, config, inputs, crypto_argon2_no_extras);
+    // Kazdy pruh (lane) sa pocita vo vlastnom vlakne
+    crypto_argon2_parallel(key, KEY_SIZE, work_area, config, inputs, crypto_argon2_no_extras);
 
     // Po dokonceni vymazeme heslo z pamate
     // Zabranuje to jeho odcitaniu z pamate po ukonceni programu
@@ -184,6 +273,127 @@ void generate_ephemeral_keypair(uint8_t public_key[KEY_SIZE], uint8_t secret_key
     crypto_x25519_public_key(public_key, secret_key);
 }
 
+// Zasoba predpocitanych docasnych parov klucov
+// Plni ju vlakno s nizkou prioritou, kazdy par sa vyberie len raz a jeho miesto sa vymaze
+static struct
+{
+    uint8_t public_keys[KEYPAIR_POOL_SIZE][KEY_SIZE];
+    uint8_t secret_keys[KEYPAIR_POOL_SIZE][KEY_SIZE];
+    int count;                // Pocet pripravenych parov
+    int running;              // Vlakno bezi
+    pthread_t thread;         // Vlakno, ktore doplna zasobu
+    pthread_mutex_t lock;     // Chrani celu strukturu
+    pthread_cond_t not_full;  // Signal pre vlakno, ze sa uvolnilo miesto
+} keypair_pool = {.lock = PTHREAD_MUTEX_INITIALIZER, .not_full = PTHREAD_COND_INITIALIZER};
+
+// Vlakno na pozadi: dopocitava pary, kym zasoba nie je plna
+static void *keypair_pool_fill(void *arg)
+{
+    (void)arg;
+    platform_lower_thread_priority();
+
+    uint8_t public_key[KEY_SIZE];
+    uint8_t secret_key[KEY_SIZE];
+    pthread_mutex_lock(&keypair_pool.lock);
+    while (keypair_pool.running)
+    {
+        if (keypair_pool.count == KEYPAIR_POOL_SIZE)
+        {
+            pthread_cond_wait(&keypair_pool.not_full, &keypair_pool.lock);
+            continue;
+        }
+
+        // Vypocet bez zamku, aby spojenie nemuselo cakat
+        pthread_mutex_unlock(&keypair_pool.lock);
+        generate_ephemeral_keypair(public_key, secret_key);
+        pthread_mutex_lock(&keypair_pool.lock);
+
+        if (keypair_pool.count < KEYPAIR_POOL_SIZE)
+        {
+            memcpy(keypair_pool.public_keys[keypair_pool.count], public_key, KEY_SIZE);
+            memcpy(keypair_pool.secret_keys[keypair_pool.count], secret_key, KEY_SIZE);
+            keypair_pool.count++;
+        }
+    }
+    pthread_mutex_unlock(&keypair_pool.lock);
+
+    secure_wipe(public_key, KEY_SIZE);
+    secure_wipe(secret_key, KEY_SIZE);
+    return NULL;
+}
+
+// Spustenie vlakna pre zasobu klucov
+// Pri ukonceni programu sa vlakno zastavi a zasoba vymaze (atexit)
+int keypair_pool_start(void)
+{
+    static int stop_registered = 0;
+
+    pthread_mutex_lock(&keypair_pool.lock);
+    if (keypair_pool.running)
+    {
+        pthread_mutex_unlock(&keypair_pool.lock);
+        return 0;
+    }
+    keypair_pool.running = 1;
+    if (pthread_create(&keypair_pool.thread, NULL, keypair_pool_fill, NULL) != 0)
+    {
+        keypair_pool.running = 0;
+        pthread_mutex_unlock(&keypair_pool.lock);
+        fprintf(stderr, ERR_KEYPAIR_POOL);
+        return -1;
+    }
+    pthread_mutex_unlock(&keypair_pool.lock);
+
+    if (!stop_registered)
+    {
+        atexit(keypair_pool_stop);
+        stop_registered = 1;
+    }
+    return 0;
+}
+
+// Zastavenie vlakna a bezpecne vymazanie nepouzitych klucov
+void keypair_pool_stop(void)
+{
+    pthread_mutex_lock(&keypair_pool.lock);
+    int was_running = keypair_pool.running;
+    keypair_pool.running = 0;
+    pthread_cond_signal(&keypair_pool.not_full);
+    pthread_mutex_unlock(&keypair_pool.lock);
+
+    if (was_running && !pthread_equal(pthread_self(), keypair_pool.thread))
+    {
+        pthread_join(keypair_pool.thread, NULL);
+    }
+
+    pthread_mutex_lock(&keypair_pool.lock);
+    secure_wipe(keypair_pool.public_keys, sizeof(keypair_pool.public_keys));
+    secure_wipe(keypair_pool.secret_keys, sizeof(keypair_pool.secret_keys));
+    keypair_pool.count = 0;
+    pthread_mutex_unlock(&keypair_pool.lock);
+}
+
+// Vyber pripraveneho paru klucov zo zasoby
+// Ak je zasoba prazdna (napr. naval spojeni), par sa vytvori hned
+void take_ephemeral_keypair(uint8_t public_key[KEY_SIZE], uint8_t secret_key[KEY_SIZE])
+{
+    pthread_mutex_lock(&keypair_pool.lock);
+    if (keypair_pool.count > 0)
+    {
+        int i = --keypair_pool.count;
+        memcpy(public_key, keypair_pool.public_keys[i], KEY_SIZE);
+        memcpy(secret_key, keypair_pool.secret_keys[i], KEY_SIZE);
+        secure_wipe(keypair_pool.public_keys[i], KEY_SIZE);
+        secure_wipe(keypair_pool.secret_keys[i], KEY_SIZE);
+        pthread_cond_signal(&keypair_pool.not_full);
+        pthread_mutex_unlock(&keypair_pool.lock);
+        return;
+    }
+    pthread_mutex_unlock(&keypair_pool.lock);
+
+    generate_ephemeral_keypair(public_key, secret_key);
+}
+
 // Vypocet zdielaneho tajomstva pomocou Diffie-Hellman vymeny
 // Kombinuje nas sukromny kluc s verejnym klucom protistrany
 void compute_shared_secret(uint8_t shared_secret[KEY_SIZE],
@@ -193,6 +403,17 @@ void compute_shared_secret(uint8_t shared_secret[KEY_SIZE],
     crypto_x25519(shared_secret, secret_key, peer_public);
 }
 
+// Vypocet spolocnych tajnych klucov pre viac relacii naraz
+// Vysledky su rovnake ako pri compute_shared_secret(), ale na procesoroch
+// s AVX2 sa pocitaju 4 relacie naraz v SIMD linkach
+void compute_shared_secrets(uint8_t *shared_secrets,
+                            const uint8_t *secret_keys,
+                            const uint8_t *peer_publics,
+                            size_t count)
+{
+    crypto_x25519_batch(shared_secrets, secret_keys, peer_publics, count);
+}
+
 // Vytvorenie relacie kombinaciou hlavneho kluca a zdielaneho tajomstva
 // Pridava dodatocnu vrstvu zabezpecenia pomocou session_nonce
 void setup_session(uint8_t session_key[KEY_SIZE],
@@ -234,3 +455,188 @@ int verify_session_verification(const uint8_t *received, const uint8_t *session_
     // Pouzi Monocypher funkciu pre konštantný čas porovnania
     return crypto_verify32(received, expected) == 0;
 }
+
+// Kontrolny sucet celeho suboru (BLAKE2bp)
+// Data sa zbieraju do davok velkosti FILE_DIGEST_BATCH_SIZE, aby sa
+// 4 listy stromu hashovali paralelne vo vlaknach (male bloky by stacili
+// len na SIMD v jednom vlakne). Ak sa davka nepodari alokovat,
+// hashuje sa priamo bez nej.
+void file_digest_init(file_digest_ctx *digest)
+{
+    crypto_blake2bp_init(&digest->ctx, FILE_DIGEST_SIZE);
+    digest->batch = malloc(FILE_DIGEST_BATCH_SIZE);
+    digest->batch_len = 0;
+}
+
+// Prida dalsie data suboru do kontrolneho suctu
+void file_digest_update(file_digest_ctx *digest, const uint8_t *data, size_t size)
+{
+    if (digest->batch == NULL)
+    {
+        crypto_blake2bp_update(&digest->ctx, data, size);
+        return;
+    }
+
+    // Plna davka sa zahashuje naraz
+    if (digest->batch_len + size > FILE_DIGEST_BATCH_SIZE)
+    {
+        crypto_blake2bp_update(&digest->ctx, digest->batch, digest->batch_len);
+        digest->batch_len = 0;
+    }
+    if (size >= FILE_DIGEST_BATCH_SIZE)
+    {
+        crypto_blake2bp_update(&digest->ctx, data, size);
+        return;
+    }
+    memcpy(digest->batch + digest->batch_len, data, size);
+    digest->batch_len += size;
+}
+
+// Dokonci kontrolny sucet a uvolni davku
+void file_digest_final(file_digest_ctx *digest, uint8_t hash[FILE_DIGEST_SIZE])
+{
+    if (digest->batch != NULL)
+    {
+        crypto_blake2bp_update(&digest->ctx, digest->batch, digest->batch_len);
+    }
+    crypto_blake2bp_final(&digest->ctx, hash);
+    file_digest_wipe(digest);
+}
+
+// Bezpecne vymaze davku (obsahuje nesifrovane data suboru) a uvolni ju
+// Da sa volat aj po file_digest_final alebo pri preruseni prenosu
+void file_digest_wipe(file_digest_ctx *digest)
+{
+    if (digest->batch != NULL)
+    {
+        secure_wipe(digest->batch, FILE_DIGEST_BATCH_SIZE);
+        free(digest->batch);
+        digest->batch = NULL;
+    }
+    digest->batch_len = 0;
+    crypto_wipe(&digest->ctx, sizeof(digest->ctx));
+}
+
+// Alokacia okna pre chunks blokov velkosti chunk_size (najviac AEAD_WINDOW_CHUNKS)
+// chunk_size = 0: okno bez vlastnej pamate, data[i] nastavi volajuci
+// (napr. ukazovatele priamo do prijimacieho buffera)
+// Vracia -1 ak sa pamat nepodarilo alokovat
+int chunk_window_init(chunk_window *window, size_t chunk_size, size_t chunks)
+{
+    memset(window, 0, sizeof(*window));
+    if (chunk_size == 0 || chunks == 0)
+    {
+        return 0;
+    }
+    if (chunks > AEAD_WINDOW_CHUNKS)
+    {
+        chunks = AEAD_WINDOW_CHUNKS;
+    }
+    window->storage = malloc(chunks * chunk_size);
+    if (window->storage == NULL)
+    {
+        fprintf(stderr, ERR_WINDOW_MEMORY);
+        return -1;
+    }
+    for (size_t i = 0; i < chunks; i++)
+    {
+        window->data[i] = window->storage + i * chunk_size;
+    }
+    window->chunk_size = chunk_size;
+    window->capacity = chunks;
+    return 0;
+}
+
+// Bezpecne vymaze okno (obsahuje nesifrovane data suboru) a uvolni ho
+void chunk_window_free(chunk_window *window)
+{
+    if (window->storage != NULL)
+    {
+        secure_wipe(window->storage, window->capacity * window->chunk_size);
+        free(window->storage);
+    }
+    secure_wipe(window, sizeof(*window));
+}
+
+// Sifrovanie celeho okna blokov
+// Prudovy rezim: bloky idu postupne cez jeden kontext (crypto_aead_write),
+// nonce je implicitne pocitadlo a kluc sa po kazdom bloku posunie dalej
+// Rezim s nonce: kazdy blok dostane nove nahodne nonce, odvodenie podkluca
+// (HChaCha20) a autentizacne kluce sa pocitaju pre viac blokov naraz v SIMD
+void chunk_window_lock(chunk_window *window, const uint8_t key[KEY_SIZE],
+                       crypto_aead_ctx *stream)
+{
+    if (stream != NULL)
+    {
+        for (size_t i = 0; i < window->count; i++)
+        {
+            crypto_aead_write(stream, window->data[i], window->tags[i], NULL, 0,
+                              window->data[i], window->sizes[i]);
+        }
+        return;
+    }
+
+    uint8_t keys[AEAD_WINDOW_CHUNKS][KEY_SIZE];
+    uint8_t *texts[AEAD_WINDOW_CHUNKS];
+
+    for (size_t i = 0; i < window->count; i++)
+    {
+        memcpy(keys[i], key, KEY_SIZE);
+        texts[i] = window->data[i];
+    }
+    generate_random_bytes(&window->nonces[0][0], window->count * NONCE_SIZE);
+
+    crypto_aead_lock_batch(texts, &window->tags[0][0], &keys[0][0],
+                           &window->nonces[0][0], (const uint8_t *const *)texts,
+                           window->sizes, window->count);
+    secure_wipe(keys, sizeof(keys));
+}
+
+// Desifrovanie a overenie celeho okna blokov
+// Vracia -1 ak niektory blok nepresiel overenim (jeho data su vymazane)
+// V prudovom rezime sa skonci pri prvej chybe (dalsie bloky by sa nezhodovali s kontextom)
+int chunk_window_unlock(chunk_window *window, const uint8_t key[KEY_SIZE],
+                        crypto_aead_ctx *stream)
+{
+    if (stream != NULL)
+    {
+        for (size_t i = 0; i < window->count; i++)
+        {
+            if (crypto_aead_read(stream, window->data[i], window->tags[i], NULL, 0,
+                                 window->data[i], window->sizes[i]) != 0)
+            {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    uint8_t keys[AEAD_WINDOW_CHUNKS][KEY_SIZE];
+    uint8_t *texts[AEAD_WINDOW_CHUNKS];
+
+    for (size_t i = 0; i < window->count; i++)
+    {
+        memcpy(keys[i], key, KEY_SIZE);
+        texts[i] = window->data[i];
+    }
+
+    int result = crypto_aead_unlock_batch(texts, &window->tags[0][0], &keys[0][0],
+                                          &window->nonces[0][0], (const uint8_t *const *)texts,
+                                          window->sizes, window->count);
+    secure_wipe(keys, sizeof(keys));
+    return result;
+}
+
+// Posunie prudovy kontext o count blokov bez sifrovania
+// Dalsi kluc kontextu nezavisi od obsahu bloku, prazdny zapis ho posunie rovnako
+// ako skutocny blok, kopia kontextu pred posunom potom sifruje/desifruje tieto bloky
+void aead_stream_skip(crypto_aead_ctx *stream, size_t count)
+{
+    uint8_t empty[1];
+    uint8_t tag[TAG_SIZE];
+    for (size_t i = 0; i < count; i++)
+    {
+        crypto_aead_write(stream, empty, tag, NULL, 0, empty, 0);
+    }
+    secure_wipe(tag, TAG_SIZE);
+}
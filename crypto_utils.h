@@ -11,7 +11,10 @@
  *     - Vytvaranie klucov z hesiel pomocou Argon2
  *     - Pravidelnu vymenu klucov pocas prenosu
  *     - Zabezpecenu vymenu klucov pomocou X25519
+ *     - Zasobu predpocitanych docasnych klucov
  *     - Spravovanie sifrovanych spojeni
+ *     - Kontrolny sucet celeho suboru (BLAKE2bp)
+ *     - Davkove sifrovanie okna blokov prenosu
  * Zavislosti:
  *     - Monocypher 4.0.2 (sifrovacie algoritmy)
  *     - constants.h (konstanty programu)
@@ -55,10 +58,22 @@ void generate_key_validation(uint8_t *validation, // Vytvori kontrolny kod pre o
 void generate_ephemeral_keypair(uint8_t public_key[32], // Vytvori docasny par klucov pre jedno spojenie
                                 uint8_t secret_key[32]);
 
+// Zasoba predpocitanych parov klucov (vlakno na pozadi)
+int keypair_pool_start(void); // Spusti vlakno, ktore doplna zasobu
+void keypair_pool_stop(void); // Zastavi vlakno a vymaze nepouzite kluce
+
+void take_ephemeral_keypair(uint8_t public_key[32], // Vyberie par zo zasoby (pouzije sa len raz)
+                            uint8_t secret_key[32]);
+
 void compute_shared_secret(uint8_t shared_secret[32], // Vypocita spolocny tajny kluc medzi klientom a serverom
                            const uint8_t secret_key[32],
                            const uint8_t peer_public[32]);
 
+void compute_shared_secrets(uint8_t *shared_secrets, // Spolocne kluce pre viac relacii naraz (po 32 bajtov, 4 naraz v SIMD)
+                            const uint8_t *secret_keys,
+                            const uint8_t *peer_publics,
+                            size_t count);
+
 void setup_session(uint8_t session_key[32], // Pripravi sifrovane spojenie s novymi klucmi
                    const uint8_t master_key[32],
                    const uint8_t shared_key[32],
@@ -68,4 +83,42 @@ void generate_session_verification(uint8_t *out, const uint8_t *session_key); //
 
 int verify_session_verification(const uint8_t *received, const uint8_t *session_key); // Overi kontrolny kod spojenia
 
+// Kontrolny sucet celeho suboru (BLAKE2bp) pre overenie integrity prenosu
+typedef struct
+{
+    crypto_blake2bp_ctx ctx; // Stav stromoveho hashu
+    uint8_t *batch;          // Davka dat pred hashovanim (NULL ak sa nepodarilo alokovat)
+    size_t batch_len;        // Pocet bajtov v davke
+} file_digest_ctx;
+
+void file_digest_init(file_digest_ctx *digest);                                     // Zacne novy kontrolny sucet
+void file_digest_update(file_digest_ctx *digest, const uint8_t *data, size_t size); // Prida data suboru
+void file_digest_final(file_digest_ctx *digest, uint8_t hash[FILE_DIGEST_SIZE]);    // Dokonci kontrolny sucet
+void file_digest_wipe(file_digest_ctx *digest);                                     // Vymaze stav bez dokoncenia
+
+// Okno blokov prenosu, sifruje/desifruje sa jednym volanim batch AEAD
+// Sifrovanie aj desifrovanie prebieha na mieste, otvoreny text prepise sifrovany a naopak
+// Data blokov su na halde, velkost bloku sa dohodne pred prenosom
+typedef struct
+{
+    uint8_t *data[AEAD_WINDOW_CHUNKS];              // Data blokov (pred/po sifrovani)
+    uint8_t nonces[AEAD_WINDOW_CHUNKS][NONCE_SIZE]; // Nonce pre kazdy blok
+    uint8_t tags[AEAD_WINDOW_CHUNKS][TAG_SIZE];     // Autentizacne tagy blokov
+    size_t sizes[AEAD_WINDOW_CHUNKS];               // Velkosti blokov
+    size_t count;                                   // Pocet blokov v okne
+    size_t chunk_size;                              // Dohodnuta velkost bloku (kapacita data[i])
+    size_t capacity;                                // Pocet blokov s alokovanou pamatou
+    uint8_t *storage;                               // Spolocna alokacia pre vsetky bloky
+} chunk_window;
+
+int chunk_window_init(chunk_window *window, size_t chunk_size, size_t chunks); // Alokuje okno pre chunks blokov
+void chunk_window_free(chunk_window *window);                                 // Vymaze a uvolni okno
+
+// stream: prudovy kontext (TRANSFER_MODE_STREAM), alebo NULL pre rezim s nonce v kazdom bloku
+void chunk_window_lock(chunk_window *window, const uint8_t key[KEY_SIZE], // Zasifruje okno
+                       crypto_aead_ctx *stream);
+int chunk_window_unlock(chunk_window *window, const uint8_t key[KEY_SIZE], // Desifruje a overi okno
+                        crypto_aead_ctx *stream);
+void aead_stream_skip(crypto_aead_ctx *stream, size_t count); // Posunie prudovy kontext o count blokov
+
 #endif // CRYPTO_UTILS_H
\ No newline at end of file
@@ -18,6 +18,13 @@
 #define ERR_CHUNK_SIZE "Error: Failed to read chunk size\n"                                     // Chyba pri citani velkosti bloku dat
 #define ERR_CHUNK_PROCESS "Error: Failed to process chunk\n"                                    // Chyba pri spracovani bloku dat
 #define ERR_TRANSFER_INTERRUPTED "Error: File transfer failed or was interrupted prematurely\n" // Chyba pri preruseni prenosu
+#define ERR_EVENT_LOOP "Error: Event loop failed\n"                                             // Chyba slucky udalosti servera
+#define ERR_CONNECTION_LIMIT "Error: Too many connections, rejecting client\n"                  // Prekroceny pocet sucasnych spojeni
+#define ERR_CONNECTION_TIMEOUT "Error: Client connection timed out\n"                           // Klient neposlal data v casovom limite
+#define ERR_KEY_DERIVATION_THREAD "Error: Failed to start key derivation thread\n"              // Vlakno pre odvodenie hlavneho kluca sa nespustilo
+#define ERR_SERVER_WORKER "Error: Failed to start server worker %d\n"                           // Vlakno servera sa nespustilo
+#define ERR_REUSEPORT "Error: Failed to set SO_REUSEPORT (%s)\n"                                // Chyba pri zdielani portu medzi vlaknami
+#define ERR_FILE_WRITE "Error: Failed to write received data to file\n"                         // Chyba pri zapise prijatych dat na disk
 
 // Chybove spravy pre sietove operacie
 #define ERR_WINSOCK_INIT "Error: Winsock initialization failed\n"                               // Chyba pri inicializacii Winsock
@@ -58,10 +65,15 @@
 #define ERR_KEEPALIVE "Warning: Failed to set keepalive\n"             // Chyba pri nastaveni keepalive spojenia
 
 // Chybove spravy pre kryptograficke operacie
-#define ERR_RANDOM_LINUX "Error: Failed to generate random bytes (%s)\n"              // Chyba pri generovani nahodnych cisel na Linuxe
-#define ERR_RANDOM_WINDOWS "Error: Failed to generate random bytes (BCrypt error)\n"  // Chyba pri generovani nahodnych cisel na Windows
-#define ERR_KEY_DERIVE_PARAMS "Error: Invalid parameters for key derivation\n"        // Neplatne parametre pre derivaciu kluca
-#define ERR_KEY_DERIVE_MEMORY "Error: Failed to allocate memory for key derivation\n" // Nedostatok pamate pre derivaciu kluca
+#define ERR_RANDOM_LINUX "Error: Failed to generate random bytes (%s)\n"                      // Chyba pri generovani nahodnych cisel na Linuxe
+#define ERR_RANDOM_WINDOWS "Error: Failed to generate random bytes (BCrypt error)\n"          // Chyba pri generovani nahodnych cisel na Windows
+#define ERR_KEY_DERIVE_PARAMS "Error: Invalid parameters for key derivation\n"                // Neplatne parametre pre derivaciu kluca
+#define ERR_KEY_DERIVE_MEMORY "Error: Failed to allocate memory for key derivation\n"         // Nedostatok pamate pre derivaciu kluca
+#define ERR_KEYPAIR_POOL "Warning: Failed to start keypair pool, keys are generated inline\n" // Vlakno pre zasobu klucov sa nespustilo
+#define ERR_WINDOW_MEMORY "Error: Failed to allocate memory for transfer window\n"         // Nedostatok pamate pre okno blokov prenosu
+#define ERR_RECV_BUFFER_MEMORY "Error: Failed to allocate memory for receive buffer\n"   // Nedostatok pamate pre prijimaci buffer
+#define ERR_PIPELINE_MEMORY "Error: Failed to allocate memory for transfer pipeline\n"   // Nedostatok pamate pre pipeline prenosu
+#define ERR_PIPELINE_THREAD "Error: Failed to start transfer pipeline thread\n"          // Vlakno pipeline prenosu sa nespustilo
 
 // Chybove spravy pre nastavenia klienta
 #define ERR_IP_ADDRESS_READ "Error: Failed to read IP address\n"                                   // Chyba pri citani IP adresy
@@ -74,5 +86,12 @@
 #define ERR_FILE_OPEN "Error: Cannot open file '%s' (%s)\n"                               // Chyba pri otvarani suboru
 #define ERR_FILENAME_SEND "Error: Failed to send file name to server (%s)\n"              // Chyba pri odosielani nazvu suboru
 #define ERR_KEY_ROTATION_ACK "Error: Failed to acknowledge key rotation\n"                // Chyba pri potvrdeni rotacie kluca
+#define ERR_TRANSFER_MODE "Error: Failed to negotiate transfer mode\n"                   // Chyba pri dohode rezimu sifrovania
+
+// Chybove spravy pre kontrolny sucet suboru
+#define ERR_FILE_DIGEST_SEND "Error: Failed to send file digest\n"                            // Chyba pri odosielani kontrolneho suctu
+#define ERR_FILE_DIGEST_RECEIVE "Error: Failed to receive file digest from client\n"          // Chyba pri prijimani kontrolneho suctu
+#define ERR_FILE_DIGEST_MISMATCH "Error: File digest mismatch - received file is corrupted\n" // Kontrolne sucty suboru sa nezhoduju
+#define ERR_TRANSFER_ACK "Error: Server did not confirm the transfer\n"                       // Server nepotvrdil prenos (nezhoda suctu)
 
 #endif // ERRORS_H
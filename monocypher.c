@@ -53,6 +53,21 @@
 
 #include "monocypher.h"
 
+// x86-64 SIMD kernels, compiled with per-function target attributes
+// and selected at run time.  Define MONOCYPHER_NO_SIMD to only build
+// the portable code.
+#if !defined(MONOCYPHER_NO_SIMD) && defined(__x86_64__) \
+	&& (defined(__GNUC__) || defined(__clang__)) && defined(__SIZEOF_INT128__)
+#define MONOCYPHER_SIMD
+#include <immintrin.h>
+#define TARGET(isa) __attribute__((target(isa)))
+#endif
+
+// Threaded Argon2 (crypto_argon2_parallel()).  Requires pthreads.
+#ifdef MONOCYPHER_THREADS
+#include <pthread.h>
+#endif
+
 #ifdef MONOCYPHER_CPP_NAMESPACE
 namespace MONOCYPHER_CPP_NAMESPACE {
 #endif
@@ -76,6 +91,9 @@ typedef uint32_t u32;
 typedef int32_t  i32;
 typedef int64_t  i64;
 typedef uint64_t u64;
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 u128;
+#endif
 
 static const u8 zero[128] = {0};
 
@@ -166,6 +184,159 @@ void crypto_wipe(void *secret, size_t size)
 	ZERO(v_secret, size);
 }
 
+////////////////////
+/// CPU dispatch ///
+////////////////////
+// Argon2 operates on 1024 byte blocks.
+typedef struct { u64 a[128]; } blk;
+
+// The hot loops of Chacha20, Poly1305 and BLAKE2b go through this
+// table.  The portable kernels are always available, the vector ones
+// are picked at start up according to what the CPU supports.
+typedef struct {
+	const char *name;
+	// Whole 64 byte blocks; in may be NULL (raw key stream).
+	// Increments the block counter in input[12..13].
+	void (*chacha20_blocks)(u8 *out, const u8 *in, u32 input[16],
+	                        size_t nb_blocks);
+	void (*poly_blocks)(crypto_poly1305_ctx *ctx, const u8 *in,
+	                    size_t nb_blocks, unsigned end);
+	// is_last_block is 1 for the last block, 3 for the last block
+	// of the last node of a tree level (crypto_blake2bp()).
+	void (*blake2b_compress)(crypto_blake2b_ctx *ctx, int is_last_block);
+	// 4 independent contexts at once (crypto_blake2b_multi()).
+	void (*blake2b_compress_x4)(crypto_blake2b_ctx *ctx[4], int is_last_block);
+	// Chacha20 and Poly1305 in a single pass over whole 64 byte
+	// blocks: the cipher text is authenticated as it is written
+	// (or read, if decrypt is set).
+	void (*aead_blocks)(u8 *out, const u8 *in, u32 input[16],
+	                    crypto_poly1305_ctx *poly_ctx, size_t nb_blocks,
+	                    int decrypt);
+	// Argon2 compression of previous and reference into current.
+	void (*argon2_fill)(blk *current, const blk *previous,
+	                    const blk *reference, blk *tmp, int xor_current);
+	// 8 independent Chacha20 permutations, without the final
+	// addition (crypto_aead_lock_batch()).
+	void (*chacha20_rounds_x8)(u32 out[8][16], const u32 in[8][16]);
+	// 4 independent X25519 ladders (crypto_x25519_batch()).
+	// Scalars are already trimmed.
+	void (*x25519_x4)(u8 q[4][32], const u8 scalar[4][32],
+	                  const u8 p[4][32]);
+} kernel_set;
+
+static void chacha20_blocks_scalar(u8 *out, const u8 *in, u32 input[16],
+                                   size_t nb_blocks);
+static void poly_blocks_scalar(crypto_poly1305_ctx *ctx, const u8 *in,
+                               size_t nb_blocks, unsigned end);
+static void blake2b_compress_scalar(crypto_blake2b_ctx *ctx,
+                                    int is_last_block);
+static void blake2b_compress_x4_scalar(crypto_blake2b_ctx *ctx[4],
+                                       int is_last_block);
+static void aead_blocks_scalar(u8 *out, const u8 *in, u32 input[16],
+                               crypto_poly1305_ctx *poly_ctx,
+                               size_t nb_blocks, int decrypt);
+static void argon2_fill_scalar(blk *current, const blk *previous,
+                               const blk *reference, blk *tmp,
+                               int xor_current);
+static void x25519_x4_scalar(u8 q[4][32], const u8 scalar[4][32],
+                             const u8 p[4][32]);
+static void chacha20_rounds_x8_scalar(u32 out[8][16], const u32 in[8][16]);
+
+static const kernel_set scalar_kernels = {
+	"scalar",
+	chacha20_blocks_scalar,
+	poly_blocks_scalar,
+	blake2b_compress_scalar,
+	blake2b_compress_x4_scalar,
+	aead_blocks_scalar,
+	argon2_fill_scalar,
+	chacha20_rounds_x8_scalar,
+	x25519_x4_scalar,
+};
+
+#ifdef MONOCYPHER_SIMD
+static void chacha20_blocks_ssse3 (u8 *out, const u8 *in, u32 input[16],
+                                   size_t nb_blocks);
+static void chacha20_blocks_avx2  (u8 *out, const u8 *in, u32 input[16],
+                                   size_t nb_blocks);
+static void chacha20_blocks_avx512(u8 *out, const u8 *in, u32 input[16],
+                                   size_t nb_blocks);
+static void poly_blocks_avx2(crypto_poly1305_ctx *ctx, const u8 *in,
+                             size_t nb_blocks, unsigned end);
+static void aead_blocks_avx2(u8 *out, const u8 *in, u32 input[16],
+                             crypto_poly1305_ctx *poly_ctx,
+                             size_t nb_blocks, int decrypt);
+static void argon2_fill_avx2(blk *current, const blk *previous,
+                             const blk *reference, blk *tmp,
+                             int xor_current);
+static void blake2b_compress_avx2(crypto_blake2b_ctx *ctx, int is_last_block);
+static void blake2b_compress_x4_avx2(crypto_blake2b_ctx *ctx[4],
+                                     int is_last_block);
+static void x25519_x4_avx2(u8 q[4][32], const u8 scalar[4][32],
+                           const u8 p[4][32]);
+static void chacha20_rounds_x8_avx2(u32 out[8][16], const u32 in[8][16]);
+
+static const kernel_set ssse3_kernels = {
+	"ssse3",
+	chacha20_blocks_ssse3,
+	poly_blocks_scalar,
+	blake2b_compress_scalar,
+	blake2b_compress_x4_scalar,
+	aead_blocks_scalar,
+	argon2_fill_scalar,
+	chacha20_rounds_x8_scalar,
+	x25519_x4_scalar,
+};
+
+static const kernel_set avx2_kernels = {
+	"avx2",
+	chacha20_blocks_avx2,
+	poly_blocks_avx2,
+	blake2b_compress_avx2,
+	blake2b_compress_x4_avx2,
+	aead_blocks_avx2,
+	argon2_fill_avx2,
+	chacha20_rounds_x8_avx2,
+	x25519_x4_avx2,
+};
+
+static const kernel_set avx512_kernels = {
+	"avx512",
+	chacha20_blocks_avx512,
+	poly_blocks_avx2,
+	blake2b_compress_avx2,
+	blake2b_compress_x4_avx2,
+	aead_blocks_avx2,
+	argon2_fill_avx2,
+	chacha20_rounds_x8_avx2,
+	x25519_x4_avx2,
+};
+#endif
+
+static const kernel_set *kernels = &scalar_kernels;
+
+#ifdef MONOCYPHER_SIMD
+// Runs before main(), so the table never changes once threads exist.
+// Each level assumes the ones below it (AVX-512F CPUs have AVX2...).
+__attribute__((constructor))
+static void select_kernels(void)
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2")) {
+		kernels = &avx512_kernels;
+	} else if (__builtin_cpu_supports("avx2")) {
+		kernels = &avx2_kernels;
+	} else if (__builtin_cpu_supports("ssse3")) {
+		kernels = &ssse3_kernels;
+	}
+}
+#endif
+
+const char *crypto_cpu_kernel(void)
+{
+	return kernels->name;
+}
+
 /////////////////
 /// Chacha 20 ///
 /////////////////
@@ -201,6 +372,445 @@ static void chacha20_rounds(u32 out[16], const u32 in[16])
 
 static const u8 *chacha20_constant = (const u8*)"expand 32-byte k"; // 16 bytes
 
+// Whole blocks, one at a time.
+// Increments the counter in input[12..13].
+static void chacha20_blocks_scalar(u8 *out, const u8 *in, u32 input[16],
+                                   size_t nb_blocks)
+{
+	u32 pool[16];
+	FOR (i, 0, nb_blocks) {
+		chacha20_rounds(pool, input);
+		if (in != 0) {
+			FOR (j, 0, 16) {
+				u32 p = pool[j] + input[j];
+				store32_le(out, p ^ load32_le(in));
+				out += 4;
+				in  += 4;
+			}
+		} else {
+			FOR (j, 0, 16) {
+				u32 p = pool[j] + input[j];
+				store32_le(out, p);
+				out += 4;
+			}
+		}
+		input[12]++;
+		if (input[12] == 0) {
+			input[13]++;
+		}
+	}
+	WIPE_BUFFER(pool);
+}
+
+// 8 independent states (batch AEAD), one at a time.
+static void chacha20_rounds_x8_scalar(u32 out[8][16], const u32 in[8][16])
+{
+	FOR (i, 0, 8) {
+		chacha20_rounds(out[i], in[i]);
+	}
+}
+
+#ifdef MONOCYPHER_SIMD
+// The vector kernels below run one block per 32-bit lane, and process
+// as many blocks as they have lanes at once.  The counters of each lane
+// are computed in 64 bits, then split across input[12] and input[13].
+static void chacha20_lane_counters(u32 lo[16], u32 hi[16], u64 ctr,
+                                   size_t nb_lanes)
+{
+	FOR (i, 0, nb_lanes) {
+		lo[i] = (u32) (ctr + i);
+		hi[i] = (u32)((ctr + i) >> 32);
+	}
+}
+
+static u64 chacha20_counter(const u32 input[16])
+{
+	return input[12] + ((u64)input[13] << 32);
+}
+
+static void chacha20_set_counter(u32 input[16], u64 ctr)
+{
+	input[12] = (u32) ctr;
+	input[13] = (u32)(ctr >> 32);
+}
+
+// SSSE3: 4 blocks at a time
+#define ROTL32_SSE(x, n)	\
+	_mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n))
+#define QUARTERROUND_SSSE3(a, b, c, d)	\
+	a = _mm_add_epi32(a, b);  d = _mm_shuffle_epi8(_mm_xor_si128(d, a), rot16); \
+	c = _mm_add_epi32(c, d);  b = ROTL32_SSE(_mm_xor_si128(b, c), 12);          \
+	a = _mm_add_epi32(a, b);  d = _mm_shuffle_epi8(_mm_xor_si128(d, a), rot8);  \
+	c = _mm_add_epi32(c, d);  b = ROTL32_SSE(_mm_xor_si128(b, c), 7)
+
+// Processes nb_blocks blocks, a multiple of 4.
+TARGET("ssse3")
+static void chacha20_x4_ssse3(u8 *out, const u8 *in, u32 input[16],
+                              size_t nb_blocks)
+{
+	const __m128i rot16 = _mm_setr_epi8(
+		2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+	const __m128i rot8  = _mm_setr_epi8(
+		3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+	__m128i s[16];
+	FOR (i, 0, 16) {
+		s[i] = _mm_set1_epi32((int)input[i]);
+	}
+	u64 ctr = chacha20_counter(input);
+
+	for (size_t b = 0; b < nb_blocks; b += 4) {
+		u32 lo[16], hi[16];
+		chacha20_lane_counters(lo, hi, ctr, 4);
+		s[12] = _mm_loadu_si128((const __m128i*)lo);
+		s[13] = _mm_loadu_si128((const __m128i*)hi);
+
+		__m128i x0  = s[ 0], x1  = s[ 1], x2  = s[ 2], x3  = s[ 3];
+		__m128i x4  = s[ 4], x5  = s[ 5], x6  = s[ 6], x7  = s[ 7];
+		__m128i x8  = s[ 8], x9  = s[ 9], x10 = s[10], x11 = s[11];
+		__m128i x12 = s[12], x13 = s[13], x14 = s[14], x15 = s[15];
+		FOR (i, 0, 10) {
+			QUARTERROUND_SSSE3(x0, x4, x8 , x12);
+			QUARTERROUND_SSSE3(x1, x5, x9 , x13);
+			QUARTERROUND_SSSE3(x2, x6, x10, x14);
+			QUARTERROUND_SSSE3(x3, x7, x11, x15);
+			QUARTERROUND_SSSE3(x0, x5, x10, x15);
+			QUARTERROUND_SSSE3(x1, x6, x11, x12);
+			QUARTERROUND_SSSE3(x2, x7, x8 , x13);
+			QUARTERROUND_SSSE3(x3, x4, x9 , x14);
+		}
+		__m128i w[16] = {
+			x0, x1, x2 , x3 , x4 , x5 , x6 , x7 ,
+			x8, x9, x10, x11, x12, x13, x14, x15,
+		};
+		// 4x4 transposition of each group of 4 words:
+		// block j gets words 4k..4k+3 from group k.
+		FOR (k, 0, 4) {
+			__m128i a  = _mm_add_epi32(w[4*k + 0], s[4*k + 0]);
+			__m128i bb = _mm_add_epi32(w[4*k + 1], s[4*k + 1]);
+			__m128i c  = _mm_add_epi32(w[4*k + 2], s[4*k + 2]);
+			__m128i d  = _mm_add_epi32(w[4*k + 3], s[4*k + 3]);
+			__m128i t0 = _mm_unpacklo_epi32(a, bb);
+			__m128i t1 = _mm_unpackhi_epi32(a, bb);
+			__m128i t2 = _mm_unpacklo_epi32(c, d);
+			__m128i t3 = _mm_unpackhi_epi32(c, d);
+			__m128i r[4] = {
+				_mm_unpacklo_epi64(t0, t2), _mm_unpackhi_epi64(t0, t2),
+				_mm_unpacklo_epi64(t1, t3), _mm_unpackhi_epi64(t1, t3),
+			};
+			FOR (j, 0, 4) {
+				size_t offset = j*64 + k*16;
+				if (in != 0) {
+					r[j] = _mm_xor_si128(
+						r[j], _mm_loadu_si128((const __m128i*)(in + offset)));
+				}
+				_mm_storeu_si128((__m128i*)(out + offset), r[j]);
+			}
+		}
+		out += 256;
+		if (in != 0) {
+			in += 256;
+		}
+		ctr += 4;
+	}
+	chacha20_set_counter(input, ctr);
+}
+
+// AVX2: 8 blocks at a time
+#define ROTL32_AVX2(x, n)	\
+	_mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n))
+#define QUARTERROUND_AVX2(a, b, c, d)	\
+	a = _mm256_add_epi32(a, b);	\
+	d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot16);	\
+	c = _mm256_add_epi32(c, d);	\
+	b = ROTL32_AVX2(_mm256_xor_si256(b, c), 12);	\
+	a = _mm256_add_epi32(a, b);	\
+	d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot8);	\
+	c = _mm256_add_epi32(c, d);	\
+	b = ROTL32_AVX2(_mm256_xor_si256(b, c), 7)
+
+// Transposes 8 words of 8 blocks, so each vector holds 8 words of a
+// single block: o[0] gets block 0, o[1] block 4, o[2] block 1...
+TARGET("avx2")
+static void transpose8_avx2(__m256i o[8], const __m256i w[8])
+{
+	__m256i t0 = _mm256_unpacklo_epi32(w[0], w[1]);
+	__m256i t1 = _mm256_unpackhi_epi32(w[0], w[1]);
+	__m256i t2 = _mm256_unpacklo_epi32(w[2], w[3]);
+	__m256i t3 = _mm256_unpackhi_epi32(w[2], w[3]);
+	__m256i t4 = _mm256_unpacklo_epi32(w[4], w[5]);
+	__m256i t5 = _mm256_unpackhi_epi32(w[4], w[5]);
+	__m256i t6 = _mm256_unpacklo_epi32(w[6], w[7]);
+	__m256i t7 = _mm256_unpackhi_epi32(w[6], w[7]);
+	__m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+	__m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+	__m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+	__m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+	__m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+	__m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+	__m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+	__m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+	o[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+	o[1] = _mm256_permute2x128_si256(u0, u4, 0x31);
+	o[2] = _mm256_permute2x128_si256(u1, u5, 0x20);
+	o[3] = _mm256_permute2x128_si256(u1, u5, 0x31);
+	o[4] = _mm256_permute2x128_si256(u2, u6, 0x20);
+	o[5] = _mm256_permute2x128_si256(u2, u6, 0x31);
+	o[6] = _mm256_permute2x128_si256(u3, u7, 0x20);
+	o[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+// Processes nb_blocks blocks, a multiple of 8.
+TARGET("avx2")
+static void chacha20_x8_avx2(u8 *out, const u8 *in, u32 input[16],
+                             size_t nb_blocks)
+{
+	static const int block_of[8] = { 0, 4, 1, 5, 2, 6, 3, 7 };
+	const __m256i rot16 = _mm256_setr_epi8(
+		2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+		2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+	const __m256i rot8 = _mm256_setr_epi8(
+		3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+		3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+	__m256i s[16];
+	FOR (i, 0, 16) {
+		s[i] = _mm256_set1_epi32((int)input[i]);
+	}
+	u64 ctr = chacha20_counter(input);
+
+	for (size_t b = 0; b < nb_blocks; b += 8) {
+		u32 lo[16], hi[16];
+		chacha20_lane_counters(lo, hi, ctr, 8);
+		s[12] = _mm256_loadu_si256((const __m256i*)lo);
+		s[13] = _mm256_loadu_si256((const __m256i*)hi);
+
+		__m256i x0  = s[ 0], x1  = s[ 1], x2  = s[ 2], x3  = s[ 3];
+		__m256i x4  = s[ 4], x5  = s[ 5], x6  = s[ 6], x7  = s[ 7];
+		__m256i x8  = s[ 8], x9  = s[ 9], x10 = s[10], x11 = s[11];
+		__m256i x12 = s[12], x13 = s[13], x14 = s[14], x15 = s[15];
+		FOR (i, 0, 10) {
+			QUARTERROUND_AVX2(x0, x4, x8 , x12);
+			QUARTERROUND_AVX2(x1, x5, x9 , x13);
+			QUARTERROUND_AVX2(x2, x6, x10, x14);
+			QUARTERROUND_AVX2(x3, x7, x11, x15);
+			QUARTERROUND_AVX2(x0, x5, x10, x15);
+			QUARTERROUND_AVX2(x1, x6, x11, x12);
+			QUARTERROUND_AVX2(x2, x7, x8 , x13);
+			QUARTERROUND_AVX2(x3, x4, x9 , x14);
+		}
+		__m256i w[16] = {
+			x0, x1, x2 , x3 , x4 , x5 , x6 , x7 ,
+			x8, x9, x10, x11, x12, x13, x14, x15,
+		};
+		FOR (i, 0, 16) {
+			w[i] = _mm256_add_epi32(w[i], s[i]);
+		}
+		__m256i lo_words[8], hi_words[8];
+		transpose8_avx2(lo_words, w);
+		transpose8_avx2(hi_words, w + 8);
+		FOR (i, 0, 8) {
+			u8 *o = out + block_of[i] * 64;
+			__m256i k0 = lo_words[i];
+			__m256i k1 = hi_words[i];
+			if (in != 0) {
+				const u8 *p = in + block_of[i] * 64;
+				k0 = _mm256_xor_si256(k0, _mm256_loadu_si256((const __m256i*)p));
+				k1 = _mm256_xor_si256(k1,
+				                      _mm256_loadu_si256((const __m256i*)(p+32)));
+			}
+			_mm256_storeu_si256((__m256i*)o       , k0);
+			_mm256_storeu_si256((__m256i*)(o + 32), k1);
+		}
+		out += 512;
+		if (in != 0) {
+			in += 512;
+		}
+		ctr += 8;
+	}
+	chacha20_set_counter(input, ctr);
+	_mm256_zeroall();
+}
+
+// 8 independent states, one per lane (batch AEAD).
+// Same as chacha20_rounds(): no final addition.
+TARGET("avx2")
+static void chacha20_rounds_x8_avx2(u32 out[8][16], const u32 in[8][16])
+{
+	static const int block_of[8] = { 0, 4, 1, 5, 2, 6, 3, 7 };
+	const __m256i rot16 = _mm256_setr_epi8(
+		2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+		2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+	const __m256i rot8 = _mm256_setr_epi8(
+		3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+		3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+	__m256i s[16];
+	FOR (i, 0, 16) {
+		s[i] = _mm256_setr_epi32((int)in[0][i], (int)in[1][i],
+		                         (int)in[2][i], (int)in[3][i],
+		                         (int)in[4][i], (int)in[5][i],
+		                         (int)in[6][i], (int)in[7][i]);
+	}
+	__m256i x0  = s[ 0], x1  = s[ 1], x2  = s[ 2], x3  = s[ 3];
+	__m256i x4  = s[ 4], x5  = s[ 5], x6  = s[ 6], x7  = s[ 7];
+	__m256i x8  = s[ 8], x9  = s[ 9], x10 = s[10], x11 = s[11];
+	__m256i x12 = s[12], x13 = s[13], x14 = s[14], x15 = s[15];
+	FOR (i, 0, 10) {
+		QUARTERROUND_AVX2(x0, x4, x8 , x12);
+		QUARTERROUND_AVX2(x1, x5, x9 , x13);
+		QUARTERROUND_AVX2(x2, x6, x10, x14);
+		QUARTERROUND_AVX2(x3, x7, x11, x15);
+		QUARTERROUND_AVX2(x0, x5, x10, x15);
+		QUARTERROUND_AVX2(x1, x6, x11, x12);
+		QUARTERROUND_AVX2(x2, x7, x8 , x13);
+		QUARTERROUND_AVX2(x3, x4, x9 , x14);
+	}
+	__m256i w[16] = {
+		x0, x1, x2 , x3 , x4 , x5 , x6 , x7 ,
+		x8, x9, x10, x11, x12, x13, x14, x15,
+	};
+	__m256i lo_words[8], hi_words[8];
+	transpose8_avx2(lo_words, w);
+	transpose8_avx2(hi_words, w + 8);
+	FOR (i, 0, 8) {
+		_mm256_storeu_si256((__m256i*)out[block_of[i]]      , lo_words[i]);
+		_mm256_storeu_si256((__m256i*)(out[block_of[i]] + 8), hi_words[i]);
+	}
+	_mm256_zeroall();
+}
+
+// AVX-512F: 16 blocks at a time
+#define QUARTERROUND_AVX512(a, b, c, d)	\
+	a = _mm512_add_epi32(a, b);  d = _mm512_rol_epi32(_mm512_xor_si512(d, a), 16); \
+	c = _mm512_add_epi32(c, d);  b = _mm512_rol_epi32(_mm512_xor_si512(b, c), 12); \
+	a = _mm512_add_epi32(a, b);  d = _mm512_rol_epi32(_mm512_xor_si512(d, a),  8); \
+	c = _mm512_add_epi32(c, d);  b = _mm512_rol_epi32(_mm512_xor_si512(b, c),  7)
+
+// Processes nb_blocks blocks, a multiple of 16.
+TARGET("avx512f")
+static void chacha20_x16_avx512(u8 *out, const u8 *in, u32 input[16],
+                                size_t nb_blocks)
+{
+	__m512i s[16];
+	FOR (i, 0, 16) {
+		s[i] = _mm512_set1_epi32((int)input[i]);
+	}
+	u64 ctr = chacha20_counter(input);
+
+	for (size_t b = 0; b < nb_blocks; b += 16) {
+		u32 lo[16], hi[16];
+		chacha20_lane_counters(lo, hi, ctr, 16);
+		s[12] = _mm512_loadu_si512(lo);
+		s[13] = _mm512_loadu_si512(hi);
+
+		__m512i x0  = s[ 0], x1  = s[ 1], x2  = s[ 2], x3  = s[ 3];
+		__m512i x4  = s[ 4], x5  = s[ 5], x6  = s[ 6], x7  = s[ 7];
+		__m512i x8  = s[ 8], x9  = s[ 9], x10 = s[10], x11 = s[11];
+		__m512i x12 = s[12], x13 = s[13], x14 = s[14], x15 = s[15];
+		FOR (i, 0, 10) {
+			QUARTERROUND_AVX512(x0, x4, x8 , x12);
+			QUARTERROUND_AVX512(x1, x5, x9 , x13);
+			QUARTERROUND_AVX512(x2, x6, x10, x14);
+			QUARTERROUND_AVX512(x3, x7, x11, x15);
+			QUARTERROUND_AVX512(x0, x5, x10, x15);
+			QUARTERROUND_AVX512(x1, x6, x11, x12);
+			QUARTERROUND_AVX512(x2, x7, x8 , x13);
+			QUARTERROUND_AVX512(x3, x4, x9 , x14);
+		}
+		__m512i w[16] = {
+			x0, x1, x2 , x3 , x4 , x5 , x6 , x7 ,
+			x8, x9, x10, x11, x12, x13, x14, x15,
+		};
+		// Transposition, first within 128-bit lanes: r[k][j] lane L
+		// holds words 4k..4k+3 of block 4L+j.  Then across lanes.
+		__m512i r[4][4];
+		FOR (k, 0, 4) {
+			__m512i a  = _mm512_add_epi32(w[4*k + 0], s[4*k + 0]);
+			__m512i bb = _mm512_add_epi32(w[4*k + 1], s[4*k + 1]);
+			__m512i c  = _mm512_add_epi32(w[4*k + 2], s[4*k + 2]);
+			__m512i d  = _mm512_add_epi32(w[4*k + 3], s[4*k + 3]);
+			__m512i t0 = _mm512_unpacklo_epi32(a, bb);
+			__m512i t1 = _mm512_unpackhi_epi32(a, bb);
+			__m512i t2 = _mm512_unpacklo_epi32(c, d);
+			__m512i t3 = _mm512_unpackhi_epi32(c, d);
+			r[k][0] = _mm512_unpacklo_epi64(t0, t2);
+			r[k][1] = _mm512_unpackhi_epi64(t0, t2);
+			r[k][2] = _mm512_unpacklo_epi64(t1, t3);
+			r[k][3] = _mm512_unpackhi_epi64(t1, t3);
+		}
+		FOR (j, 0, 4) {
+			__m512i t0 = _mm512_shuffle_i32x4(r[0][j], r[1][j], 0x44);
+			__m512i t1 = _mm512_shuffle_i32x4(r[0][j], r[1][j], 0xee);
+			__m512i t2 = _mm512_shuffle_i32x4(r[2][j], r[3][j], 0x44);
+			__m512i t3 = _mm512_shuffle_i32x4(r[2][j], r[3][j], 0xee);
+			__m512i blocks[4] = {
+				_mm512_shuffle_i32x4(t0, t2, 0x88),  // block j
+				_mm512_shuffle_i32x4(t0, t2, 0xdd),  // block j + 4
+				_mm512_shuffle_i32x4(t1, t3, 0x88),  // block j + 8
+				_mm512_shuffle_i32x4(t1, t3, 0xdd),  // block j + 12
+			};
+			FOR (l, 0, 4) {
+				size_t offset = (l*4 + j) * 64;
+				if (in != 0) {
+					blocks[l] = _mm512_xor_si512(
+						blocks[l], _mm512_loadu_si512(in + offset));
+				}
+				_mm512_storeu_si512(out + offset, blocks[l]);
+			}
+		}
+		out += 1024;
+		if (in != 0) {
+			in += 1024;
+		}
+		ctr += 16;
+	}
+	chacha20_set_counter(input, ctr);
+	_mm256_zeroall();
+}
+
+// Whole blocks, with the widest kernel first and narrower ones for
+// the remaining blocks.
+static void chacha20_blocks_ssse3(u8 *out, const u8 *in, u32 input[16],
+                                  size_t nb_blocks)
+{
+	size_t nb_wide = nb_blocks & ~(size_t)3;
+	if (nb_wide > 0) {
+		chacha20_x4_ssse3(out, in, input, nb_wide);
+	}
+	if (nb_blocks > nb_wide) {
+		chacha20_blocks_scalar(out + (nb_wide << 6),
+		                       in == 0 ? 0 : in + (nb_wide << 6),
+		                       input, nb_blocks - nb_wide);
+	}
+}
+
+static void chacha20_blocks_avx2(u8 *out, const u8 *in, u32 input[16],
+                                 size_t nb_blocks)
+{
+	size_t nb_wide = nb_blocks & ~(size_t)7;
+	if (nb_wide > 0) {
+		chacha20_x8_avx2(out, in, input, nb_wide);
+	}
+	if (nb_blocks > nb_wide) {
+		chacha20_blocks_ssse3(out + (nb_wide << 6),
+		                      in == 0 ? 0 : in + (nb_wide << 6),
+		                      input, nb_blocks - nb_wide);
+	}
+}
+
+static void chacha20_blocks_avx512(u8 *out, const u8 *in, u32 input[16],
+                                   size_t nb_blocks)
+{
+	size_t nb_wide = nb_blocks & ~(size_t)15;
+	if (nb_wide > 0) {
+		chacha20_x16_avx512(out, in, input, nb_wide);
+	}
+	if (nb_blocks > nb_wide) {
+		chacha20_blocks_avx2(out + (nb_wide << 6),
+		                     in == 0 ? 0 : in + (nb_wide << 6),
+		                     input, nb_blocks - nb_wide);
+	}
+}
+#endif // MONOCYPHER_SIMD
+
 void crypto_chacha20_h(u8 out[32], const u8 key[32], const u8 in [16])
 {
 	u32 block[16];
@@ -230,26 +840,10 @@ u64 crypto_chacha20_djb(u8 *cipher_text, const u8 *plain_text,
 	// Whole blocks
 	u32    pool[16];
 	size_t nb_blocks = text_size >> 6;
-	FOR (i, 0, nb_blocks) {
-		chacha20_rounds(pool, input);
-		if (plain_text != 0) {
-			FOR (j, 0, 16) {
-				u32 p = pool[j] + input[j];
-				store32_le(cipher_text, p ^ load32_le(plain_text));
-				cipher_text += 4;
-				plain_text  += 4;
-			}
-		} else {
-			FOR (j, 0, 16) {
-				u32 p = pool[j] + input[j];
-				store32_le(cipher_text, p);
-				cipher_text += 4;
-			}
-		}
-		input[12]++;
-		if (input[12] == 0) {
-			input[13]++;
-		}
+	kernels->chacha20_blocks(cipher_text, plain_text, input, nb_blocks);
+	cipher_text += nb_blocks << 6;
+	if (plain_text != 0) {
+		plain_text += nb_blocks << 6;
 	}
 	text_size &= 63;
 
@@ -307,8 +901,80 @@ u64 crypto_chacha20_x(u8 *cipher_text, const u8 *plain_text,
 //   end    <= 1
 // Postcondition:
 //   ctx->h <= 4_ffffffff_ffffffff_ffffffff_ffffffff
-static void poly_blocks(crypto_poly1305_ctx *ctx, const u8 *in,
-                        size_t nb_blocks, unsigned end)
+#ifdef __SIZEOF_INT128__
+// Same computation with 3 limbs of 44, 44 and 42 bits, and 128-bit
+// products, for 64-bit CPUs.  The limbs are converted from and to
+// the 32-bit layout of the context on each call.
+#define MASK44 0xfffffffffff
+#define MASK42 0x3ffffffffff
+
+static void poly_load_44(u64 out[3], const u32 in[4], u32 top)
+{
+	u64 lo = in[0] | ((u64)in[1] << 32);
+	u64 hi = in[2] | ((u64)in[3] << 32);
+	out[0] =  lo                       & MASK44;
+	out[1] = ((lo >> 44) | (hi << 20)) & MASK44;
+	out[2] =  (hi >> 24) | ((u64)top << 40);
+}
+
+// input: h0 < 2^44, h1 < 2^45, h2 < 2^42
+static void poly_store_44(u32 out[5], const u64 in[3])
+{
+	u64 h0 = in[0];
+	u64 h1 = in[1] + (h0 >> 44);  h0 &= MASK44;
+	u64 h2 = in[2] + (h1 >> 44);  h1 &= MASK44;
+	u64 lo = h0 | (h1 << 44);
+	u64 hi = (h1 >> 20) | (h2 << 24);
+	out[0] = (u32)lo;
+	out[1] = (u32)(lo >> 32);
+	out[2] = (u32)hi;
+	out[3] = (u32)(hi >> 32);
+	out[4] = (u32)(h2 >> 40);
+}
+
+static void poly_blocks_scalar(crypto_poly1305_ctx *ctx, const u8 *in,
+                               size_t nb_blocks, unsigned end)
+{
+	// Local all the things!
+	u64 r[3], h[3];
+	poly_load_44(r, ctx->r, 0);
+	poly_load_44(h, ctx->h, ctx->h[4]);
+	const u64 r0 = r[0];
+	const u64 r1 = r[1];
+	const u64 r2 = r[2];
+	const u64 s1 = r1 * (5 << 2);
+	const u64 s2 = r2 * (5 << 2);
+	const u64 hibit = (u64)end << 40;
+	u64 h0 = h[0];
+	u64 h1 = h[1];
+	u64 h2 = h[2];
+
+	FOR (i, 0, nb_blocks) {
+		// h + c, without carry propagation
+		const u64 t0 = load32_le(in    ) | ((u64)load32_le(in +  4) << 32);
+		const u64 t1 = load32_le(in + 8) | ((u64)load32_le(in + 12) << 32);
+		h0 +=   t0                       & MASK44;
+		h1 += ((t0 >> 44) | (t1 << 20))  & MASK44;
+		h2 += ((t1 >> 24)                & MASK42) | hibit;
+
+		// (h + c) * r, partially reduced
+		const u128 d0 = (u128)h0*r0 + (u128)h1*s2 + (u128)h2*s1;
+		const u128 e1 = (u128)h0*r1 + (u128)h1*r0 + (u128)h2*s2 + (d0 >> 44);
+		const u128 e2 = (u128)h0*r2 + (u128)h1*r1 + (u128)h2*r0 + (e1 >> 44);
+		h0  = ((u64)d0 & MASK44) + (u64)(e2 >> 42) * 5;
+		h1  = ((u64)e1 & MASK44) + (h0 >> 44);
+		h0 &= MASK44;
+		h2  = (u64)e2 & MASK42;
+		in += 16;
+	}
+	h[0] = h0;
+	h[1] = h1;
+	h[2] = h2;
+	poly_store_44(ctx->h, h);
+}
+#else
+static void poly_blocks_scalar(crypto_poly1305_ctx *ctx, const u8 *in,
+                               size_t nb_blocks, unsigned end)
 {
 	// Local all the things!
 	const u32 r0 = ctx->r[0];
@@ -362,6 +1028,222 @@ static void poly_blocks(crypto_poly1305_ctx *ctx, const u8 *in,
 	ctx->h[3] = h3;
 	ctx->h[4] = h4;
 }
+#endif
+
+#ifdef MONOCYPHER_SIMD
+// AVX2: 4 blocks in parallel, with 5 limbs of 26 bits per 64-bit lane.
+// Lane j absorbs blocks j, j+4, j+8... multiplying by r^4 each time.
+// At the end, the lanes are multiplied by r^4, r^3, r^2 and r, then
+// added together.
+#define MASK26 0x3ffffff
+#define POLY_X4_MIN 16 // blocks
+
+// h = h * r, partially reduced.
+// input : h0, h1 < 2^46, h2 < 2^44, r0, r1 < 2^44, r2 < 2^42
+// output: h0 < 2^44, h1 < 2^44 + 2^11, h2 < 2^42
+static void poly_mul_44(u64 h[3], const u64 r[3])
+{
+	const u64 s1 = r[1] * (5 << 2);
+	const u64 s2 = r[2] * (5 << 2);
+	const u128 d0 = (u128)h[0]*r[0] + (u128)h[1]*s2   + (u128)h[2]*s1;
+	const u128 d1 = (u128)h[0]*r[1] + (u128)h[1]*r[0] + (u128)h[2]*s2;
+	const u128 d2 = (u128)h[0]*r[2] + (u128)h[1]*r[1] + (u128)h[2]*r[0];
+	const u128 c0 = d0 >> 44;
+	const u128 e1 = d1 + c0;
+	const u128 e2 = d2 + (e1 >> 44);
+	u64 h0 = (u64)d0 & MASK44;
+	u64 h1 = (u64)e1 & MASK44;
+	u64 h2 = (u64)e2 & MASK42;
+	h0 += (u64)(e2 >> 42) * 5;
+	h1 += h0 >> 44;
+	h[0] = h0 & MASK44;
+	h[1] = h1;
+	h[2] = h2;
+}
+
+// 32-bit context layout to 26-bit limbs.
+static void poly_32_to_26(u32 out[5], const u32 in[5])
+{
+	out[0] =   in[0]                         & MASK26;
+	out[1] = ((in[0] >> 26) | (in[1] <<  6)) & MASK26;
+	out[2] = ((in[1] >> 20) | (in[2] << 12)) & MASK26;
+	out[3] = ((in[2] >> 14) | (in[3] << 18)) & MASK26;
+	out[4] =  (in[3] >>  8) | (in[4] << 24);
+}
+
+// 26-bit limbs (< 2^58) to the 32-bit context layout,
+// with a full carry propagation (2^130 wraps around to 5).
+static void poly_26_to_32(u32 out[5], u64 l[5])
+{
+	FOR (pass, 0, 2) {
+		FOR (i, 0, 4) {
+			l[i+1] += l[i] >> 26;
+			l[i]   &= MASK26;
+		}
+		if (pass == 0) {
+			l[0] += (l[4] >> 26) * 5;
+			l[4] &= MASK26;
+		}
+	}
+	out[0] = (u32)( l[0]        | (l[1] << 26));
+	out[1] = (u32)((l[1] >>  6) | (l[2] << 20));
+	out[2] = (u32)((l[2] >> 12) | (l[3] << 14));
+	out[3] = (u32)((l[3] >> 18) | (l[4] <<  8));
+	out[4] = (u32)( l[4] >> 24);
+}
+
+// h = h * r, with s = r * 5, partially reduced.
+// input : h < 2^28 (each limb), r < 2^26, s < 2^29
+// output: h0, h2, h3 < 2^26, h1 < 2^26 + 2^9, h4 < 2^26 + 2^7
+TARGET("avx2")
+static void poly_mul_avx2(__m256i h[5], const __m256i r[5],
+                          const __m256i s[5])
+{
+#define MUL(a, b) _mm256_mul_epu32(a, b)
+#define ADD(a, b) _mm256_add_epi64(a, b)
+	__m256i d0 = ADD(ADD(ADD(ADD(MUL(h[0], r[0]), MUL(h[1], s[4])),
+	                         MUL(h[2], s[3])), MUL(h[3], s[2])), MUL(h[4], s[1]));
+	__m256i d1 = ADD(ADD(ADD(ADD(MUL(h[0], r[1]), MUL(h[1], r[0])),
+	                         MUL(h[2], s[4])), MUL(h[3], s[3])), MUL(h[4], s[2]));
+	__m256i d2 = ADD(ADD(ADD(ADD(MUL(h[0], r[2]), MUL(h[1], r[1])),
+	                         MUL(h[2], r[0])), MUL(h[3], s[4])), MUL(h[4], s[3]));
+	__m256i d3 = ADD(ADD(ADD(ADD(MUL(h[0], r[3]), MUL(h[1], r[2])),
+	                         MUL(h[2], r[1])), MUL(h[3], r[0])), MUL(h[4], s[4]));
+	__m256i d4 = ADD(ADD(ADD(ADD(MUL(h[0], r[4]), MUL(h[1], r[3])),
+	                         MUL(h[2], r[2])), MUL(h[3], r[1])), MUL(h[4], r[0]));
+#undef MUL
+
+	// Two interleaved carry chains
+	const __m256i mask = _mm256_set1_epi64x(MASK26);
+	__m256i c;
+	c = _mm256_srli_epi64(d0, 26);  d0 = _mm256_and_si256(d0, mask);  d1 = ADD(d1, c);
+	c = _mm256_srli_epi64(d3, 26);  d3 = _mm256_and_si256(d3, mask);  d4 = ADD(d4, c);
+	c = _mm256_srli_epi64(d1, 26);  d1 = _mm256_and_si256(d1, mask);  d2 = ADD(d2, c);
+	c = _mm256_srli_epi64(d4, 26);  d4 = _mm256_and_si256(d4, mask);
+	d0 = ADD(d0, ADD(c, _mm256_slli_epi64(c, 2)));  // c * 5
+	c = _mm256_srli_epi64(d2, 26);  d2 = _mm256_and_si256(d2, mask);  d3 = ADD(d3, c);
+	c = _mm256_srli_epi64(d0, 26);  d0 = _mm256_and_si256(d0, mask);  d1 = ADD(d1, c);
+	c = _mm256_srli_epi64(d3, 26);  d3 = _mm256_and_si256(d3, mask);  d4 = ADD(d4, c);
+#undef ADD
+	h[0] = d0;  h[1] = d1;  h[2] = d2;  h[3] = d3;  h[4] = d4;
+}
+
+// State of the 4-way loop.  The lanes hold blocks 0, 2, 1 and 3 (see
+// the loads in poly_x4_absorb()), so they are finally multiplied by
+// r^4, r^2, r^3 and r.
+typedef struct {
+	__m256i h[5];
+	u32     pow[4][5]; // r, r^2, r^3, r^4 (26-bit limbs)
+	int     started;
+} poly_x4_ctx;
+
+TARGET("avx2")
+static void poly_x4_init(poly_x4_ctx *x4, const crypto_poly1305_ctx *ctx)
+{
+	u64 pow[4][3];
+	poly_load_44(pow[0], ctx->r, 0);
+	COPY(pow[1], pow[0], 3);  poly_mul_44(pow[1], pow[0]);
+	COPY(pow[2], pow[1], 3);  poly_mul_44(pow[2], pow[0]);
+	COPY(pow[3], pow[1], 3);  poly_mul_44(pow[3], pow[1]);
+	FOR (i, 0, 4) {
+		u32 tmp[5];
+		poly_store_44(tmp, pow[i]);
+		poly_32_to_26(x4->pow[i], tmp);
+		WIPE_BUFFER(tmp);
+	}
+	WIPE_BUFFER(pow);
+
+	u32 h26[5];
+	poly_32_to_26(h26, ctx->h);
+	FOR (i, 0, 5) {
+		x4->h[i] = _mm256_setr_epi64x(h26[i], 0, 0, 0);
+	}
+	x4->started = 0;
+}
+
+// Absorbs nb_blocks blocks, a multiple of 4.
+TARGET("avx2")
+static void poly_x4_absorb(poly_x4_ctx *x4, const u8 *in, size_t nb_blocks,
+                           unsigned end)
+{
+	const __m256i mask  = _mm256_set1_epi64x(MASK26);
+	const __m256i hibit = _mm256_set1_epi64x((i64)end << 24);
+	__m256i r4[5], s4[5], h[5];
+	FOR (i, 0, 5) {
+		r4[i] = _mm256_set1_epi64x(x4->pow[3][i]);
+		s4[i] = _mm256_set1_epi64x(x4->pow[3][i] * 5);
+		h [i] = x4->h[i];
+	}
+	int started = x4->started; // no multiplication before the first blocks
+	for (size_t b = 0; b < nb_blocks; b += 4) {
+		if (started) {
+			poly_mul_avx2(h, r4, s4);
+		}
+		started = 1;
+		__m256i m0 = _mm256_loadu_si256((const __m256i*) in      );
+		__m256i m1 = _mm256_loadu_si256((const __m256i*)(in + 32));
+		__m256i lo = _mm256_unpacklo_epi64(m0, m1); // low  halves
+		__m256i hi = _mm256_unpackhi_epi64(m0, m1); // high halves
+		h[0] = _mm256_add_epi64(h[0], _mm256_and_si256(lo, mask));
+		h[1] = _mm256_add_epi64(h[1], _mm256_and_si256(
+			_mm256_srli_epi64(lo, 26), mask));
+		h[2] = _mm256_add_epi64(h[2], _mm256_and_si256(
+			_mm256_or_si256(_mm256_srli_epi64(lo, 52),
+			                _mm256_slli_epi64(hi, 12)), mask));
+		h[3] = _mm256_add_epi64(h[3], _mm256_and_si256(
+			_mm256_srli_epi64(hi, 14), mask));
+		h[4] = _mm256_add_epi64(h[4], _mm256_or_si256(
+			_mm256_srli_epi64(hi, 40), hibit));
+		in += 64;
+	}
+	FOR (i, 0, 5) {
+		x4->h[i] = h[i];
+	}
+	x4->started = started;
+}
+
+// Merges the lanes back into ctx, and wipes x4.
+TARGET("avx2")
+static void poly_x4_final(poly_x4_ctx *x4, crypto_poly1305_ctx *ctx)
+{
+	if (x4->started) {
+		const u32 (*p)[5] = x4->pow;
+		__m256i rl[5], sl[5];
+		FOR (i, 0, 5) {
+			rl[i] = _mm256_setr_epi64x(p[3][i]    , p[1][i]    ,
+			                           p[2][i]    , p[0][i]    );
+			sl[i] = _mm256_setr_epi64x(p[3][i] * 5, p[1][i] * 5,
+			                           p[2][i] * 5, p[0][i] * 5);
+		}
+		poly_mul_avx2(x4->h, rl, sl);
+		u64 limbs[5];
+		FOR (i, 0, 5) {
+			u64 lanes[4];
+			_mm256_storeu_si256((__m256i*)lanes, x4->h[i]);
+			limbs[i] = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		}
+		poly_26_to_32(ctx->h, limbs);
+	}
+	WIPE_CTX(x4);
+	_mm256_zeroall();
+}
+
+static void poly_blocks_avx2(crypto_poly1305_ctx *ctx, const u8 *in,
+                             size_t nb_blocks, unsigned end)
+{
+	// Computing the powers of r only pays off on longer inputs
+	if (nb_blocks >= POLY_X4_MIN) {
+		size_t nb_wide = nb_blocks & ~(size_t)3;
+		poly_x4_ctx x4;
+		poly_x4_init  (&x4, ctx);
+		poly_x4_absorb(&x4, in, nb_wide, end);
+		poly_x4_final (&x4, ctx);
+		in        += nb_wide << 4;
+		nb_blocks -= nb_wide;
+	}
+	poly_blocks_scalar(ctx, in, nb_blocks, end);
+}
+#endif // MONOCYPHER_SIMD
 
 void crypto_poly1305_init(crypto_poly1305_ctx *ctx, const u8 key[32])
 {
@@ -393,13 +1275,13 @@ void crypto_poly1305_update(crypto_poly1305_ctx *ctx,
 
 	// If block is complete, process it
 	if (ctx->c_idx == 16) {
-		poly_blocks(ctx, ctx->c, 1, 1);
+		kernels->poly_blocks(ctx, ctx->c, 1, 1);
 		ctx->c_idx = 0;
 	}
 
 	// Process the message block by block
 	size_t nb_blocks = message_size >> 4;
-	poly_blocks(ctx, message, nb_blocks, 1);
+	kernels->poly_blocks(ctx, message, nb_blocks, 1);
 	message      += nb_blocks << 4;
 	message_size &= 15;
 
@@ -418,7 +1300,7 @@ void crypto_poly1305_final(crypto_poly1305_ctx *ctx, u8 mac[16])
 	if (ctx->c_idx != 0) {
 		ZERO(ctx->c + ctx->c_idx, 16 - ctx->c_idx);
 		ctx->c[ctx->c_idx] = 1;
-		poly_blocks(ctx, ctx->c, 1, 0);
+		kernels->poly_blocks(ctx, ctx->c, 1, 0);
 	}
 
 	// check if we should subtract 2^130-5 by performing the
@@ -458,23 +1340,23 @@ static const u64 iv[8] = {
 	0x1f83d9abfb41bd6b, 0x5be0cd19137e2179,
 };
 
-static void blake2b_compress(crypto_blake2b_ctx *ctx, int is_last_block)
-{
-	static const u8 sigma[12][16] = {
-		{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
-		{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
-		{ 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
-		{  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
-		{  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
-		{  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
-		{ 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
-		{ 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
-		{  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
-		{ 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
-		{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
-		{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
-	};
+static const u8 sigma[12][16] = {
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+	{ 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+	{  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+	{  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+	{  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+	{ 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+	{ 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+	{  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+	{ 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+};
 
+static void blake2b_compress_scalar(crypto_blake2b_ctx *ctx, int is_last_block)
+{
 	// increment input offset
 	u64   *x = ctx->input_offset;
 	size_t y = ctx->input_idx;
@@ -490,8 +1372,8 @@ static void blake2b_compress(crypto_blake2b_ctx *ctx, int is_last_block)
 	u64 v3 = ctx->hash[3];  u64 v11 = iv[3];
 	u64 v4 = ctx->hash[4];  u64 v12 = iv[4] ^ ctx->input_offset[0];
 	u64 v5 = ctx->hash[5];  u64 v13 = iv[5] ^ ctx->input_offset[1];
-	u64 v6 = ctx->hash[6];  u64 v14 = iv[6] ^ (u64)~(is_last_block - 1);
-	u64 v7 = ctx->hash[7];  u64 v15 = iv[7];
+	u64 v6 = ctx->hash[6];  u64 v14 = iv[6] ^ ((u64)0 - (is_last_block & 1));
+	u64 v7 = ctx->hash[7];  u64 v15 = iv[7] ^ ((u64)0 - (is_last_block >> 1));
 
 	// mangle work vector
 	u64 *input = ctx->input;
@@ -527,6 +1409,184 @@ static void blake2b_compress(crypto_blake2b_ctx *ctx, int is_last_block)
 	ctx->hash[6] ^= v6 ^ v14;  ctx->hash[7] ^= v7 ^ v15;
 }
 
+#ifdef MONOCYPHER_SIMD
+// AVX2: the 4 rows of the work vector are 4 vectors, G runs on the
+// 4 columns then on the 4 diagonals (lane rotations in between).
+// Message words are loaded with the schedule below: for each round,
+// the x and y words of the column step, then of the diagonal step.
+#define BLAKE2_G_AVX2(a, b, c, d, x, y)	\
+	a = _mm256_add_epi64(_mm256_add_epi64(a, b), x);                     \
+	d = _mm256_shuffle_epi32(_mm256_xor_si256(d, a), 0xb1);              \
+	c = _mm256_add_epi64(c, d);                                          \
+	b = _mm256_shuffle_epi8(_mm256_xor_si256(b, c), rot24);              \
+	a = _mm256_add_epi64(_mm256_add_epi64(a, b), y);                     \
+	d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot16);              \
+	c = _mm256_add_epi64(c, d);                                          \
+	b = _mm256_xor_si256(b, c);                                          \
+	b = _mm256_or_si256(_mm256_srli_epi64(b, 63), _mm256_add_epi64(b, b))
+
+TARGET("avx2")
+static void blake2b_compress_avx2(crypto_blake2b_ctx *ctx, int is_last_block)
+{
+	static const u8 schedule[12][16] = {
+		{  0,  2,  4,  6,  1,  3,  5,  7,  8, 10, 12, 14,  9, 11, 13, 15 },
+		{ 14,  4,  9, 13, 10,  8, 15,  6,  1,  0, 11,  5, 12,  2,  7,  3 },
+		{ 11, 12,  5, 15,  8,  0,  2, 13, 10,  3,  7,  9, 14,  6,  1,  4 },
+		{  7,  3, 13, 11,  9,  1, 12, 14,  2,  5,  4, 15,  6, 10,  0,  8 },
+		{  9,  5,  2, 10,  0,  7,  4, 15, 14, 11,  6,  3,  1, 12,  8, 13 },
+		{  2,  6,  0,  8, 12, 10, 11,  3,  4,  7, 15,  1, 13,  5, 14,  9 },
+		{ 12,  1, 14,  4,  5, 15, 13, 10,  0,  6,  9,  8,  7,  3,  2, 11 },
+		{ 13,  7, 12,  3, 11, 14,  1,  9,  5, 15,  8,  2,  0,  4,  6, 10 },
+		{  6, 14, 11,  0, 15,  9,  3,  8, 12, 13,  1, 10,  2,  7,  4,  5 },
+		{ 10,  8,  7,  1,  2,  4,  6,  5, 15,  9,  3, 13, 11, 14, 12,  0 },
+		{  0,  2,  4,  6,  1,  3,  5,  7,  8, 10, 12, 14,  9, 11, 13, 15 },
+		{ 14,  4,  9, 13, 10,  8, 15,  6,  1,  0, 11,  5, 12,  2,  7,  3 },
+	};
+	const __m256i rot24 = _mm256_setr_epi8(
+		3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+		3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+	const __m256i rot16 = _mm256_setr_epi8(
+		2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+		2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+
+	// increment input offset
+	u64   *x = ctx->input_offset;
+	size_t y = ctx->input_idx;
+	x[0] += y;
+	if (x[0] < y) {
+		x[1]++;
+	}
+
+	// init work vector
+	const __m256i h0 = _mm256_loadu_si256((const __m256i*)(ctx->hash    ));
+	const __m256i h1 = _mm256_loadu_si256((const __m256i*)(ctx->hash + 4));
+	__m256i a = h0;
+	__m256i b = h1;
+	__m256i c = _mm256_loadu_si256((const __m256i*)(iv    ));
+	__m256i d = _mm256_xor_si256(
+		_mm256_loadu_si256((const __m256i*)(iv + 4)),
+		_mm256_setr_epi64x((i64)ctx->input_offset[0],
+		                   (i64)ctx->input_offset[1],
+		                   -(i64)(is_last_block & 1),
+		                   -(i64)(is_last_block >> 1)));
+
+	// mangle work vector
+	const u64 *input = ctx->input;
+#define BLAKE2_WORDS_AVX2(s)	\
+	_mm256_setr_epi64x((i64)input[(s)[0]], (i64)input[(s)[1]], \
+	                   (i64)input[(s)[2]], (i64)input[(s)[3]])
+#define BLAKE2_ROUND_AVX2(i)	\
+	BLAKE2_G_AVX2(a, b, c, d, BLAKE2_WORDS_AVX2(schedule[i]     ), \
+	                          BLAKE2_WORDS_AVX2(schedule[i] +  4));\
+	b = _mm256_permute4x64_epi64(b, 0x39);                         \
+	c = _mm256_permute4x64_epi64(c, 0x4e);                         \
+	d = _mm256_permute4x64_epi64(d, 0x93);                         \
+	BLAKE2_G_AVX2(a, b, c, d, BLAKE2_WORDS_AVX2(schedule[i] +  8), \
+	                          BLAKE2_WORDS_AVX2(schedule[i] + 12));\
+	b = _mm256_permute4x64_epi64(b, 0x93);                         \
+	c = _mm256_permute4x64_epi64(c, 0x4e);                         \
+	d = _mm256_permute4x64_epi64(d, 0x39)
+
+	BLAKE2_ROUND_AVX2(0);  BLAKE2_ROUND_AVX2(1);  BLAKE2_ROUND_AVX2(2);
+	BLAKE2_ROUND_AVX2(3);  BLAKE2_ROUND_AVX2(4);  BLAKE2_ROUND_AVX2(5);
+	BLAKE2_ROUND_AVX2(6);  BLAKE2_ROUND_AVX2(7);  BLAKE2_ROUND_AVX2(8);
+	BLAKE2_ROUND_AVX2(9);  BLAKE2_ROUND_AVX2(10); BLAKE2_ROUND_AVX2(11);
+
+	// update hash
+	_mm256_storeu_si256((__m256i*)(ctx->hash    ),
+	                    _mm256_xor_si256(h0, _mm256_xor_si256(a, c)));
+	_mm256_storeu_si256((__m256i*)(ctx->hash + 4),
+	                    _mm256_xor_si256(h1, _mm256_xor_si256(b, d)));
+	_mm256_zeroall();
+}
+#endif // MONOCYPHER_SIMD
+
+// Compresses the current block of 4 independent contexts.
+static void blake2b_compress_x4_scalar(crypto_blake2b_ctx *ctx[4],
+                                       int is_last_block)
+{
+	FOR (i, 0, 4) {
+		kernels->blake2b_compress(ctx[i], is_last_block);
+	}
+}
+
+#ifdef MONOCYPHER_SIMD
+// AVX2, one context per 64-bit lane: each vector holds the same word
+// of the 4 work vectors, so the 4 G of each step are independent.
+TARGET("avx2")
+static void blake2b_compress_x4_avx2(crypto_blake2b_ctx *ctx[4],
+                                     int is_last_block)
+{
+	const __m256i rot24 = _mm256_setr_epi8(
+		3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+		3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+	const __m256i rot16 = _mm256_setr_epi8(
+		2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+		2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+
+	// increment input offsets
+	FOR (l, 0, 4) {
+		u64   *x = ctx[l]->input_offset;
+		size_t y = ctx[l]->input_idx;
+		x[0] += y;
+		if (x[0] < y) {
+			x[1]++;
+		}
+	}
+
+	// Transpose the contexts (lane l = context l)
+#define LANES_AVX2(field)	\
+	_mm256_setr_epi64x((i64)ctx[0]->field, (i64)ctx[1]->field, \
+	                   (i64)ctx[2]->field, (i64)ctx[3]->field)
+	__m256i h[8], m[16], v[16];
+	FOR (i, 0, 8) {
+		h[i] = LANES_AVX2(hash[i]);
+	}
+	FOR (i, 0, 16) {
+		m[i] = LANES_AVX2(input[i]);
+	}
+
+	// init work vector
+	FOR (i, 0, 8) {
+		v[i    ] = h[i];
+		v[i + 8] = _mm256_set1_epi64x((i64)iv[i]);
+	}
+	v[12] = _mm256_xor_si256(v[12], LANES_AVX2(input_offset[0]));
+	v[13] = _mm256_xor_si256(v[13], LANES_AVX2(input_offset[1]));
+	v[14] = _mm256_xor_si256(v[14],
+	                         _mm256_set1_epi64x(-(i64)(is_last_block & 1)));
+	v[15] = _mm256_xor_si256(v[15],
+	                         _mm256_set1_epi64x(-(i64)(is_last_block >> 1)));
+#undef LANES_AVX2
+
+	// mangle work vector
+#define BLAKE2_ROUND_X4(i)	\
+	BLAKE2_G_AVX2(v[0], v[4], v[ 8], v[12], m[sigma[i][ 0]], m[sigma[i][ 1]]); \
+	BLAKE2_G_AVX2(v[1], v[5], v[ 9], v[13], m[sigma[i][ 2]], m[sigma[i][ 3]]); \
+	BLAKE2_G_AVX2(v[2], v[6], v[10], v[14], m[sigma[i][ 4]], m[sigma[i][ 5]]); \
+	BLAKE2_G_AVX2(v[3], v[7], v[11], v[15], m[sigma[i][ 6]], m[sigma[i][ 7]]); \
+	BLAKE2_G_AVX2(v[0], v[5], v[10], v[15], m[sigma[i][ 8]], m[sigma[i][ 9]]); \
+	BLAKE2_G_AVX2(v[1], v[6], v[11], v[12], m[sigma[i][10]], m[sigma[i][11]]); \
+	BLAKE2_G_AVX2(v[2], v[7], v[ 8], v[13], m[sigma[i][12]], m[sigma[i][13]]); \
+	BLAKE2_G_AVX2(v[3], v[4], v[ 9], v[14], m[sigma[i][14]], m[sigma[i][15]])
+	BLAKE2_ROUND_X4(0);  BLAKE2_ROUND_X4(1);  BLAKE2_ROUND_X4(2);
+	BLAKE2_ROUND_X4(3);  BLAKE2_ROUND_X4(4);  BLAKE2_ROUND_X4(5);
+	BLAKE2_ROUND_X4(6);  BLAKE2_ROUND_X4(7);  BLAKE2_ROUND_X4(8);
+	BLAKE2_ROUND_X4(9);  BLAKE2_ROUND_X4(10); BLAKE2_ROUND_X4(11);
+
+	// update hashes
+	FOR (i, 0, 8) {
+		u64 lanes[4];
+		h[i] = _mm256_xor_si256(h[i], _mm256_xor_si256(v[i], v[i + 8]));
+		_mm256_storeu_si256((__m256i*)lanes, h[i]);
+		FOR (l, 0, 4) {
+			ctx[l]->hash[i] = lanes[l];
+		}
+	}
+	_mm256_zeroall();
+}
+#endif // MONOCYPHER_SIMD
+
 void crypto_blake2b_keyed_init(crypto_blake2b_ctx *ctx, size_t hash_size,
                                const u8 *key, size_t key_size)
 {
@@ -589,7 +1649,7 @@ void crypto_blake2b_update(crypto_blake2b_ctx *ctx,
 	size_t nb_blocks = message_size >> 7;
 	FOR (i, 0, nb_blocks) {
 		if (ctx->input_idx == 128) {
-			blake2b_compress(ctx, 0);
+			kernels->blake2b_compress(ctx, 0);
 		}
 		load64_le_buf(ctx->input, message, 16);
 		message += 128;
@@ -600,7 +1660,7 @@ void crypto_blake2b_update(crypto_blake2b_ctx *ctx,
 	if (message_size != 0) {
 		// Compress block & flush input buffer as needed
 		if (ctx->input_idx == 128) {
-			blake2b_compress(ctx, 0);
+			kernels->blake2b_compress(ctx, 0);
 			ctx->input_idx = 0;
 		}
 		if (ctx->input_idx == 0) {
@@ -623,15 +1683,20 @@ void crypto_blake2b_update(crypto_blake2b_ctx *ctx,
 	}
 }
 
-void crypto_blake2b_final(crypto_blake2b_ctx *ctx, u8 *hash)
+static void blake2b_output(const crypto_blake2b_ctx *ctx, u8 *hash)
 {
-	blake2b_compress(ctx, 1); // compress the last block
 	size_t hash_size = MIN(ctx->hash_size, 64);
 	size_t nb_words  = hash_size >> 3;
 	store64_le_buf(hash, ctx->hash, nb_words);
 	FOR (i, nb_words << 3, hash_size) {
 		hash[i] = (ctx->hash[i >> 3] >> (8 * (i & 7))) & 0xff;
 	}
+}
+
+void crypto_blake2b_final(crypto_blake2b_ctx *ctx, u8 *hash)
+{
+	kernels->blake2b_compress(ctx, 1); // compress the last block
+	blake2b_output(ctx, hash);
 	WIPE_CTX(ctx);
 }
 
@@ -650,14 +1715,240 @@ void crypto_blake2b(u8 *hash, size_t hash_size, const u8 *msg, size_t msg_size)
 	crypto_blake2b_keyed(hash, hash_size, 0, 0, msg, msg_size);
 }
 
+void crypto_blake2b_multi(u8 *hashes, size_t hash_size,
+                          const u8 *const *messages, size_t nb_messages,
+                          size_t message_size)
+{
+	// Groups of 4 messages.  Unused lanes of the last group hash the
+	// first message of the group again, and their result is dropped.
+	for (size_t first = 0; first < nb_messages; first += 4) {
+		size_t              nb = MIN(nb_messages - first, 4);
+		crypto_blake2b_ctx  ctx[4];
+		crypto_blake2b_ctx *lanes[4];
+		const u8           *msg[4];
+		FOR (l, 0, 4) {
+			crypto_blake2b_init(ctx + l, hash_size);
+			lanes[l] = ctx + l;
+			msg  [l] = messages[first + (l < nb ? l : 0)];
+		}
+
+		// All blocks but the last, which may be partial (or empty)
+		size_t nb_blocks = message_size == 0 ? 0 : (message_size - 1) >> 7;
+		FOR (b, 0, nb_blocks) {
+			FOR (l, 0, 4) {
+				load64_le_buf(ctx[l].input, msg[l] + (b << 7), 16);
+				ctx[l].input_idx = 128;
+			}
+			kernels->blake2b_compress_x4(lanes, 0);
+		}
+		size_t last_size = message_size - (nb_blocks << 7);
+		FOR (l, 0, 4) {
+			u8 block[128] = {0};
+			COPY(block, msg[l] + (nb_blocks << 7), last_size);
+			load64_le_buf(ctx[l].input, block, 16);
+			ctx[l].input_idx = last_size;
+			WIPE_BUFFER(block);
+		}
+		kernels->blake2b_compress_x4(lanes, 1);
+
+		FOR (l, 0, nb) {
+			blake2b_output(ctx + l, hashes + (first + l) * hash_size);
+		}
+		FOR (l, 0, 4) {
+			WIPE_CTX(ctx + l);
+		}
+	}
+}
+
+// BLAKE2bp: 4 leaves (fanout 4, depth 2) and a root.  Leaf l hashes
+// bytes [128 l, 128 l + 128) of every 512 byte stripe, and the root
+// hashes the 4 leaf hashes.  Leaves keep their last block pending,
+// like crypto_blake2b_update(), until the next block or the end.
+static void blake2bp_node_init(crypto_blake2b_ctx *ctx, size_t hash_size,
+                               u64 node_offset, u64 node_depth)
+{
+	crypto_blake2b_init(ctx, hash_size);
+	ctx->hash[0] ^= 0x01010000 ^ 0x02040000; // fanout 4, depth 2
+	ctx->hash[1] ^= node_offset;
+	ctx->hash[2] ^= node_depth ^ (64 << 8);  // inner hash size 64
+}
+
+// All 4 leaves at once, in SIMD lanes.
+static void blake2bp_stripes(crypto_blake2b_ctx leaves[4],
+                             const u8 *in, size_t nb_stripes)
+{
+	crypto_blake2b_ctx *lanes[4] = {
+		leaves + 0, leaves + 1, leaves + 2, leaves + 3
+	};
+	FOR (i, 0, nb_stripes) {
+		if (leaves[0].input_idx == 128) {
+			kernels->blake2b_compress_x4(lanes, 0);
+		}
+		FOR (l, 0, 4) {
+			load64_le_buf(leaves[l].input, in + (i << 9) + (l << 7), 16);
+			leaves[l].input_idx = 128;
+		}
+	}
+}
+
+#ifdef MONOCYPHER_THREADS
+// Updates this big or more give each leaf its own thread.
+// Below that, creating the threads costs more than it saves.
+#define BLAKE2BP_THREAD_MIN (1 << 20)
+
+// One leaf, nb_stripes stripes (in points to the leaf's first block).
+static void blake2bp_leaf_update(crypto_blake2b_ctx *leaf,
+                                 const u8 *in, size_t nb_stripes)
+{
+	FOR (i, 0, nb_stripes) {
+		if (leaf->input_idx == 128) {
+			kernels->blake2b_compress(leaf, 0);
+		}
+		load64_le_buf(leaf->input, in + (i << 9), 16);
+		leaf->input_idx = 128;
+	}
+}
+
+typedef struct {
+	crypto_blake2b_ctx *leaf;
+	const u8           *in;
+	size_t              nb_stripes;
+} blake2bp_worker;
+
+static void *blake2bp_work(void *arg)
+{
+	const blake2bp_worker *worker = (const blake2bp_worker*)arg;
+	blake2bp_leaf_update(worker->leaf, worker->in, worker->nb_stripes);
+	return 0;
+}
+
+// Leaf 0 runs in the calling thread, as do the leaves whose thread
+// cannot be created.
+static void blake2bp_stripes_threads(crypto_blake2b_ctx leaves[4],
+                                     const u8 *in, size_t nb_stripes)
+{
+	pthread_t       threads[4];
+	blake2bp_worker workers[4];
+	int             created[4] = {0};
+	FOR (l, 0, 4) {
+		workers[l].leaf       = leaves + l;
+		workers[l].in         = in + (l << 7);
+		workers[l].nb_stripes = nb_stripes;
+	}
+	FOR (l, 1, 4) {
+		created[l] = pthread_create(threads + l, 0, blake2bp_work,
+		                            workers + l) == 0;
+	}
+	FOR (l, 0, 4) {
+		if (!created[l]) {
+			blake2bp_work(workers + l);
+		}
+	}
+	FOR (l, 1, 4) {
+		if (created[l]) {
+			pthread_join(threads[l], 0);
+		}
+	}
+}
+#endif
+
+void crypto_blake2bp_init(crypto_blake2bp_ctx *ctx, size_t hash_size)
+{
+	FOR (l, 0, 4) {
+		blake2bp_node_init(ctx->leaves + l, hash_size, l, 0);
+	}
+	ctx->buf_idx   = 0;
+	ctx->hash_size = hash_size;
+}
+
+void crypto_blake2bp_update(crypto_blake2bp_ctx *ctx,
+                            const u8 *message, size_t message_size)
+{
+	// Avoid undefined NULL pointer increments with empty messages
+	if (message_size == 0) {
+		return;
+	}
+
+	// Complete the buffered stripe
+	if (ctx->buf_idx != 0) {
+		size_t nb_bytes = MIN(512 - ctx->buf_idx, message_size);
+		COPY(ctx->buf + ctx->buf_idx, message, nb_bytes);
+		ctx->buf_idx += nb_bytes;
+		message      += nb_bytes;
+		message_size -= nb_bytes;
+		if (ctx->buf_idx < 512) {
+			return;
+		}
+		blake2bp_stripes(ctx->leaves, ctx->buf, 1);
+		ctx->buf_idx = 0;
+	}
+
+	// Process stripe by stripe, straight from the message
+	size_t nb_stripes = message_size >> 9;
+#ifdef MONOCYPHER_THREADS
+	if (message_size >= BLAKE2BP_THREAD_MIN) {
+		blake2bp_stripes_threads(ctx->leaves, message, nb_stripes);
+	} else
+#endif
+	{
+		blake2bp_stripes(ctx->leaves, message, nb_stripes);
+	}
+	message      += nb_stripes << 9;
+	message_size &= 511;
+
+	// Buffer the rest
+	COPY(ctx->buf, message, message_size);
+	ctx->buf_idx = message_size;
+}
+
+void crypto_blake2bp_final(crypto_blake2bp_ctx *ctx, u8 *hash)
+{
+	crypto_blake2b_ctx root;
+	blake2bp_node_init(&root, ctx->hash_size, 0, 1);
+
+	FOR (l, 0, 4) {
+		// The buffered stripe may give this leaf one more block
+		crypto_blake2b_ctx *leaf  = ctx->leaves + l;
+		size_t              start = l << 7;
+		if (ctx->buf_idx > start) {
+			if (leaf->input_idx == 128) {
+				kernels->blake2b_compress(leaf, 0);
+			}
+			u8     block[128] = {0};
+			size_t size       = MIN(ctx->buf_idx - start, 128);
+			COPY(block, ctx->buf + start, size);
+			load64_le_buf(leaf->input, block, 16);
+			leaf->input_idx = size;
+			WIPE_BUFFER(block);
+		}
+		// Leaf 3 is the last node of its level.
+		// The root always takes all 64 bytes of each leaf hash.
+		u8 leaf_hash[64];
+		kernels->blake2b_compress(leaf, l == 3 ? 3 : 1);
+		store64_le_buf(leaf_hash, leaf->hash, 8);
+		crypto_blake2b_update(&root, leaf_hash, 64);
+		WIPE_BUFFER(leaf_hash);
+	}
+
+	kernels->blake2b_compress(&root, 3); // the root is a last node too
+	blake2b_output(&root, hash);
+	WIPE_CTX(&root);
+	WIPE_CTX(ctx);
+}
+
+void crypto_blake2bp(u8 *hash, size_t hash_size, const u8 *msg, size_t msg_size)
+{
+	crypto_blake2bp_ctx ctx;
+	crypto_blake2bp_init  (&ctx, hash_size);
+	crypto_blake2bp_update(&ctx, msg, msg_size);
+	crypto_blake2bp_final (&ctx, hash);
+}
+
 //////////////
 /// Argon2 ///
 //////////////
 // references to R, Z, Q etc. come from the spec
 
-// Argon2 operates on 1024 byte blocks.
-typedef struct { u64 a[128]; } blk;
-
 // updates a BLAKE2 hash with a 32 bit word, little endian.
 static void blake_update_32(crypto_blake2b_ctx *ctx, u32 input)
 {
@@ -742,165 +2033,281 @@ static void g_rounds(blk *b)
 	}
 }
 
+// Fills current with G(previous, reference), (xored with its old
+// contents if xor_current is set).  tmp is scratch space, left for the
+// caller to wipe.
+static void argon2_fill_scalar(blk *current, const blk *previous,
+                               const blk *reference, blk *tmp,
+                               int xor_current)
+{
+	copy_block(tmp, previous);
+	xor_block (tmp, reference);
+	if (xor_current) { xor_block (current, tmp); }
+	else             { copy_block(current, tmp); }
+	g_rounds  (tmp);
+	xor_block (current, tmp);
+}
+
+#ifdef MONOCYPHER_SIMD
+// AVX2: 4 words per vector, the block is held in 32 vectors.
+// Rounds work on 4 columns at once, with the usual BLAKE2b
+// diagonalisation (lane rotations) in between.
+#define ROTR64_AVX2(x, n)	\
+	_mm256_or_si256(_mm256_srli_epi64(x, n), _mm256_slli_epi64(x, 64 - n))
+#define G_AVX2(a, b, c, d)	\
+	a = _mm256_add_epi64(_mm256_add_epi64(a, b),                        \
+	                     _mm256_add_epi64(_mm256_mul_epu32(a, b),       \
+	                                      _mm256_mul_epu32(a, b)));     \
+	d = _mm256_shuffle_epi32(_mm256_xor_si256(d, a), 0xb1);             \
+	c = _mm256_add_epi64(_mm256_add_epi64(c, d),                        \
+	                     _mm256_add_epi64(_mm256_mul_epu32(c, d),       \
+	                                      _mm256_mul_epu32(c, d)));     \
+	b = _mm256_shuffle_epi8(_mm256_xor_si256(b, c), rot24);             \
+	a = _mm256_add_epi64(_mm256_add_epi64(a, b),                        \
+	                     _mm256_add_epi64(_mm256_mul_epu32(a, b),       \
+	                                      _mm256_mul_epu32(a, b)));     \
+	d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot16);             \
+	c = _mm256_add_epi64(_mm256_add_epi64(c, d),                        \
+	                     _mm256_add_epi64(_mm256_mul_epu32(c, d),       \
+	                                      _mm256_mul_epu32(c, d)));     \
+	b = _mm256_xor_si256(b, c);                                         \
+	b = _mm256_or_si256(_mm256_srli_epi64(b, 63), _mm256_add_epi64(b, b))
+
+// a, b, c, d each hold 4 words of the same row: G on the 4 columns,
+// then on the 4 diagonals.
+#define ROUND_AVX2(a, b, c, d)	\
+	G_AVX2(a, b, c, d);                       \
+	b = _mm256_permute4x64_epi64(b, 0x39);    \
+	c = _mm256_permute4x64_epi64(c, 0x4e);    \
+	d = _mm256_permute4x64_epi64(d, 0x93);    \
+	G_AVX2(a, b, c, d);                       \
+	b = _mm256_permute4x64_epi64(b, 0x93);    \
+	c = _mm256_permute4x64_epi64(c, 0x4e);    \
+	d = _mm256_permute4x64_epi64(d, 0x39)
+
+TARGET("avx2")
+static void g_rounds_avx2(__m256i v[32])
+{
+	const __m256i rot24 = _mm256_setr_epi8(
+		3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+		3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+	const __m256i rot16 = _mm256_setr_epi8(
+		2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+		2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+
+	// column rounds: words 16i..16i+15 are vectors 4i..4i+3
+	FOR (i, 0, 8) {
+		ROUND_AVX2(v[4*i], v[4*i + 1], v[4*i + 2], v[4*i + 3]);
+	}
+	// row rounds: words (i, i+1, i+16, i+17) + 32k, for even i < 16,
+	// gathered from the 128-bit halves of vectors i/4 + 8k and
+	// i/4 + 8k + 4.
+	FOR (q, 0, 4) {
+		__m256i r[2][4];
+		FOR (k, 0, 4) {
+			__m256i lo = v[q + 8*k    ];
+			__m256i hi = v[q + 8*k + 4];
+			r[0][k] = _mm256_permute2x128_si256(lo, hi, 0x20);
+			r[1][k] = _mm256_permute2x128_si256(lo, hi, 0x31);
+		}
+		ROUND_AVX2(r[0][0], r[0][1], r[0][2], r[0][3]);
+		ROUND_AVX2(r[1][0], r[1][1], r[1][2], r[1][3]);
+		FOR (k, 0, 4) {
+			v[q + 8*k    ] = _mm256_permute2x128_si256(r[0][k], r[1][k], 0x20);
+			v[q + 8*k + 4] = _mm256_permute2x128_si256(r[0][k], r[1][k], 0x31);
+		}
+	}
+}
+
+TARGET("avx2")
+static void argon2_fill_avx2(blk *current, const blk *previous,
+                             const blk *reference, blk *tmp,
+                             int xor_current)
+{
+	__m256i       *c = (__m256i*)current->a;
+	const __m256i *p = (const __m256i*)previous->a;
+	const __m256i *r = (const __m256i*)reference->a;
+	__m256i       *t = (__m256i*)tmp->a;
+	__m256i        v[32];
+	FOR (i, 0, 32) {
+		v[i] = _mm256_xor_si256(_mm256_loadu_si256(p + i),
+		                        _mm256_loadu_si256(r + i));
+		_mm256_storeu_si256(t + i, v[i]);
+	}
+	g_rounds_avx2(v);
+	FOR (i, 0, 32) {
+		__m256i z = _mm256_xor_si256(v[i], _mm256_loadu_si256(t + i));
+		if (xor_current) {
+			z = _mm256_xor_si256(z, _mm256_loadu_si256(c + i));
+		}
+		_mm256_storeu_si256(c + i, z);
+	}
+	_mm256_zeroall();
+}
+#endif // MONOCYPHER_SIMD
+
 const crypto_argon2_extras crypto_argon2_no_extras = { 0, 0, 0, 0 };
 
-void crypto_argon2(u8 *hash, u32 hash_size, void *work_area,
-                   crypto_argon2_config config,
-                   crypto_argon2_inputs inputs,
-                   crypto_argon2_extras extras)
+// Geometry of the work area, shared by all segments.
+typedef struct {
+	blk *blocks;
+	crypto_argon2_config config;
+	u32  segment_size;
+	u32  lane_size;
+	u32  nb_blocks;
+} argon2_area;
+
+static void argon2_init(argon2_area *area, u32 hash_size, void *work_area,
+                        crypto_argon2_config config,
+                        crypto_argon2_inputs inputs,
+                        crypto_argon2_extras extras)
 {
-	const u32 segment_size = config.nb_blocks / config.nb_lanes / 4;
-	const u32 lane_size    = segment_size * 4;
-	const u32 nb_blocks    = lane_size * config.nb_lanes; // rounding down
+	area->config       = config;
+	area->segment_size = config.nb_blocks / config.nb_lanes / 4;
+	area->lane_size    = area->segment_size * 4;
+	area->nb_blocks    = area->lane_size * config.nb_lanes; // rounding down
 
 	// work area seen as blocks (must be suitably aligned)
-	blk *blocks = (blk*)work_area;
-	{
-		u8 initial_hash[72]; // 64 bytes plus 2 words for future hashes
-		crypto_blake2b_ctx ctx;
-		crypto_blake2b_init (&ctx, 64);
-		blake_update_32     (&ctx, config.nb_lanes ); // p: number of "threads"
-		blake_update_32     (&ctx, hash_size);
-		blake_update_32     (&ctx, config.nb_blocks);
-		blake_update_32     (&ctx, config.nb_passes);
-		blake_update_32     (&ctx, 0x13);             // v: version number
-		blake_update_32     (&ctx, config.algorithm); // y: Argon2i, Argon2d...
-		blake_update_32_buf (&ctx, inputs.pass, inputs.pass_size);
-		blake_update_32_buf (&ctx, inputs.salt, inputs.salt_size);
-		blake_update_32_buf (&ctx, extras.key,  extras.key_size);
-		blake_update_32_buf (&ctx, extras.ad,   extras.ad_size);
-		crypto_blake2b_final(&ctx, initial_hash); // fill 64 first bytes only
-
-		// fill first 2 blocks of each lane
-		u8 hash_area[1024];
-		FOR_T(u32, l, 0, config.nb_lanes) {
-			FOR_T(u32, i, 0, 2) {
-				store32_le(initial_hash + 64, i); // first  additional word
-				store32_le(initial_hash + 68, l); // second additional word
-				extended_hash(hash_area, 1024, initial_hash, 72);
-				load64_le_buf(blocks[l * lane_size + i].a, hash_area, 128);
-			}
-		}
+	area->blocks = (blk*)work_area;
 
-		WIPE_BUFFER(initial_hash);
-		WIPE_BUFFER(hash_area);
+	u8 initial_hash[72]; // 64 bytes plus 2 words for future hashes
+	crypto_blake2b_ctx ctx;
+	crypto_blake2b_init (&ctx, 64);
+	blake_update_32     (&ctx, config.nb_lanes ); // p: number of "threads"
+	blake_update_32     (&ctx, hash_size);
+	blake_update_32     (&ctx, config.nb_blocks);
+	blake_update_32     (&ctx, config.nb_passes);
+	blake_update_32     (&ctx, 0x13);             // v: version number
+	blake_update_32     (&ctx, config.algorithm); // y: Argon2i, Argon2d...
+	blake_update_32_buf (&ctx, inputs.pass, inputs.pass_size);
+	blake_update_32_buf (&ctx, inputs.salt, inputs.salt_size);
+	blake_update_32_buf (&ctx, extras.key,  extras.key_size);
+	blake_update_32_buf (&ctx, extras.ad,   extras.ad_size);
+	crypto_blake2b_final(&ctx, initial_hash); // fill 64 first bytes only
+
+	// fill first 2 blocks of each lane
+	u8 hash_area[1024];
+	FOR_T(u32, l, 0, config.nb_lanes) {
+		FOR_T(u32, i, 0, 2) {
+			store32_le(initial_hash + 64, i); // first  additional word
+			store32_le(initial_hash + 68, l); // second additional word
+			extended_hash(hash_area, 1024, initial_hash, 72);
+			load64_le_buf(area->blocks[l * area->lane_size + i].a,
+			              hash_area, 128);
+		}
 	}
 
-	// Argon2i and Argon2id start with constant time indexing
-	int constant_time = config.algorithm != CRYPTO_ARGON2_D;
+	WIPE_BUFFER(initial_hash);
+	WIPE_BUFFER(hash_area);
+}
 
-	// Fill (and re-fill) the rest of the blocks
-	//
-	// Note: even though each segment within the same slice can be
-	// computed in parallel, (one thread per lane), we are computing
-	// them sequentially, because Monocypher doesn't support threads.
-	//
-	// Yet optimal performance (and therefore security) requires one
-	// thread per lane. The only reason Monocypher supports multiple
-	// lanes is compatibility.
-	blk tmp;
-	FOR_T(u32, pass, 0, config.nb_passes) {
-		FOR_T(u32, slice, 0, 4) {
-			// On the first slice of the first pass,
-			// blocks 0 and 1 are already filled, hence pass_offset.
-			u32 pass_offset  = pass == 0 && slice == 0 ? 2 : 0;
-			u32 slice_offset = slice * segment_size;
-
-			// Argon2id switches back to non-constant time indexing
-			// after the first two slices of the first pass
-			if (slice == 2 && config.algorithm == CRYPTO_ARGON2_ID) {
-				constant_time = 0;
-			}
+// Fills one segment.  Segments of the same slice only read blocks
+// from the other slices and from themselves: they can be filled in
+// parallel, (one thread per lane).  All segments must be fully
+// completed before we start filling the next slice.
+static void argon2_fill_segment(const argon2_area *area,
+                                u32 pass, u32 slice, u32 segment)
+{
+	const crypto_argon2_config config = area->config;
+	const u32 segment_size = area->segment_size;
+	const u32 lane_size    = area->lane_size;
+	blk      *blocks       = area->blocks;
+
+	// Argon2i and Argon2id start with constant time indexing.
+	// Argon2id switches back to non-constant time indexing
+	// after the first two slices of the first pass
+	int constant_time =
+		config.algorithm == CRYPTO_ARGON2_I ||
+		(config.algorithm == CRYPTO_ARGON2_ID && pass == 0 && slice < 2);
+
+	// On the first slice of the first pass,
+	// blocks 0 and 1 are already filled, hence pass_offset.
+	u32 pass_offset  = pass == 0 && slice == 0 ? 2 : 0;
+	u32 slice_offset = slice * segment_size;
 
-			// Each iteration of the following loop may be performed in
-			// a separate thread.  All segments must be fully completed
-			// before we start filling the next slice.
-			FOR_T(u32, segment, 0, config.nb_lanes) {
-				blk index_block;
-				u32 index_ctr = 1;
-				FOR_T (u32, block, pass_offset, segment_size) {
-					// Current and previous blocks
-					u32  lane_offset   = segment * lane_size;
-					blk *segment_start = blocks + lane_offset + slice_offset;
-					blk *current       = segment_start + block;
-					blk *previous      =
-						block == 0 && slice_offset == 0
-						? segment_start + lane_size - 1
-						: segment_start + block - 1;
-
-					u64 index_seed;
-					if (constant_time) {
-						if (block == pass_offset || (block % 128) == 0) {
-							// Fill or refresh deterministic indices block
-
-							// seed the beginning of the block...
-							ZERO(index_block.a, 128);
-							index_block.a[0] = pass;
-							index_block.a[1] = segment;
-							index_block.a[2] = slice;
-							index_block.a[3] = nb_blocks;
-							index_block.a[4] = config.nb_passes;
-							index_block.a[5] = config.algorithm;
-							index_block.a[6] = index_ctr;
-							index_ctr++;
-
-							// ... then shuffle it
-							copy_block(&tmp, &index_block);
-							g_rounds  (&index_block);
-							xor_block (&index_block, &tmp);
-							copy_block(&tmp, &index_block);
-							g_rounds  (&index_block);
-							xor_block (&index_block, &tmp);
-						}
-						index_seed = index_block.a[block % 128];
-					} else {
-						index_seed = previous->a[0];
-					}
-
-					// Establish the reference set.  *Approximately* comprises:
-					// - The last 3 slices (if they exist yet)
-					// - The already constructed blocks in the current segment
-					u32 next_slice   = ((slice + 1) % 4) * segment_size;
-					u32 window_start = pass == 0 ? 0     : next_slice;
-					u32 nb_segments  = pass == 0 ? slice : 3;
-					u64 lane         =
-						pass == 0 && slice == 0
-						? segment
-						: (index_seed >> 32) % config.nb_lanes;
-					u32 window_size  =
-						nb_segments * segment_size +
-						(lane  == segment ? block-1 :
-						 block == 0       ? (u32)-1 : 0);
-
-					// Find reference block
-					u64  j1        = index_seed & 0xffffffff; // block selector
-					u64  x         = (j1 * j1)         >> 32;
-					u64  y         = (window_size * x) >> 32;
-					u64  z         = (window_size - 1) - y;
-					u64  ref       = (window_start + z) % lane_size;
-					u32  index     = lane * lane_size + (u32)ref;
-					blk *reference = blocks + index;
-
-					// Shuffle the previous & reference block
-					// into the current block
-					copy_block(&tmp, previous);
-					xor_block (&tmp, reference);
-					if (pass == 0) { copy_block(current, &tmp); }
-					else           { xor_block (current, &tmp); }
-					g_rounds  (&tmp);
-					xor_block (current, &tmp);
-				}
+	blk tmp;
+	blk index_block;
+	u32 index_ctr = 1;
+	FOR_T (u32, block, pass_offset, segment_size) {
+		// Current and previous blocks
+		u32  lane_offset   = segment * lane_size;
+		blk *segment_start = blocks + lane_offset + slice_offset;
+		blk *current       = segment_start + block;
+		blk *previous      =
+			block == 0 && slice_offset == 0
+			? segment_start + lane_size - 1
+			: segment_start + block - 1;
+
+		u64 index_seed;
+		if (constant_time) {
+			if (block == pass_offset || (block % 128) == 0) {
+				// Fill or refresh deterministic indices block
+
+				// seed the beginning of the block...
+				ZERO(index_block.a, 128);
+				index_block.a[0] = pass;
+				index_block.a[1] = segment;
+				index_block.a[2] = slice;
+				index_block.a[3] = area->nb_blocks;
+				index_block.a[4] = config.nb_passes;
+				index_block.a[5] = config.algorithm;
+				index_block.a[6] = index_ctr;
+				index_ctr++;
+
+				// ... then shuffle it
+				copy_block(&tmp, &index_block);
+				g_rounds  (&index_block);
+				xor_block (&index_block, &tmp);
+				copy_block(&tmp, &index_block);
+				g_rounds  (&index_block);
+				xor_block (&index_block, &tmp);
 			}
+			index_seed = index_block.a[block % 128];
+		} else {
+			index_seed = previous->a[0];
 		}
+
+		// Establish the reference set.  *Approximately* comprises:
+		// - The last 3 slices (if they exist yet)
+		// - The already constructed blocks in the current segment
+		u32 next_slice   = ((slice + 1) % 4) * segment_size;
+		u32 window_start = pass == 0 ? 0     : next_slice;
+		u32 nb_segments  = pass == 0 ? slice : 3;
+		u64 lane         =
+			pass == 0 && slice == 0
+			? segment
+			: (index_seed >> 32) % config.nb_lanes;
+		u32 window_size  =
+			nb_segments * segment_size +
+			(lane  == segment ? block-1 :
+			 block == 0       ? (u32)-1 : 0);
+
+		// Find reference block
+		u64  j1        = index_seed & 0xffffffff; // block selector
+		u64  x         = (j1 * j1)         >> 32;
+		u64  y         = (window_size * x) >> 32;
+		u64  z         = (window_size - 1) - y;
+		u64  ref       = (window_start + z) % lane_size;
+		u32  index     = lane * lane_size + (u32)ref;
+		blk *reference = blocks + index;
+
+		// Shuffle the previous & reference block
+		// into the current block
+		kernels->argon2_fill(current, previous, reference, &tmp, pass != 0);
 	}
 
 	// Wipe temporary block
 	volatile u64* p = tmp.a;
 	ZERO(p, 128);
+}
+
+static void argon2_final(argon2_area *area, u8 *hash, u32 hash_size)
+{
+	const u32 lane_size = area->lane_size;
 
 	// XOR last blocks of each lane
-	blk *last_block = blocks + lane_size - 1;
-	FOR_T (u32, lane, 1, config.nb_lanes) {
+	blk *last_block = area->blocks + lane_size - 1;
+	FOR_T (u32, lane, 1, area->config.nb_lanes) {
 		blk *next_block = last_block + lane_size;
 		xor_block(next_block, last_block);
 		last_block = next_block;
@@ -911,14 +2318,126 @@ void crypto_argon2(u8 *hash, u32 hash_size, void *work_area,
 	store64_le_buf(final_block, last_block->a, 128);
 
 	// Wipe work area
-	p = (u64*)work_area;
-	ZERO(p, 128 * nb_blocks);
+	volatile u64 *p = (u64*)area->blocks;
+	ZERO(p, 128 * area->nb_blocks);
 
 	// Hash the very last block with H' into the output hash
 	extended_hash(hash, hash_size, final_block, 1024);
 	WIPE_BUFFER(final_block);
 }
 
+void crypto_argon2(u8 *hash, u32 hash_size, void *work_area,
+                   crypto_argon2_config config,
+                   crypto_argon2_inputs inputs,
+                   crypto_argon2_extras extras)
+{
+	argon2_area area;
+	argon2_init(&area, hash_size, work_area, config, inputs, extras);
+
+	// Fill (and re-fill) the rest of the blocks, one segment after
+	// the other.  See crypto_argon2_parallel() for the threaded
+	// version.
+	FOR_T(u32, pass, 0, config.nb_passes) {
+		FOR_T(u32, slice, 0, 4) {
+			FOR_T(u32, segment, 0, config.nb_lanes) {
+				argon2_fill_segment(&area, pass, slice, segment);
+			}
+		}
+	}
+
+	argon2_final(&area, hash, hash_size);
+}
+
+#ifdef MONOCYPHER_THREADS
+// One thread per lane (up to ARGON2_MAX_THREADS, lanes are then
+// shared round robin).  The calling thread is worker 0.  All workers
+// meet at a barrier after each slice.
+#define ARGON2_MAX_THREADS 16
+
+typedef struct {
+	const argon2_area *area;
+	pthread_barrier_t  barrier;
+	pthread_mutex_t    start;      // held until all threads are created
+	u32                nb_workers;
+} argon2_pool;
+
+typedef struct {
+	argon2_pool *pool;
+	u32          id;
+} argon2_worker;
+
+static void *argon2_work(void *arg)
+{
+	const argon2_worker *worker = (const argon2_worker*)arg;
+	argon2_pool         *pool   = worker->pool;
+
+	// Wait for the creation of the other threads
+	pthread_mutex_lock  (&pool->start);
+	pthread_mutex_unlock(&pool->start);
+
+	const crypto_argon2_config config = pool->area->config;
+	FOR_T(u32, pass, 0, config.nb_passes) {
+		FOR_T(u32, slice, 0, 4) {
+			for (u32 segment = worker->id;
+			     segment < config.nb_lanes;
+			     segment += pool->nb_workers) {
+				argon2_fill_segment(pool->area, pass, slice, segment);
+			}
+			pthread_barrier_wait(&pool->barrier);
+		}
+	}
+	return 0;
+}
+#endif
+
+void crypto_argon2_parallel(u8 *hash, u32 hash_size, void *work_area,
+                            crypto_argon2_config config,
+                            crypto_argon2_inputs inputs,
+                            crypto_argon2_extras extras)
+{
+#ifdef MONOCYPHER_THREADS
+	argon2_area area;
+	argon2_init(&area, hash_size, work_area, config, inputs, extras);
+
+	argon2_pool pool;
+	pool.area = &area;
+	pthread_mutex_init(&pool.start, 0);
+	pthread_mutex_lock(&pool.start);
+
+	// If some threads cannot be created, the remaining ones
+	// (at least the calling thread) take their lanes.
+	pthread_t     threads[ARGON2_MAX_THREADS];
+	argon2_worker workers[ARGON2_MAX_THREADS];
+	u32 nb_threads = MIN(config.nb_lanes, ARGON2_MAX_THREADS);
+	u32 nb_workers = 1;
+	while (nb_workers < nb_threads) {
+		workers[nb_workers].pool = &pool;
+		workers[nb_workers].id   = nb_workers;
+		if (pthread_create(threads + nb_workers, 0, argon2_work,
+		                   workers + nb_workers) != 0) {
+			break;
+		}
+		nb_workers++;
+	}
+	pool.nb_workers = nb_workers;
+	pthread_barrier_init(&pool.barrier, 0, nb_workers);
+	pthread_mutex_unlock(&pool.start);
+
+	workers[0].pool = &pool;
+	workers[0].id   = 0;
+	argon2_work(workers + 0);
+	FOR_T(u32, i, 1, nb_workers) {
+		pthread_join(threads[i], 0);
+	}
+	pthread_barrier_destroy(&pool.barrier);
+	pthread_mutex_destroy(&pool.start);
+
+	argon2_final(&area, hash, hash_size);
+#else
+	crypto_argon2(hash, hash_size, work_area, config, inputs, extras);
+#endif
+}
+
 ////////////////////////////////////
 /// Arithmetic modulo 2^255 - 19 ///
 ////////////////////////////////////
@@ -1447,43 +2966,278 @@ static int invsqrt(fe isr, const fe x)
 	return p1 | m1 | z0;
 }
 
-// Inverse in terms of inverse square root.
-// Requires two additional squarings to get rid of the sign.
-//
-//   1/x = x * (+invsqrt(x^2))^2
-//       = x * (-invsqrt(x^2))^2
-//
-// A fully optimised exponentiation by p-1 would save 6 field
-// multiplications, but it would require more code.
-static void fe_invert(fe out, const fe x)
+// Inverse in terms of inverse square root.
+// Requires two additional squarings to get rid of the sign.
+//
+//   1/x = x * (+invsqrt(x^2))^2
+//       = x * (-invsqrt(x^2))^2
+//
+// A fully optimised exponentiation by p-1 would save 6 field
+// multiplications, but it would require more code.
+static void fe_invert(fe out, const fe x)
+{
+	fe tmp;
+	fe_sq(tmp, x);
+	invsqrt(tmp, tmp);
+	fe_sq(tmp, tmp);
+	fe_mul(out, tmp, x);
+	WIPE_BUFFER(tmp);
+}
+
+// trim a scalar for scalar multiplication
+void crypto_eddsa_trim_scalar(u8 out[32], const u8 in[32])
+{
+	COPY(out, in, 32);
+	out[ 0] &= 248;
+	out[31] &= 127;
+	out[31] |= 64;
+}
+
+// get bit from scalar at position i
+static int scalar_bit(const u8 s[32], int i)
+{
+	if (i < 0) { return 0; } // handle -1 for sliding windows
+	return (s[i>>3] >> (i&7)) & 1;
+}
+
+///////////////
+/// X-25519 /// Taken from SUPERCOP's ref10 implementation.
+///////////////
+#ifdef __SIZEOF_INT128__
+// Radix 2^51 field elements, for the Montgomery ladder only: 5 limbs
+// and 128 bit products instead of 10 limbs and 64 bit products.
+// (The rest of the curve code, and its precomputed tables, stay in
+// radix 2^25.5.)
+//
+// Limbs are unsigned.  Carried limbs are below 2^51 (plus a small
+// carry in h[1]).  Differences add 8*p to stay positive, so they can
+// subtract up to 2^54, and give up to 2^54 more.  fe51_mul() and
+// fe51_sq() accept limbs up to 2^56.
+typedef u64 fe51[5];
+#define MASK51 (((u64)1 << 51) - 1)
+
+// ignores the most significant bit, like fe_frombytes()
+static void fe51_frombytes(fe51 h, const u8 s[32])
+{
+	h[0] =  load64_le(s     )        & MASK51;
+	h[1] = (load64_le(s +  6) >>  3) & MASK51;
+	h[2] = (load64_le(s + 12) >>  6) & MASK51;
+	h[3] = (load64_le(s + 19) >>  1) & MASK51;
+	h[4] = (load64_le(s + 24) >> 12) & MASK51;
+}
+
+static void fe51_tobytes(u8 s[32], const fe51 h)
+{
+	u64 t[5];
+	COPY(t, h, 5);
+	FOR (i, 0, 4) {
+		t[i+1] += t[i] >> 51;
+		t[i  ] &= MASK51;
+	}
+	t[0] += 19 * (t[4] >> 51);
+	t[4] &= MASK51;
+	// t < 2^255 + 2^51 (t[1] may still hold a carry)
+
+	// q = 1 iff t >= p.  Subtracting q * p fully reduces t.
+	u64 q = (t[0] + 19) >> 51;
+	FOR (i, 1, 5) {
+		q = (t[i] + q) >> 51;
+	}
+	t[0] += 19 * q;
+	FOR (i, 0, 4) {
+		t[i+1] += t[i] >> 51;
+		t[i  ] &= MASK51;
+	}
+	t[4] &= MASK51; // removes q * 2^255
+
+	store64_le(s +  0, (t[0]      ) | (t[1] << 51));
+	store64_le(s +  8, (t[1] >> 13) | (t[2] << 38));
+	store64_le(s + 16, (t[2] >> 26) | (t[3] << 25));
+	store64_le(s + 24, (t[3] >> 39) | (t[4] << 12));
+	WIPE_BUFFER(t);
+}
+
+static void fe51_1   (fe51 h){ h[0] = 1; ZERO(h+1, 4);                     }
+static void fe51_0   (fe51 h){ ZERO(h, 5);                                 }
+static void fe51_copy(fe51 h, const fe51 f){ FOR(i,0,5) h[i] = f[i];       }
+static void fe51_add (fe51 h, const fe51 f, const fe51 g)
+{
+	FOR (i, 0, 5) { h[i] = f[i] + g[i]; }
+}
+static void fe51_sub (fe51 h, const fe51 f, const fe51 g)
+{
+	// 8*p = 2^258 - 152
+	h[0] = f[0] + 0x3fffffffffff68 - g[0];
+	FOR (i, 1, 5) { h[i] = f[i] + 0x3ffffffffffff8 - g[i]; }
+}
+static void fe51_neg (fe51 h, const fe51 f)
+{
+	fe51 zero = {0};
+	fe51_sub(h, zero, f);
+}
+
+static void fe51_cswap(fe51 f, fe51 g, int b)
+{
+	u64 mask = (u64)0 - (u64)b;
+	FOR (i, 0, 5) {
+		u64 x = (f[i] ^ g[i]) & mask;
+		f[i] = f[i] ^ x;
+		g[i] = g[i] ^ x;
+	}
+}
+
+static void fe51_ccopy(fe51 f, const fe51 g, int b)
+{
+	u64 mask = (u64)0 - (u64)b;
+	FOR (i, 0, 5) {
+		u64 x = (f[i] ^ g[i]) & mask;
+		f[i] = f[i] ^ x;
+	}
+}
+
+// With limbs below 2^56, t0 < 2^119 and t4 < 2^115.  Carries stay
+// in 128 bits, and h[1] ends up below 2^51 + 2^17.
+#define FE51_CARRY	\
+	t1 += t0 >> 51;  t2 += t1 >> 51;  t3 += t2 >> 51;  t4 += t3 >> 51; \
+	t0  = ((u64)t0 & MASK51) + (t4 >> 51) * 19; \
+	h[0] = (u64)t0 & MASK51; \
+	h[1] = ((u64)t1 & MASK51) + (u64)(t0 >> 51); \
+	h[2] = (u64)t2 & MASK51; \
+	h[3] = (u64)t3 & MASK51; \
+	h[4] = (u64)t4 & MASK51
+
+static void fe51_mul(fe51 h, const fe51 f, const fe51 g)
+{
+	u64 f0 = f[0];  u64 f1 = f[1];  u64 f2 = f[2];  u64 f3 = f[3];  u64 f4 = f[4];
+	u64 g0 = g[0];  u64 g1 = g[1];  u64 g2 = g[2];  u64 g3 = g[3];  u64 g4 = g[4];
+	u64 G1 = g1*19; u64 G2 = g2*19; u64 G3 = g3*19; u64 G4 = g4*19;
+
+	u128 t0 = (u128)f0*g0 + (u128)f1*G4 + (u128)f2*G3 + (u128)f3*G2 + (u128)f4*G1;
+	u128 t1 = (u128)f0*g1 + (u128)f1*g0 + (u128)f2*G4 + (u128)f3*G3 + (u128)f4*G2;
+	u128 t2 = (u128)f0*g2 + (u128)f1*g1 + (u128)f2*g0 + (u128)f3*G4 + (u128)f4*G3;
+	u128 t3 = (u128)f0*g3 + (u128)f1*g2 + (u128)f2*g1 + (u128)f3*g0 + (u128)f4*G4;
+	u128 t4 = (u128)f0*g4 + (u128)f1*g3 + (u128)f2*g2 + (u128)f3*g1 + (u128)f4*g0;
+	FE51_CARRY;
+}
+
+static void fe51_sq(fe51 h, const fe51 f)
+{
+	u64 f0   = f[0];    u64 f1   = f[1];    u64 f2 = f[2];  u64 f3 = f[3];  u64 f4 = f[4];
+	u64 f0_2 = f0*2;    u64 f1_2 = f1*2;    u64 f2_2 = f2*2;
+	u64 f3_19 = f3*19;  u64 f4_19 = f4*19;
+
+	u128 t0 = (u128)f0  *f0    + (u128)f1_2*f4_19 + (u128)f2_2*f3_19;
+	u128 t1 = (u128)f0_2*f1    + (u128)f2_2*f4_19 + (u128)f3  *f3_19;
+	u128 t2 = (u128)f0_2*f2    + (u128)f1  *f1    + (u128)(f3*2)*f4_19;
+	u128 t3 = (u128)f0_2*f3    + (u128)f1_2*f2    + (u128)f4  *f4_19;
+	u128 t4 = (u128)f0_2*f4    + (u128)f1_2*f3    + (u128)f2  *f2;
+	FE51_CARRY;
+}
+
+static void fe51_mul_small(fe51 h, const fe51 f, u32 g)
 {
-	fe tmp;
-	fe_sq(tmp, x);
-	invsqrt(tmp, tmp);
-	fe_sq(tmp, tmp);
-	fe_mul(out, tmp, x);
-	WIPE_BUFFER(tmp);
+	u128 t0 = (u128)f[0] * g;  u128 t1 = (u128)f[1] * g;
+	u128 t2 = (u128)f[2] * g;  u128 t3 = (u128)f[3] * g;
+	u128 t4 = (u128)f[4] * g;
+	FE51_CARRY;
 }
 
-// trim a scalar for scalar multiplication
-void crypto_eddsa_trim_scalar(u8 out[32], const u8 in[32])
+// h = f^(2^n)
+static void fe51_sqn(fe51 h, const fe51 f, int n)
 {
-	COPY(out, in, 32);
-	out[ 0] &= 248;
-	out[31] &= 127;
-	out[31] |= 64;
+	fe51_sq(h, f);
+	FOR (i, 1, (size_t)n) { fe51_sq(h, h); }
 }
 
-// get bit from scalar at position i
-static int scalar_bit(const u8 s[32], int i)
+// 1/x = x^(p-2), with the usual addition chain
+static void fe51_invert(fe51 out, const fe51 x)
 {
-	if (i < 0) { return 0; } // handle -1 for sliding windows
-	return (s[i>>3] >> (i&7)) & 1;
+	fe51 z2, z9, z11, t0, t1, t2;
+	fe51_sq (z2, x);
+	fe51_sqn(t0, z2, 2);
+	fe51_mul(z9, t0, x);
+	fe51_mul(z11, z9, z2);
+	fe51_sq (t0, z11);
+	fe51_mul(t0, t0, z9);         // 2^5   - 2^0
+	fe51_sqn(t1, t0, 5);
+	fe51_mul(t0, t1, t0);         // 2^10  - 2^0
+	fe51_sqn(t1, t0, 10);
+	fe51_mul(t1, t1, t0);         // 2^20  - 2^0
+	fe51_sqn(t2, t1, 20);
+	fe51_mul(t1, t2, t1);         // 2^40  - 2^0
+	fe51_sqn(t1, t1, 10);
+	fe51_mul(t0, t1, t0);         // 2^50  - 2^0
+	fe51_sqn(t1, t0, 50);
+	fe51_mul(t1, t1, t0);         // 2^100 - 2^0
+	fe51_sqn(t2, t1, 100);
+	fe51_mul(t1, t2, t1);         // 2^200 - 2^0
+	fe51_sqn(t1, t1, 50);
+	fe51_mul(t0, t1, t0);         // 2^250 - 2^0
+	fe51_sqn(t0, t0, 5);
+	fe51_mul(out, t0, z11);       // 2^255 - 21
+	WIPE_BUFFER(z2);  WIPE_BUFFER(z9);  WIPE_BUFFER(z11);
+	WIPE_BUFFER(t0);  WIPE_BUFFER(t1);  WIPE_BUFFER(t2);
 }
 
-///////////////
-/// X-25519 /// Taken from SUPERCOP's ref10 implementation.
-///////////////
+static void scalarmult(u8 q[32], const u8 scalar[32], const u8 p[32],
+                       int nb_bits)
+{
+	// computes the scalar product
+	fe51 x1;
+	fe51_frombytes(x1, p);
+
+	// computes the actual scalar product (the result is in x2 and z2)
+	fe51 x2, z2, x3, z3, t0, t1;
+	// Montgomery ladder
+	// In projective coordinates, to avoid divisions: x = X / Z
+	// We don't care about the y coordinate, it's only 1 bit of information
+	fe51_1(x2);        fe51_0(z2); // "zero" point
+	fe51_copy(x3, x1); fe51_1(z3); // "one"  point
+	int swap = 0;
+	for (int pos = nb_bits-1; pos >= 0; --pos) {
+		// constant time conditional swap before ladder step
+		int b = scalar_bit(scalar, pos);
+		swap ^= b; // xor trick avoids swapping at the end of the loop
+		fe51_cswap(x2, x3, swap);
+		fe51_cswap(z2, z3, swap);
+		swap = b;  // anticipates one last swap after the loop
+
+		// Montgomery ladder step: replaces (P2, P3) by (P2*2, P2+P3)
+		// with differential addition
+		fe51_sub(t0, x3, z3);
+		fe51_sub(t1, x2, z2);
+		fe51_add(x2, x2, z2);
+		fe51_add(z2, x3, z3);
+		fe51_mul(z3, t0, x2);
+		fe51_mul(z2, z2, t1);
+		fe51_sq (t0, t1    );
+		fe51_sq (t1, x2    );
+		fe51_add(x3, z3, z2);
+		fe51_sub(z2, z3, z2);
+		fe51_mul(x2, t1, t0);
+		fe51_sub(t1, t1, t0);
+		fe51_sq (z2, z2    );
+		fe51_mul_small(z3, t1, 121666);
+		fe51_sq (x3, x3    );
+		fe51_add(t0, t0, z3);
+		fe51_mul(z3, x1, z2);
+		fe51_mul(z2, t1, t0);
+	}
+	// last swap is necessary to compensate for the xor trick
+	// Note: after this swap, P3 == P2 + P1.
+	fe51_cswap(x2, x3, swap);
+	fe51_cswap(z2, z3, swap);
+
+	// normalises the coordinates: x == X / Z
+	fe51_invert(z2, z2);
+	fe51_mul(x2, x2, z2);
+	fe51_tobytes(q, x2);
+
+	WIPE_BUFFER(x1);
+	WIPE_BUFFER(x2);  WIPE_BUFFER(z2);  WIPE_BUFFER(t0);
+	WIPE_BUFFER(x3);  WIPE_BUFFER(z3);  WIPE_BUFFER(t1);
+}
+#else
 static void scalarmult(u8 q[32], const u8 scalar[32], const u8 p[32],
                        int nb_bits)
 {
@@ -1542,6 +3296,7 @@ static void scalarmult(u8 q[32], const u8 scalar[32], const u8 p[32],
 	WIPE_BUFFER(x2);  WIPE_BUFFER(z2);  WIPE_BUFFER(t0);
 	WIPE_BUFFER(x3);  WIPE_BUFFER(z3);  WIPE_BUFFER(t1);
 }
+#endif // __SIZEOF_INT128__
 
 void crypto_x25519(u8       raw_shared_secret[32],
                    const u8 your_secret_key  [32],
@@ -1554,11 +3309,338 @@ void crypto_x25519(u8       raw_shared_secret[32],
 	WIPE_BUFFER(e);
 }
 
-void crypto_x25519_public_key(u8       public_key[32],
-                              const u8 secret_key[32])
+//////////////////////
+/// Batch X25519 ///
+//////////////////////
+static void x25519_x4_scalar(u8 q[4][32], const u8 scalar[4][32],
+                             const u8 p[4][32])
+{
+	FOR (i, 0, 4) {
+		scalarmult(q[i], scalar[i], p[i], 255);
+	}
+}
+
+#ifdef MONOCYPHER_SIMD
+// Four independent ladders, one per 64-bit lane.  Limbs are unsigned,
+// in radix 2^25.5, so that every product fits _mm256_mul_epu32().
+//
+// Carried limbs are below 2^26 (even) or 2^25 + 2^17 (odd).  Sums of
+// two carried elements are below 2^27, and differences (which add 2p
+// to stay positive) below 1.5 * 2^27.  Either can be multiplied:
+// 19 * 1.5 * 2^27 < 2^32, and each 64-bit accumulator stays below
+// 10 * 2^28.6 * 2^31.9 < 2^64.
+typedef u64 u64x4 __attribute__((vector_size(32)));
+typedef u64x4 fe4[10];
+
+#define MUL4(a, b) ((u64x4)_mm256_mul_epu32((__m256i)(a), (__m256i)(b)))
+#define SET4(x)    ((u64x4){x, x, x, x})
+
+// Two interleaved carry chains, as in FE_CARRY.  9 -> 0 multiplies the
+// carry by 19 with shifts: there is no 64-bit vector multiply in AVX2.
+#define FE4_CARRY_STEP(i, j, s)	\
+	t##j += t##i >> s;  t##i &= SET4(((u64)1 << s) - 1)
+#define FE4_CARRY	\
+	FE4_CARRY_STEP(0, 1, 26);  FE4_CARRY_STEP(4, 5, 26); \
+	FE4_CARRY_STEP(1, 2, 25);  FE4_CARRY_STEP(5, 6, 25); \
+	FE4_CARRY_STEP(2, 3, 26);  FE4_CARRY_STEP(6, 7, 26); \
+	FE4_CARRY_STEP(3, 4, 25);  FE4_CARRY_STEP(7, 8, 25); \
+	FE4_CARRY_STEP(4, 5, 26);  FE4_CARRY_STEP(8, 9, 26); \
+	u64x4 c = t9 >> 25;  t9 &= SET4(((u64)1 << 25) - 1); \
+	t0 += c + (c << 1) + (c << 4);                       \
+	FE4_CARRY_STEP(0, 1, 26);                            \
+	h[0] = t0;  h[1] = t1;  h[2] = t2;  h[3] = t3;  h[4] = t4; \
+	h[5] = t5;  h[6] = t6;  h[7] = t7;  h[8] = t8;  h[9] = t9
+
+TARGET("avx2")
+static void fe4_frombytes(fe4 h, const u8 s[4][32])
+{
+	fe51 t[4];
+	FOR (l, 0, 4) {
+		fe51_frombytes(t[l], s[l]);
+	}
+	FOR (i, 0, 5) {
+		u64x4 f = {t[0][i], t[1][i], t[2][i], t[3][i]};
+		h[i*2  ] = f & SET4(((u64)1 << 26) - 1);
+		h[i*2+1] = f >> 26;
+	}
+	WIPE_BUFFER(t);
+}
+
+TARGET("avx2")
+static void fe4_tobytes(u8 s[4][32], const fe4 h)
+{
+	FOR (l, 0, 4) {
+		fe51 t;
+		FOR (i, 0, 5) {
+			t[i] = h[i*2][l] + (h[i*2+1][l] << 26);
+		}
+		fe51_tobytes(s[l], t);
+		WIPE_BUFFER(t);
+	}
+}
+
+TARGET("avx2")
+static void fe4_1(fe4 h)
+{
+	h[0] = SET4(1);
+	FOR (i, 1, 10) { h[i] = SET4(0); }
+}
+
+TARGET("avx2")
+static void fe4_0(fe4 h)
+{
+	FOR (i, 0, 10) { h[i] = SET4(0); }
+}
+
+TARGET("avx2")
+static void fe4_copy(fe4 h, const fe4 f)
+{
+	FOR (i, 0, 10) { h[i] = f[i]; }
+}
+
+TARGET("avx2")
+static void fe4_add(fe4 h, const fe4 f, const fe4 g)
+{
+	FOR (i, 0, 10) { h[i] = f[i] + g[i]; }
+}
+
+// Adds 2p, so g must be carried.
+TARGET("avx2")
+static void fe4_sub(fe4 h, const fe4 f, const fe4 g)
+{
+	h[0] = f[0] + SET4(0x7ffffda) - g[0];
+	FOR (i, 1, 10) {
+		h[i] = f[i] + SET4(i & 1 ? 0x3fffffe : 0x7fffffe) - g[i];
+	}
+}
+
+// swap is all ones in the lanes to swap, zero elsewhere.
+TARGET("avx2")
+static void fe4_cswap(fe4 f, fe4 g, u64x4 swap)
+{
+	FOR (i, 0, 10) {
+		u64x4 x = (f[i] ^ g[i]) & swap;
+		f[i] = f[i] ^ x;
+		g[i] = g[i] ^ x;
+	}
+}
+
+TARGET("avx2")
+static void fe4_mul_small(fe4 h, const fe4 f, u32 g)
+{
+	u64x4 k  = SET4(g);
+	u64x4 t0 = MUL4(f[0], k);  u64x4 t1 = MUL4(f[1], k);
+	u64x4 t2 = MUL4(f[2], k);  u64x4 t3 = MUL4(f[3], k);
+	u64x4 t4 = MUL4(f[4], k);  u64x4 t5 = MUL4(f[5], k);
+	u64x4 t6 = MUL4(f[6], k);  u64x4 t7 = MUL4(f[7], k);
+	u64x4 t8 = MUL4(f[8], k);  u64x4 t9 = MUL4(f[9], k);
+	FE4_CARRY;
+}
+
+TARGET("avx2")
+static void fe4_mul(fe4 h, const fe4 f, const fe4 g)
+{
+	u64x4 f0 = f[0]; u64x4 f1 = f[1]; u64x4 f2 = f[2]; u64x4 f3 = f[3];
+	u64x4 f4 = f[4]; u64x4 f5 = f[5]; u64x4 f6 = f[6]; u64x4 f7 = f[7];
+	u64x4 f8 = f[8]; u64x4 f9 = f[9];
+	u64x4 g0 = g[0]; u64x4 g1 = g[1]; u64x4 g2 = g[2]; u64x4 g3 = g[3];
+	u64x4 g4 = g[4]; u64x4 g5 = g[5]; u64x4 g6 = g[6]; u64x4 g7 = g[7];
+	u64x4 g8 = g[8]; u64x4 g9 = g[9];
+	u64x4 F1 = f1 + f1;  u64x4 F3 = f3 + f3;  u64x4 F5 = f5 + f5;
+	u64x4 F7 = f7 + f7;  u64x4 F9 = f9 + f9;
+	u64x4 k19 = SET4(19);
+	u64x4 G1 = MUL4(g1, k19);  u64x4 G2 = MUL4(g2, k19);
+	u64x4 G3 = MUL4(g3, k19);  u64x4 G4 = MUL4(g4, k19);
+	u64x4 G5 = MUL4(g5, k19);  u64x4 G6 = MUL4(g6, k19);
+	u64x4 G7 = MUL4(g7, k19);  u64x4 G8 = MUL4(g8, k19);
+	u64x4 G9 = MUL4(g9, k19);
+
+	u64x4 t0 = MUL4(f0, g0) + MUL4(F1, G9) + MUL4(f2, G8) + MUL4(F3, G7)
+	         + MUL4(f4, G6) + MUL4(F5, G5) + MUL4(f6, G4) + MUL4(F7, G3)
+	         + MUL4(f8, G2) + MUL4(F9, G1);
+	u64x4 t1 = MUL4(f0, g1) + MUL4(f1, g0) + MUL4(f2, G9) + MUL4(f3, G8)
+	         + MUL4(f4, G7) + MUL4(f5, G6) + MUL4(f6, G5) + MUL4(f7, G4)
+	         + MUL4(f8, G3) + MUL4(f9, G2);
+	u64x4 t2 = MUL4(f0, g2) + MUL4(F1, g1) + MUL4(f2, g0) + MUL4(F3, G9)
+	         + MUL4(f4, G8) + MUL4(F5, G7) + MUL4(f6, G6) + MUL4(F7, G5)
+	         + MUL4(f8, G4) + MUL4(F9, G3);
+	u64x4 t3 = MUL4(f0, g3) + MUL4(f1, g2) + MUL4(f2, g1) + MUL4(f3, g0)
+	         + MUL4(f4, G9) + MUL4(f5, G8) + MUL4(f6, G7) + MUL4(f7, G6)
+	         + MUL4(f8, G5) + MUL4(f9, G4);
+	u64x4 t4 = MUL4(f0, g4) + MUL4(F1, g3) + MUL4(f2, g2) + MUL4(F3, g1)
+	         + MUL4(f4, g0) + MUL4(F5, G9) + MUL4(f6, G8) + MUL4(F7, G7)
+	         + MUL4(f8, G6) + MUL4(F9, G5);
+	u64x4 t5 = MUL4(f0, g5) + MUL4(f1, g4) + MUL4(f2, g3) + MUL4(f3, g2)
+	         + MUL4(f4, g1) + MUL4(f5, g0) + MUL4(f6, G9) + MUL4(f7, G8)
+	         + MUL4(f8, G7) + MUL4(f9, G6);
+	u64x4 t6 = MUL4(f0, g6) + MUL4(F1, g5) + MUL4(f2, g4) + MUL4(F3, g3)
+	         + MUL4(f4, g2) + MUL4(F5, g1) + MUL4(f6, g0) + MUL4(F7, G9)
+	         + MUL4(f8, G8) + MUL4(F9, G7);
+	u64x4 t7 = MUL4(f0, g7) + MUL4(f1, g6) + MUL4(f2, g5) + MUL4(f3, g4)
+	         + MUL4(f4, g3) + MUL4(f5, g2) + MUL4(f6, g1) + MUL4(f7, g0)
+	         + MUL4(f8, G9) + MUL4(f9, G8);
+	u64x4 t8 = MUL4(f0, g8) + MUL4(F1, g7) + MUL4(f2, g6) + MUL4(F3, g5)
+	         + MUL4(f4, g4) + MUL4(F5, g3) + MUL4(f6, g2) + MUL4(F7, g1)
+	         + MUL4(f8, g0) + MUL4(F9, G9);
+	u64x4 t9 = MUL4(f0, g9) + MUL4(f1, g8) + MUL4(f2, g7) + MUL4(f3, g6)
+	         + MUL4(f4, g5) + MUL4(f5, g4) + MUL4(f6, g3) + MUL4(f7, g2)
+	         + MUL4(f8, g1) + MUL4(f9, g0);
+
+	FE4_CARRY;
+}
+
+TARGET("avx2")
+static void fe4_sq(fe4 h, const fe4 f)
+{
+	u64x4 f0 = f[0]; u64x4 f1 = f[1]; u64x4 f2 = f[2]; u64x4 f3 = f[3];
+	u64x4 f4 = f[4]; u64x4 f5 = f[5]; u64x4 f6 = f[6]; u64x4 f7 = f[7];
+	u64x4 f8 = f[8]; u64x4 f9 = f[9];
+	u64x4 f0_2 = f0 + f0;  u64x4 f1_2 = f1 + f1;  u64x4 f2_2 = f2 + f2;
+	u64x4 f3_2 = f3 + f3;  u64x4 f4_2 = f4 + f4;  u64x4 f5_2 = f5 + f5;
+	u64x4 f6_2 = f6 + f6;  u64x4 f7_2 = f7 + f7;  u64x4 f8_2 = f8 + f8;
+	u64x4 f9_2 = f9 + f9;
+	u64x4 f1_4 = f1_2 + f1_2;  u64x4 f3_4 = f3_2 + f3_2;
+	u64x4 f5_4 = f5_2 + f5_2;  u64x4 f7_4 = f7_2 + f7_2;
+	u64x4 k19 = SET4(19);
+	u64x4 f5_19 = MUL4(f5, k19);  u64x4 f6_19 = MUL4(f6, k19);
+	u64x4 f7_19 = MUL4(f7, k19);  u64x4 f8_19 = MUL4(f8, k19);
+	u64x4 f9_19 = MUL4(f9, k19);
+
+	u64x4 t0 = MUL4(f0, f0) + MUL4(f1_4, f9_19) + MUL4(f2_2, f8_19)
+	         + MUL4(f3_4, f7_19) + MUL4(f4_2, f6_19) + MUL4(f5_2, f5_19);
+	u64x4 t1 = MUL4(f0_2, f1) + MUL4(f2_2, f9_19) + MUL4(f3_2, f8_19)
+	         + MUL4(f4_2, f7_19) + MUL4(f5_2, f6_19);
+	u64x4 t2 = MUL4(f0_2, f2) + MUL4(f1_2, f1) + MUL4(f3_4, f9_19)
+	         + MUL4(f4_2, f8_19) + MUL4(f5_4, f7_19) + MUL4(f6, f6_19);
+	u64x4 t3 = MUL4(f0_2, f3) + MUL4(f1_2, f2) + MUL4(f4_2, f9_19)
+	         + MUL4(f5_2, f8_19) + MUL4(f6_2, f7_19);
+	u64x4 t4 = MUL4(f0_2, f4) + MUL4(f1_4, f3) + MUL4(f2, f2)
+	         + MUL4(f5_4, f9_19) + MUL4(f6_2, f8_19) + MUL4(f7_2, f7_19);
+	u64x4 t5 = MUL4(f0_2, f5) + MUL4(f1_2, f4) + MUL4(f2_2, f3)
+	         + MUL4(f6_2, f9_19) + MUL4(f7_2, f8_19);
+	u64x4 t6 = MUL4(f0_2, f6) + MUL4(f1_4, f5) + MUL4(f2_2, f4)
+	         + MUL4(f3_2, f3) + MUL4(f7_4, f9_19) + MUL4(f8, f8_19);
+	u64x4 t7 = MUL4(f0_2, f7) + MUL4(f1_2, f6) + MUL4(f2_2, f5)
+	         + MUL4(f3_2, f4) + MUL4(f8_2, f9_19);
+	u64x4 t8 = MUL4(f0_2, f8) + MUL4(f1_4, f7) + MUL4(f2_2, f6)
+	         + MUL4(f3_4, f5) + MUL4(f4, f4) + MUL4(f9_2, f9_19);
+	u64x4 t9 = MUL4(f0_2, f9) + MUL4(f1_2, f8) + MUL4(f2_2, f7)
+	         + MUL4(f3_2, f6) + MUL4(f4_2, f5);
+
+	FE4_CARRY;
+}
+
+TARGET("avx2")
+static void fe4_sqn(fe4 h, const fe4 f, int n)
+{
+	fe4_sq(h, f);
+	FOR (i, 1, (size_t)n) { fe4_sq(h, h); }
+}
+
+TARGET("avx2")
+static void fe4_invert(fe4 out, const fe4 x)
 {
-	static const u8 base_point[32] = {9};
-	crypto_x25519(public_key, secret_key, base_point);
+	fe4 z2, z9, z11, t0, t1, t2;
+	fe4_sq (z2, x);
+	fe4_sqn(t0, z2, 2);
+	fe4_mul(z9, t0, x);
+	fe4_mul(z11, z9, z2);
+	fe4_sq (t0, z11);
+	fe4_mul(t0, t0, z9);          // 2^5   - 2^0
+	fe4_sqn(t1, t0, 5);
+	fe4_mul(t0, t1, t0);          // 2^10  - 2^0
+	fe4_sqn(t1, t0, 10);
+	fe4_mul(t1, t1, t0);          // 2^20  - 2^0
+	fe4_sqn(t2, t1, 20);
+	fe4_mul(t1, t2, t1);          // 2^40  - 2^0
+	fe4_sqn(t1, t1, 10);
+	fe4_mul(t0, t1, t0);          // 2^50  - 2^0
+	fe4_sqn(t1, t0, 50);
+	fe4_mul(t1, t1, t0);          // 2^100 - 2^0
+	fe4_sqn(t2, t1, 100);
+	fe4_mul(t1, t2, t1);          // 2^200 - 2^0
+	fe4_sqn(t1, t1, 50);
+	fe4_mul(t0, t1, t0);          // 2^250 - 2^0
+	fe4_sqn(t0, t0, 5);
+	fe4_mul(out, t0, z11);        // 2^255 - 21
+	WIPE_BUFFER(z2);  WIPE_BUFFER(z9);  WIPE_BUFFER(z11);
+	WIPE_BUFFER(t0);  WIPE_BUFFER(t1);  WIPE_BUFFER(t2);
+}
+
+// Same ladder as scalarmult(), with a per lane swap mask.
+TARGET("avx2")
+static void x25519_x4_avx2(u8 q[4][32], const u8 scalar[4][32],
+                           const u8 p[4][32])
+{
+	fe4 x1, x2, z2, x3, z3, t0, t1;
+	fe4_frombytes(x1, p);
+	fe4_1(x2);        fe4_0(z2);
+	fe4_copy(x3, x1); fe4_1(z3);
+	u64x4 swap = SET4(0);
+	for (int pos = 254; pos >= 0; --pos) {
+		u64x4 b = { -(u64)scalar_bit(scalar[0], pos),
+		            -(u64)scalar_bit(scalar[1], pos),
+		            -(u64)scalar_bit(scalar[2], pos),
+		            -(u64)scalar_bit(scalar[3], pos) };
+		swap ^= b;
+		fe4_cswap(x2, x3, swap);
+		fe4_cswap(z2, z3, swap);
+		swap = b;
+
+		fe4_sub(t0, x3, z3);
+		fe4_sub(t1, x2, z2);
+		fe4_add(x2, x2, z2);
+		fe4_add(z2, x3, z3);
+		fe4_mul(z3, t0, x2);
+		fe4_mul(z2, z2, t1);
+		fe4_sq (t0, t1    );
+		fe4_sq (t1, x2    );
+		fe4_add(x3, z3, z2);
+		fe4_sub(z2, z3, z2);
+		fe4_mul(x2, t1, t0);
+		fe4_sub(t1, t1, t0);
+		fe4_sq (z2, z2    );
+		fe4_mul_small(z3, t1, 121666);
+		fe4_sq (x3, x3    );
+		fe4_add(t0, t0, z3);
+		fe4_mul(z3, x1, z2);
+		fe4_mul(z2, t1, t0);
+	}
+	fe4_cswap(x2, x3, swap);
+	fe4_cswap(z2, z3, swap);
+
+	fe4_invert(z2, z2);
+	fe4_mul(x2, x2, z2);
+	fe4_tobytes(q, x2);
+
+	WIPE_BUFFER(x1);
+	WIPE_BUFFER(x2);  WIPE_BUFFER(z2);  WIPE_BUFFER(t0);
+	WIPE_BUFFER(x3);  WIPE_BUFFER(z3);  WIPE_BUFFER(t1);
+}
+#endif // MONOCYPHER_SIMD
+
+void crypto_x25519_batch(u8       *raw_shared_secrets,
+                         const u8 *your_secret_keys,
+                         const u8 *their_public_keys,
+                         size_t    nb_keys)
+{
+	u8 e[4][32];
+	while (nb_keys >= 4) {
+		FOR (i, 0, 4) {
+			crypto_eddsa_trim_scalar(e[i], your_secret_keys + i * 32);
+		}
+		kernels->x25519_x4((u8(*)[32])raw_shared_secrets, e,
+		                   (const u8(*)[32])their_public_keys);
+		raw_shared_secrets += 128;
+		your_secret_keys   += 128;
+		their_public_keys  += 128;
+		nb_keys            -= 4;
+	}
+	FOR (i, 0, nb_keys) {
+		crypto_x25519(raw_shared_secrets + i * 32, your_secret_keys + i * 32,
+		              their_public_keys + i * 32);
+	}
+	WIPE_BUFFER(e);
 }
 
 ///////////////////////////
@@ -2157,10 +4239,10 @@ static void lookup_add(ge *p, ge_precomp *tmp_c, fe tmp_a, fe tmp_b,
 }
 
 // p = [scalar]B, where B is the base point
-static void ge_scalarmult_base(ge *p, const u8 scalar[32])
+// All bits set form of the scalar, for the signed combs:
+// 1 means 1, 0 means -1
+static void comb_scalar(u8 s_scalar[32], const u8 scalar[32])
 {
-	// twin 4-bits signed combs, from Mike Hamburg's
-	// Fast and compact elliptic-curve cryptography (2012)
 	// 1 / 2 modulo L
 	static const u8 half_mod_L[32] = {
 		247,233,122,46,141,49,9,44,107,206,123,81,239,124,111,10,
@@ -2171,10 +4253,15 @@ static void ge_scalarmult_base(ge *p, const u8 scalar[32])
 		142,74,204,70,186,24,118,107,184,231,190,57,250,173,119,99,
 		255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,7,
 	};
+	crypto_eddsa_mul_add(s_scalar, scalar, half_mod_L, half_ones);
+}
 
-	// All bits set form: 1 means 1, 0 means -1
+static void ge_scalarmult_base(ge *p, const u8 scalar[32])
+{
+	// twin 4-bits signed combs, from Mike Hamburg's
+	// Fast and compact elliptic-curve cryptography (2012)
 	u8 s_scalar[32];
-	crypto_eddsa_mul_add(s_scalar, scalar, half_mod_L, half_ones);
+	comb_scalar(s_scalar, scalar);
 
 	// Double and add ladder
 	fe tmp_a, tmp_b;  // temporaries for addition
@@ -2557,6 +4644,240 @@ void crypto_x25519_dirty_fast(u8 public_key[32], const u8 secret_key[32])
 	WIPE_BUFFER(scalar);
 }
 
+/////////////////////////
+/// Fixed base X25519 ///
+/////////////////////////
+// [trimmed scalar]B on the twisted Edwards curve, with the combs of
+// ge_scalarmult_base(), then mapped to the Montgomery u coordinate:
+// about 4 times fewer field operations than a ladder.
+#ifdef __SIZEOF_INT128__
+// Same as ge, ge_precomp, the combs and their helpers, in radix 2^51
+typedef struct { fe51 X;  fe51 Y;  fe51 Z; fe51 T;  } ge51;
+typedef struct { fe51 Yp; fe51 Ym;         fe51 T2; } ge51_precomp;
+
+static const ge51_precomp b_comb_low51[8] = {
+	{{0x772250397fca7, 0x007972ea7c54a, 0x1ff13a512e502,
+	  0x078d78131147c, 0x22a820ae4f35b,},
+	 {0x0189cc09d4311, 0x24bfea8e27055, 0x6020d6c8123ce,
+	  0x37f50bb25b676, 0x0ac08019153b6,},
+	 {0x73c0f9ea59a31, 0x74d4e2f2cf383, 0x4a8825f06e13e,
+	  0x00adbc4c5766d, 0x76da4ecb9a18b,},},
+	{{0x653683744966a, 0x744f768975f9c, 0x0b2b2b61577f4,
+	  0x47579e555ae74, 0x3e91b142980e6,},
+	 {0x6df513f91929f, 0x671be0428fc01, 0x43316328e15ed,
+	  0x35b8c9ba0cec6, 0x2ea59749950b5,},
+	 {0x4ed06fa2eac89, 0x0d8073355b152, 0x3ee90ef507c80,
+	  0x46a9bf65fa2f2, 0x4337023910658,},},
+	{{0x0238a650d54db, 0x7f48a7bf2df04, 0x573f00347c83b,
+	  0x3b5933ec97282, 0x6cda92a25e073,},
+	 {0x7761217a01e90, 0x6e74cfbb8ad38, 0x2f7039fc19a67,
+	  0x040b66a22bb21, 0x27fb1585f762f,},
+	 {0x07bacef2c584e, 0x758aa6ab16614, 0x615954fdb46f7,
+	  0x3c04bf0703c7d, 0x1c919aa9b406a,},},
+	{{0x02a6d9069080c, 0x24ca2a961f4eb, 0x2b50a1e01e3aa,
+	  0x185e962ccc532, 0x5f9b1c781e85f,},
+	 {0x4c196a38a42b2, 0x384b8972fc6e1, 0x46e77aed78341,
+	  0x55cf8a89e12eb, 0x2e176aab14b64,},
+	 {0x432dbd754498c, 0x14a7b94994d3f, 0x1ed969d7b0a43,
+	  0x25a56cb99d8aa, 0x421b7b4f1bd84,},},
+	{{0x2d0e22c9315d4, 0x5c7262691ab9e, 0x5a661043bb4e8,
+	  0x5eb4a740f331c, 0x4a3929777e76d,},
+	 {0x37317506e9bd0, 0x5e7319580f55c, 0x1f60058dae862,
+	  0x649b334617acb, 0x5ebb9c462b279,},
+	 {0x3ae53dcecb61b, 0x5940ac87008f2, 0x644893d12bd2d,
+	  0x12a2280215bfe, 0x1b38894a53347,},},
+	{{0x14355ff2742b2, 0x6917ce7a68c52, 0x1028d15acb55a,
+	  0x0778baf27464a, 0x0ea336aff6515,},
+	 {0x4dbc0c7abe7ef, 0x2f124223c8508, 0x432bf58e9da3e,
+	  0x2a4056f79857e, 0x7198392d4ce0e,},
+	 {0x24a2150b2f4a0, 0x6bc3d63b93b83, 0x0a6514f888ed8,
+	  0x4010a45dca05f, 0x3874e6f9116f7,},},
+	{{0x12772ee47e550, 0x5d47dbf4829b6, 0x0174f43e9f1a7,
+	  0x40f7e0a2753ba, 0x30d2a5c13b12b,},
+	 {0x58a0fb99fc163, 0x489d580e1b5a1, 0x5ea2d6050e735,
+	  0x702b9ebcc0f39, 0x2901a42631422,},
+	 {0x6814981863404, 0x3d2e0df15bb32, 0x001f718117db4,
+	  0x2490f35666272, 0x7a96f9d791d4b,},},
+	{{0x01138312eced9, 0x29fa1caf3b3d5, 0x75a39f217a753,
+	  0x79791845d2811, 0x36b2632bf6983,},
+	 {0x1f3f1f87a7d71, 0x50f161ae5a335, 0x6966efd801df5,
+	  0x1c8c490ebb080, 0x262e84e2f8407,},
+	 {0x70136d3285253, 0x48028249c59b8, 0x4a8b7e5fffc9e,
+	  0x398714d6489ed, 0x1d3bdc3866338,},},
+};
+static const ge51_precomp b_comb_high51[8] = {
+	{{0x6f1818df8647c, 0x1962353f809c4, 0x68186800e8473,
+	  0x1aafa73b14b13, 0x655a7d3ada43e,},
+	 {0x1a93cdc3d3fdb, 0x0f1b307493b70, 0x13920f87a19c5,
+	  0x78c0eb7df1ec4, 0x424d19e1869c2,},
+	 {0x5cdafb0f8498d, 0x02ca5796b0c99, 0x7278b8e76324b,
+	  0x6dd02686a4477, 0x2657314a77d50,},},
+	{{0x6fa412426a68f, 0x50beeca8aa6c7, 0x377971f32c4bc,
+	  0x34ffe7cc47a0d, 0x20c95a0e5ea74,},
+	 {0x53a8ced324c1d, 0x4df3a18304cce, 0x53f9fc0c93dff,
+	  0x4c915435bf232, 0x0861cbdc37d49,},
+	 {0x2d22633ef754e, 0x35a52105c09b5, 0x60df498e10b0c,
+	  0x2ccb54ec3cf9f, 0x3234bc1dea602,},},
+	{{0x675dc2c1f4959, 0x141dc40e9c87e, 0x0079ab984db94,
+	  0x64ed162ea7ae4, 0x484981f99e4da,},
+	 {0x084032497a514, 0x7978dbfa20906, 0x76165f4414a93,
+	  0x64a782ea3187f, 0x2ccf0128cdb9f,},
+	 {0x49923eea5c048, 0x23cb6745b06ac, 0x1654fc137f22d,
+	  0x7aba935af1237, 0x34544e75aa371,},},
+	{{0x3e7e4a77e5e56, 0x6d08ff491b454, 0x711d4f3bb75dc,
+	  0x4f0c4845e556f, 0x27a7c41964ff0,},
+	 {0x4385d65a10218, 0x214121875bbb3, 0x482d7df7361e2,
+	  0x6a60709ba3be9, 0x00ec79040822b,},
+	 {0x618849f355d39, 0x216f0cf93a98f, 0x0bd023a5fcaaa,
+	  0x5d20f35c4db53, 0x2af97683b9c94,},},
+	{{0x3bd6ae0b5dbba, 0x55359aef10b75, 0x12836b25ba2d8,
+	  0x19f7cfa616fc5, 0x7be577c68db8d,},
+	 {0x355890a45747b, 0x75a6276624e7c, 0x4d64b95ace25e,
+	  0x399ea485deb75, 0x635651035ff27,},
+	 {0x2ada9e4d73276, 0x23665a605f02b, 0x10897c9d93d08,
+	  0x118359be41ba0, 0x30c8000d50689,},},
+	{{0x402649c166abb, 0x35300a1fdd357, 0x5e838407b7b8e,
+	  0x057c24755a276, 0x755881957a6d0,},
+	 {0x6da9521de6781, 0x0f1d93a7d893b, 0x5c24a74bf5e7e,
+	  0x1e622465d8462, 0x152369a946293,},
+	 {0x65d0022775c38, 0x0b9828d6be817, 0x16f9a7f746c26,
+	  0x2865ee25d942b, 0x79f47698232db,},},
+	{{0x13429cea1ca1d, 0x7f46251db2649, 0x7d9c5e6d5ce50,
+	  0x410312af52e1e, 0x4e7732ee05a0e,},
+	 {0x3801a676c3853, 0x1d70e2dd13410, 0x24bcc835ac073,
+	  0x57d3561ce3275, 0x4b4ee9a57d22d,},
+	 {0x3d67d4c58ecfb, 0x2e2326a8a23b1, 0x2baacbc7120d4,
+	  0x79280f5ac1fcf, 0x10a123f2981ea,},},
+	{{0x08efaf191a8dc, 0x79ce4c6b204cf, 0x0809b47a37f33,
+	  0x2278abe49b155, 0x4e32caad4a5d1,},
+	 {0x3891d563adb50, 0x363ece3b9dd93, 0x0b465f235e2c7,
+	  0x4bc34b0b88a94, 0x1ae2643a5573a,},
+	 {0x36fb74fcf2434, 0x415f32b48012c, 0x6470adf762078,
+	  0x05567108d44af, 0x6a50999cfd490,},},
+};
+
+static void ge51_zero(ge51 *p)
+{
+	fe51_0(p->X);
+	fe51_1(p->Y);
+	fe51_1(p->Z);
+	fe51_0(p->T);
+}
+
+static void ge51_madd(ge51 *s, const ge51 *p, const ge51_precomp *q,
+                      fe51 a, fe51 b)
+{
+	fe51_add(a   , p->Y, p->X );
+	fe51_sub(b   , p->Y, p->X );
+	fe51_mul(a   , a   , q->Yp);
+	fe51_mul(b   , b   , q->Ym);
+	fe51_add(s->Y, a   , b    );
+	fe51_sub(s->X, a   , b    );
+
+	fe51_add(s->Z, p->Z, p->Z );
+	fe51_mul(s->T, p->T, q->T2);
+	fe51_add(a   , s->Z, s->T );
+	fe51_sub(b   , s->Z, s->T );
+
+	fe51_mul(s->T, s->X, s->Y);
+	fe51_mul(s->X, s->X, b   );
+	fe51_mul(s->Y, s->Y, a   );
+	fe51_mul(s->Z, a   , b   );
+}
+
+static void ge51_double(ge51 *s, const ge51 *p, ge51 *q)
+{
+	fe51_sq (q->X, p->X);
+	fe51_sq (q->Y, p->Y);
+	fe51_sq (q->Z, p->Z);          // qZ = pZ^2
+	fe51_mul_small(q->Z, q->Z, 2); // qZ = pZ^2 * 2
+	fe51_add(q->T, p->X, p->Y);
+	fe51_sq (s->T, q->T);
+	fe51_add(q->T, q->Y, q->X);
+	// qZ - (qY - qX), reordered so we never subtract a difference
+	fe51_add(q->Z, q->Z, q->X);
+	fe51_sub(q->Z, q->Z, q->Y);
+	fe51_sub(q->Y, q->Y, q->X);
+	fe51_sub(q->X, s->T, q->T);
+
+	fe51_mul(s->X, q->X , q->Z);
+	fe51_mul(s->Y, q->T , q->Y);
+	fe51_mul(s->Z, q->Y , q->Z);
+	fe51_mul(s->T, q->X , q->T);
+}
+
+static void lookup_add51(ge51 *p, ge51_precomp *tmp_c, fe51 tmp_a, fe51 tmp_b,
+                         const ge51_precomp comb[8], const u8 scalar[32],
+                         int i)
+{
+	u8 teeth = (u8)((scalar_bit(scalar, i)          ) +
+	                (scalar_bit(scalar, i + 32) << 1) +
+	                (scalar_bit(scalar, i + 64) << 2) +
+	                (scalar_bit(scalar, i + 96) << 3));
+	u8 high  = teeth >> 3;
+	u8 index = (teeth ^ (high - 1)) & 7;
+	FOR (j, 0, 8) {
+		i32 select = 1 & (((j ^ index) - 1) >> 8);
+		fe51_ccopy(tmp_c->Yp, comb[j].Yp, select);
+		fe51_ccopy(tmp_c->Ym, comb[j].Ym, select);
+		fe51_ccopy(tmp_c->T2, comb[j].T2, select);
+	}
+	fe51_neg(tmp_a, tmp_c->T2);
+	fe51_cswap(tmp_c->T2, tmp_a    , high ^ 1);
+	fe51_cswap(tmp_c->Yp, tmp_c->Ym, high ^ 1);
+	ge51_madd(p, p, tmp_c, tmp_a, tmp_b);
+}
+
+void crypto_x25519_public_key(u8       public_key[32],
+                              const u8 secret_key[32])
+{
+	u8 scalar[32];
+	u8 s_scalar[32];
+	crypto_eddsa_trim_scalar(scalar, secret_key);
+	comb_scalar(s_scalar, scalar);
+
+	// Double and add ladder (see ge_scalarmult_base())
+	fe51         tmp_a, tmp_b;
+	ge51_precomp tmp_c;
+	ge51         tmp_d;
+	ge51         p;
+	fe51_1(tmp_c.Yp);
+	fe51_1(tmp_c.Ym);
+	fe51_0(tmp_c.T2);
+	ge51_zero(&p);
+	lookup_add51(&p, &tmp_c, tmp_a, tmp_b, b_comb_low51 , s_scalar, 31);
+	lookup_add51(&p, &tmp_c, tmp_a, tmp_b, b_comb_high51, s_scalar, 31+128);
+	for (int i = 30; i >= 0; i--) {
+		ge51_double(&p, &p, &tmp_d);
+		lookup_add51(&p, &tmp_c, tmp_a, tmp_b, b_comb_low51 , s_scalar, i);
+		lookup_add51(&p, &tmp_c, tmp_a, tmp_b, b_comb_high51, s_scalar, i+128);
+	}
+
+	// Montgomery u coordinate: u = (Z + Y) / (Z - Y)
+	fe51_add(tmp_a, p.Z, p.Y);
+	fe51_sub(tmp_b, p.Z, p.Y);
+	fe51_invert(tmp_b, tmp_b);
+	fe51_mul(tmp_a, tmp_a, tmp_b);
+	fe51_tobytes(public_key, tmp_a);
+
+	WIPE_BUFFER(tmp_a);  WIPE_CTX(&tmp_d);  WIPE_BUFFER(scalar);
+	WIPE_BUFFER(tmp_b);  WIPE_CTX(&tmp_c);  WIPE_BUFFER(s_scalar);
+	WIPE_CTX(&p);
+}
+#else
+void crypto_x25519_public_key(u8       public_key[32],
+                              const u8 secret_key[32])
+{
+	// With the 3 least significant bits cleared, the low order point
+	// added by crypto_x25519_dirty_fast() is zero: the key is clean.
+	u8 sk[32];
+	COPY(sk, secret_key, 32);
+	sk[0] &= 248;
+	crypto_x25519_dirty_fast(public_key, sk);
+	WIPE_BUFFER(sk);
+}
+#endif // __SIZEOF_INT128__
+
 ///////////////////
 /// Elligator 2 ///
 ///////////////////
@@ -2855,21 +5176,118 @@ void crypto_x25519_inverse(u8 blind_salt [32], const u8 private_key[32],
 ////////////////////////////////
 /// Authenticated encryption ///
 ////////////////////////////////
-static void lock_auth(u8 mac[16], const u8  auth_key[32],
-                      const u8 *ad         , size_t ad_size,
-                      const u8 *cipher_text, size_t text_size)
+// Single pass: each slice of text is encrypted then authenticated
+// (or authenticated then decrypted) while it is still in L1 cache.
+#define AEAD_SLICE 64 // blocks of 64 bytes (4KB)
+
+static void aead_blocks_scalar(u8 *out, const u8 *in, u32 input[16],
+                               crypto_poly1305_ctx *poly_ctx,
+                               size_t nb_blocks, int decrypt)
+{
+	while (nb_blocks > 0) {
+		size_t nb = MIN(nb_blocks, AEAD_SLICE);
+		if (decrypt) {
+			kernels->poly_blocks(poly_ctx, in, nb << 2, 1);
+		}
+		kernels->chacha20_blocks(out, in, input, nb);
+		if (!decrypt) {
+			kernels->poly_blocks(poly_ctx, out, nb << 2, 1);
+		}
+		out       += nb << 6;
+		nb_blocks -= nb;
+		if (in != 0) {
+			in += nb << 6;
+		}
+	}
+}
+
+#ifdef MONOCYPHER_SIMD
+// Same, with the powers of r computed once for all slices.
+
+TARGET("avx2")
+static void aead_blocks_avx2(u8 *out, const u8 *in, u32 input[16],
+                             crypto_poly1305_ctx *poly_ctx,
+                             size_t nb_blocks, int decrypt)
+{
+	if (nb_blocks << 2 < POLY_X4_MIN) {
+		aead_blocks_scalar(out, in, input, poly_ctx, nb_blocks, decrypt);
+		return;
+	}
+	poly_x4_ctx x4;
+	poly_x4_init(&x4, poly_ctx);
+	while (nb_blocks > 0) {
+		size_t nb = MIN(nb_blocks, AEAD_SLICE);
+		if (decrypt) {
+			poly_x4_absorb(&x4, in, nb << 2, 1);
+		}
+		kernels->chacha20_blocks(out, in, input, nb);
+		if (!decrypt) {
+			poly_x4_absorb(&x4, out, nb << 2, 1);
+		}
+		out       += nb << 6;
+		nb_blocks -= nb;
+		if (in != 0) {
+			in += nb << 6;
+		}
+	}
+	poly_x4_final(&x4, poly_ctx);
+}
+#endif // MONOCYPHER_SIMD
+
+// (De)crypts the text with ctx, and authenticates the cipher text.
+// poly_ctx must be at a block boundary.
+static void aead_crypt(const crypto_aead_ctx *ctx,
+                       crypto_poly1305_ctx *poly_ctx,
+                       u8 *out, const u8 *in, size_t text_size, int decrypt)
+{
+	u64 ctr = ctx->counter + 1; // block 0 is the authentication key
+	u32 input[16];
+	load32_le_buf(input     , chacha20_constant, 4);
+	load32_le_buf(input +  4, ctx->key         , 8);
+	load32_le_buf(input + 14, ctx->nonce       , 2);
+	input[12] = (u32) ctr;
+	input[13] = (u32)(ctr >> 32);
+
+	// Whole blocks
+	size_t nb_blocks = text_size >> 6;
+	kernels->aead_blocks(out, in, input, poly_ctx, nb_blocks, decrypt);
+	out += nb_blocks << 6;
+	if (in != 0) {
+		in += nb_blocks << 6;
+	}
+	text_size &= 63;
+
+	// Last (incomplete) block
+	if (text_size > 0) {
+		ctr = input[12] + ((u64)input[13] << 32);
+		if (decrypt) {
+			crypto_poly1305_update(poly_ctx, in, text_size);
+		}
+		crypto_chacha20_djb(out, in, text_size, ctx->key, ctx->nonce, ctr);
+		if (!decrypt) {
+			crypto_poly1305_update(poly_ctx, out, text_size);
+		}
+	}
+	WIPE_BUFFER(input);
+}
+
+static void auth_start(crypto_poly1305_ctx *poly_ctx, const u8 auth_key[32],
+                       const u8 *ad, size_t ad_size)
+{
+	crypto_poly1305_init  (poly_ctx, auth_key);
+	crypto_poly1305_update(poly_ctx, ad  , ad_size);
+	crypto_poly1305_update(poly_ctx, zero, gap(ad_size, 16));
+}
+
+static void auth_finish(crypto_poly1305_ctx *poly_ctx, u8 mac[16],
+                        size_t ad_size, size_t text_size)
 {
 	u8 sizes[16]; // Not secret, not wiped
 	store64_le(sizes + 0, ad_size);
 	store64_le(sizes + 8, text_size);
-	crypto_poly1305_ctx poly_ctx;           // auto wiped...
-	crypto_poly1305_init  (&poly_ctx, auth_key);
-	crypto_poly1305_update(&poly_ctx, ad         , ad_size);
-	crypto_poly1305_update(&poly_ctx, zero       , gap(ad_size, 16));
-	crypto_poly1305_update(&poly_ctx, cipher_text, text_size);
-	crypto_poly1305_update(&poly_ctx, zero       , gap(text_size, 16));
-	crypto_poly1305_update(&poly_ctx, sizes      , 16);
-	crypto_poly1305_final (&poly_ctx, mac); // ...here
+	crypto_poly1305_update(poly_ctx, zero , gap(text_size, 16));
+	crypto_poly1305_update(poly_ctx, sizes, 16);
+	crypto_poly1305_final (poly_ctx, mac); // wipes poly_ctx
 }
 
 void crypto_aead_init_x(crypto_aead_ctx *ctx,
@@ -2902,13 +5320,16 @@ void crypto_aead_write(crypto_aead_ctx *ctx, u8 *cipher_text, u8 mac[16],
 {
 	u8 auth_key[64]; // the last 32 bytes are used for rekeying.
 	crypto_chacha20_djb(auth_key, 0, 64, ctx->key, ctx->nonce, ctx->counter);
-	crypto_chacha20_djb(cipher_text, plain_text, text_size,
-	                    ctx->key, ctx->nonce, ctx->counter + 1);
-	lock_auth(mac, auth_key, ad, ad_size, cipher_text, text_size);
+	crypto_poly1305_ctx poly_ctx;
+	auth_start(&poly_ctx, auth_key, ad, ad_size);
+	aead_crypt(ctx, &poly_ctx, cipher_text, plain_text, text_size, 0);
+	auth_finish(&poly_ctx, mac, ad_size, text_size);
 	COPY(ctx->key, auth_key + 32, 32);
 	WIPE_BUFFER(auth_key);
 }
 
+// The plain text is written as the cipher text is authenticated.
+// If the MAC does not match, it is wiped before returning.
 int crypto_aead_read(crypto_aead_ctx *ctx, u8 *plain_text, const u8 mac[16],
                      const u8 *ad,          size_t ad_size,
                      const u8 *cipher_text, size_t text_size)
@@ -2916,11 +5337,14 @@ int crypto_aead_read(crypto_aead_ctx *ctx, u8 *plain_text, const u8 mac[16],
 	u8 auth_key[64]; // the last 32 bytes are used for rekeying.
 	u8 real_mac[16];
 	crypto_chacha20_djb(auth_key, 0, 64, ctx->key, ctx->nonce, ctx->counter);
-	lock_auth(real_mac, auth_key, ad, ad_size, cipher_text, text_size);
+	crypto_poly1305_ctx poly_ctx;
+	auth_start(&poly_ctx, auth_key, ad, ad_size);
+	aead_crypt(ctx, &poly_ctx, plain_text, cipher_text, text_size, 1);
+	auth_finish(&poly_ctx, real_mac, ad_size, text_size);
 	int mismatch = crypto_verify16(mac, real_mac);
-	if (!mismatch) {
-		crypto_chacha20_djb(plain_text, cipher_text, text_size,
-		                    ctx->key, ctx->nonce, ctx->counter + 1);
+	if (mismatch) {
+		crypto_wipe(plain_text, text_size);
+	} else {
 		COPY(ctx->key, auth_key + 32, 32);
 	}
 	WIPE_BUFFER(auth_key);
@@ -2951,6 +5375,135 @@ int crypto_aead_unlock(u8 *plain_text, const u8  mac[16], const u8 key[32],
 	return mismatch;
 }
 
+// Batch interface.  Besides the bulk of the text, each message needs
+// 3 lone Chacha20 permutations: HChacha20, the authentication key
+// (block 0), and the last incomplete block.  Those are computed for
+// up to 8 messages at once, one message per SIMD lane.
+#define AEAD_BATCH 8
+
+static void aead_batch(u8 macs[AEAD_BATCH][16], u8 *const *outs,
+                       const u8 *keys, const u8 *nonces,
+                       const u8 *const *ins, const size_t *text_sizes,
+                       size_t nb_messages, int decrypt)
+{
+	u32 input[AEAD_BATCH][16];
+	u32 pool [AEAD_BATCH][16];
+	u8  auth_keys[AEAD_BATCH][32];
+	u8  tails    [AEAD_BATCH][64];
+	ZERO(&input[0][0], AEAD_BATCH * 16); // unused lanes
+
+	// Sub keys (HChacha20)
+	FOR (i, 0, nb_messages) {
+		load32_le_buf(input[i]     , chacha20_constant, 4);
+		load32_le_buf(input[i] +  4, keys   + i * 32  , 8);
+		load32_le_buf(input[i] + 12, nonces + i * 24  , 4);
+	}
+	kernels->chacha20_rounds_x8(pool, input);
+
+	// Authentication keys (block 0)
+	FOR (i, 0, nb_messages) {
+		COPY(input[i] +  4, pool[i]     , 4);
+		COPY(input[i] +  8, pool[i] + 12, 4);
+		input[i][12] = 0;
+		input[i][13] = 0;
+		load32_le_buf(input[i] + 14, nonces + i * 24 + 16, 2);
+	}
+	kernels->chacha20_rounds_x8(pool, input);
+	FOR (i, 0, nb_messages) {
+		FOR (j, 0, 8) {
+			store32_le(auth_keys[i] + j * 4, pool[i][j] + input[i][j]);
+		}
+	}
+
+	// Last incomplete blocks
+	int has_tail = 0;
+	FOR (i, 0, nb_messages) {
+		u64 ctr = (text_sizes[i] >> 6) + 1;
+		input[i][12] = (u32) ctr;
+		input[i][13] = (u32)(ctr >> 32);
+		has_tail    |= (text_sizes[i] & 63) != 0;
+	}
+	if (has_tail) {
+		kernels->chacha20_rounds_x8(pool, input);
+		FOR (i, 0, nb_messages) {
+			FOR (j, 0, 16) {
+				store32_le(tails[i] + j * 4, pool[i][j] + input[i][j]);
+			}
+		}
+	}
+
+	// Bulk of each message
+	FOR (i, 0, nb_messages) {
+		u8       *out       = outs[i];
+		const u8 *in        = ins[i];
+		size_t    nb_blocks = text_sizes[i] >> 6;
+		size_t    tail_size = text_sizes[i] & 63;
+		crypto_poly1305_ctx poly_ctx;
+		auth_start(&poly_ctx, auth_keys[i], 0, 0);
+		input[i][12] = 1;
+		input[i][13] = 0;
+		kernels->aead_blocks(out, in, input[i], &poly_ctx, nb_blocks,
+		                     decrypt);
+		out += nb_blocks << 6;
+		in  += nb_blocks << 6;
+		if (tail_size > 0) {
+			if (decrypt) {
+				crypto_poly1305_update(&poly_ctx, in, tail_size);
+			}
+			FOR (j, 0, tail_size) {
+				out[j] = tails[i][j] ^ in[j];
+			}
+			if (!decrypt) {
+				crypto_poly1305_update(&poly_ctx, out, tail_size);
+			}
+		}
+		auth_finish(&poly_ctx, macs[i], 0, text_sizes[i]);
+	}
+	WIPE_BUFFER(input);
+	WIPE_BUFFER(pool);
+	WIPE_BUFFER(auth_keys);
+	WIPE_BUFFER(tails);
+}
+
+void crypto_aead_lock_batch(u8 *const *cipher_texts, u8 *macs,
+                            const u8 *keys, const u8 *nonces,
+                            const u8 *const *plain_texts,
+                            const size_t *text_sizes, size_t nb_messages)
+{
+	u8 real_macs[AEAD_BATCH][16];
+	for (size_t i = 0; i < nb_messages; i += AEAD_BATCH) {
+		size_t nb = MIN(nb_messages - i, AEAD_BATCH);
+		aead_batch(real_macs, cipher_texts + i, keys + i * 32,
+		           nonces + i * 24, plain_texts + i, text_sizes + i, nb, 0);
+		FOR (j, 0, nb) {
+			COPY(macs + (i + j) * 16, real_macs[j], 16);
+		}
+	}
+}
+
+// Every message is checked, and only forged ones are wiped.
+int crypto_aead_unlock_batch(u8 *const *plain_texts, const u8 *macs,
+                             const u8 *keys, const u8 *nonces,
+                             const u8 *const *cipher_texts,
+                             const size_t *text_sizes, size_t nb_messages)
+{
+	u8  real_macs[AEAD_BATCH][16];
+	int mismatch = 0;
+	for (size_t i = 0; i < nb_messages; i += AEAD_BATCH) {
+		size_t nb = MIN(nb_messages - i, AEAD_BATCH);
+		aead_batch(real_macs, plain_texts + i, keys + i * 32,
+		           nonces + i * 24, cipher_texts + i, text_sizes + i, nb, 1);
+		FOR (j, 0, nb) {
+			if (crypto_verify16(macs + (i + j) * 16, real_macs[j])) {
+				crypto_wipe(plain_texts[i + j], text_sizes[i + j]);
+				mismatch = -1;
+			}
+		}
+	}
+	WIPE_BUFFER(real_macs);
+	return mismatch;
+}
+
 #ifdef MONOCYPHER_CPP_NAMESPACE
 }
 #endif
@@ -77,8 +77,18 @@ int crypto_verify64(const uint8_t a[64], const uint8_t b[64]);
 void crypto_wipe(void *secret, size_t size);
 
 
+// CPU dispatch
+// ------------
+// Kernels picked at start up for Chacha20, Poly1305 and BLAKE2b:
+// "scalar", "ssse3", "avx2" or "avx512".
+const char *crypto_cpu_kernel(void);
+
+
 // Authenticated encryption
 // ------------------------
+// Encryption and authentication are done in a single pass.
+// On failure, unlock and read wipe plain_text (it is written to
+// while the cipher text is authenticated).
 void crypto_aead_lock(uint8_t       *cipher_text,
                       uint8_t        mac  [16],
                       const uint8_t  key  [32],
@@ -92,6 +102,29 @@ int crypto_aead_unlock(uint8_t       *plain_text,
                        const uint8_t *ad,          size_t ad_size,
                        const uint8_t *cipher_text, size_t text_size);
 
+// Batch interface (no additional data)
+// Message i uses keys + 32*i, nonces + 24*i and macs + 16*i.
+// Same results as one crypto_aead_lock() per message.  The key
+// derivations and authentication keys of up to 8 messages are
+// computed together, in SIMD lanes.
+// unlock_batch returns -1 if any message is forged, and wipes only
+// the plain texts of forged messages.  Cipher and plain texts may
+// be the same buffers (in place encryption).
+void crypto_aead_lock_batch(uint8_t       *const *cipher_texts,
+                            uint8_t              *macs,
+                            const uint8_t        *keys,
+                            const uint8_t        *nonces,
+                            const uint8_t *const *plain_texts,
+                            const size_t         *text_sizes,
+                            size_t                nb_messages);
+int crypto_aead_unlock_batch(uint8_t       *const *plain_texts,
+                             const uint8_t        *macs,
+                             const uint8_t        *keys,
+                             const uint8_t        *nonces,
+                             const uint8_t *const *cipher_texts,
+                             const size_t         *text_sizes,
+                             size_t                nb_messages);
+
 // Authenticated stream
 // --------------------
 typedef struct {
@@ -130,6 +163,14 @@ void crypto_blake2b_keyed(uint8_t *hash,          size_t hash_size,
                           const uint8_t *key,     size_t key_size,
                           const uint8_t *message, size_t message_size);
 
+// Multi-buffer interface
+// Hashes nb_messages messages of message_size bytes each, and writes
+// hash i at hashes + i * hash_size.  Messages are processed 4 at a
+// time in SIMD lanes when the CPU allows.
+void crypto_blake2b_multi(uint8_t *hashes, size_t hash_size,
+                          const uint8_t *const *messages, size_t nb_messages,
+                          size_t message_size);
+
 // Incremental interface
 typedef struct {
 	// Do not rely on the size or contents of this type,
@@ -148,6 +189,28 @@ void crypto_blake2b_update(crypto_blake2b_ctx *ctx,
                            const uint8_t *message, size_t message_size);
 void crypto_blake2b_final(crypto_blake2b_ctx *ctx, uint8_t *hash);
 
+// Tree hash (BLAKE2bp)
+// 4 BLAKE2b leaves over interleaved 128 byte blocks, and a root that
+// hashes the leaves.  With 64 byte hashes this is standard BLAKE2bp.
+// Leaves run in SIMD lanes, or in their own threads for updates of
+// 1MB or more (with MONOCYPHER_THREADS).  Not compatible with BLAKE2b.
+typedef struct {
+	// Do not rely on the size or contents of this type,
+	// for they may change without notice.
+	crypto_blake2b_ctx leaves[4];
+	uint8_t            buf[512];
+	size_t             buf_idx;
+	size_t             hash_size;
+} crypto_blake2bp_ctx;
+
+void crypto_blake2bp(uint8_t *hash,          size_t hash_size,
+                     const uint8_t *message, size_t message_size);
+
+void crypto_blake2bp_init(crypto_blake2bp_ctx *ctx, size_t hash_size);
+void crypto_blake2bp_update(crypto_blake2bp_ctx *ctx,
+                            const uint8_t *message, size_t message_size);
+void crypto_blake2bp_final(crypto_blake2bp_ctx *ctx, uint8_t *hash);
+
 
 // Password key derivation (Argon2)
 // --------------------------------
@@ -159,7 +222,7 @@ typedef struct {
 	uint32_t algorithm;  // Argon2d, Argon2i, Argon2id
 	uint32_t nb_blocks;  // memory hardness, >= 8 * nb_lanes
 	uint32_t nb_passes;  // CPU hardness, >= 1 (>= 3 recommended for Argon2i)
-	uint32_t nb_lanes;   // parallelism level (single threaded anyway)
+	uint32_t nb_lanes;   // parallelism level (see crypto_argon2_parallel())
 } crypto_argon2_config;
 
 typedef struct {
@@ -183,18 +246,36 @@ void crypto_argon2(uint8_t *hash, uint32_t hash_size, void *work_area,
                    crypto_argon2_inputs inputs,
                    crypto_argon2_extras extras);
 
+// Same hash, with one thread per lane when compiled with
+// MONOCYPHER_THREADS (sequential otherwise).
+void crypto_argon2_parallel(uint8_t *hash, uint32_t hash_size,
+                            void *work_area,
+                            crypto_argon2_config config,
+                            crypto_argon2_inputs inputs,
+                            crypto_argon2_extras extras);
+
 
 // Key exchange (X-25519)
 // ----------------------
 
 // Shared secrets are not quite random.
 // Hash them to derive an actual shared key.
+// Public keys use fixed base precomputed tables (a fraction of the
+// cost of crypto_x25519()).
 void crypto_x25519_public_key(uint8_t       public_key[32],
                               const uint8_t secret_key[32]);
 void crypto_x25519(uint8_t       raw_shared_secret[32],
                    const uint8_t your_secret_key  [32],
                    const uint8_t their_public_key [32]);
 
+// nb_keys independent exchanges, 32 bytes each in every array.
+// Same results as crypto_x25519(), 4 ladders at a time in SIMD lanes
+// when the CPU allows it.
+void crypto_x25519_batch(uint8_t       *raw_shared_secrets,
+                         const uint8_t *your_secret_keys,
+                         const uint8_t *their_public_keys,
+                         size_t         nb_keys);
+
 // Conversion to EdDSA
 void crypto_x25519_to_eddsa(uint8_t eddsa[32], const uint8_t x25519[32]);
 
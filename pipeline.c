@@ -0,0 +1,187 @@
+/*******************************************************************************
+ * Program:    Pipeline prenosu pre zabezpeceny prenos suborov
+ * Subor:      pipeline.c
+ * Autor:      Jozef Kovalcin
+ * Verzia:     1.0.0
+ * Datum:      11-03-2025
+ *
+ * Popis:
+ *     Implementacia stavebnych prvkov pipeline prenosu:
+ *     - Ohranicene fronty bez zamkov medzi dvoma vlaknami
+ *     - Cakanie s postupnym ustupenim, necinne vlakno sa uspi a nezatazuje jadro
+ *     - Pocet pracovnych vlakien podla dostupnych jadier
+ *
+ * Zavislosti:
+ *     - pipeline.h (deklaracie funkcii)
+ *     - errors.h (chybove hlasenia)
+ ******************************************************************************/
+
+#include <stdio.h>  // Kniznica pre standardny vstup a vystup (chybove hlasenia)
+#include <stdlib.h> // Kniznica pre spravu pamate
+
+#include "pipeline.h" // Deklaracie funkcii pipeline
+#include "errors.h"   // Chybove hlasenia
+
+// Alokacia fronty, kapacita sa zaokruhli nahor na mocninu 2 (index = pocitadlo & mask)
+// Vracia -1 ak sa pamat nepodarilo alokovat
+int spsc_queue_init(spsc_queue *queue, size_t capacity)
+{
+    size_t size = 2;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+    queue->slots = calloc(size, sizeof(void *));
+    if (queue->slots == NULL)
+    {
+        fprintf(stderr, ERR_PIPELINE_MEMORY);
+        return -1;
+    }
+    queue->mask = size - 1;
+    queue->head = 0;
+    queue->tail = 0;
+    return 0;
+}
+
+void spsc_queue_free(spsc_queue *queue)
+{
+    free(queue->slots);
+    queue->slots = NULL;
+}
+
+// Vlozenie polozky (vola len producent)
+// Zapis polozky je viditelny skor ako posunuty tail (release)
+int spsc_queue_push(spsc_queue *queue, void *item)
+{
+    size_t tail = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    if (tail - __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) > queue->mask)
+    {
+        return -1; // Plna fronta
+    }
+    queue->slots[tail & queue->mask] = item;
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Vyberie polozku (vola len konzument)
+void *spsc_queue_pop(spsc_queue *queue)
+{
+    size_t head = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    if (head == __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE))
+    {
+        return NULL; // Prazdna fronta
+    }
+    void *item = queue->slots[head & queue->mask];
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+    return item;
+}
+
+int pipeline_signal_init(pipeline_signal *signal)
+{
+    signal->epoch = 0;
+    signal->waiting = 0;
+    if (pthread_mutex_init(&signal->lock, NULL) != 0)
+    {
+        return -1;
+    }
+    if (pthread_cond_init(&signal->cond, NULL) != 0)
+    {
+        pthread_mutex_destroy(&signal->lock);
+        return -1;
+    }
+    return 0;
+}
+
+void pipeline_signal_destroy(pipeline_signal *signal)
+{
+    pthread_cond_destroy(&signal->cond);
+    pthread_mutex_destroy(&signal->lock);
+}
+
+// Oznamenie po vlozeni polozky
+// Zamok sa berie len ak konzument spi, inak je oznamenie jedna atomicka operacia
+void pipeline_notify(pipeline_signal *signal)
+{
+    __atomic_add_fetch(&signal->epoch, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&signal->waiting, __ATOMIC_SEQ_CST) > 0)
+    {
+        pthread_mutex_lock(&signal->lock);
+        pthread_cond_broadcast(&signal->cond);
+        pthread_mutex_unlock(&signal->lock);
+    }
+}
+
+unsigned pipeline_epoch(pipeline_signal *signal)
+{
+    return __atomic_load_n(&signal->epoch, __ATOMIC_SEQ_CST);
+}
+
+// Postupne ustupenie pri prazdnych frontach
+// Kratke cakanie sa vyriesi aktivne, dlhe (napr. disk alebo siet) vlakno uspi
+// Uspi sa len ak od zapamatania epochy neprisla ziadna polozka
+void pipeline_idle(pipeline_signal *signal, unsigned epoch, unsigned *attempt)
+{
+    if (*attempt < PIPELINE_SPIN_ATTEMPTS)
+    {
+        (*attempt)++;
+        return;
+    }
+    if (*attempt < 2 * PIPELINE_SPIN_ATTEMPTS)
+    {
+        (*attempt)++;
+        platform_yield();
+        return;
+    }
+    pthread_mutex_lock(&signal->lock);
+    __atomic_add_fetch(&signal->waiting, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&signal->epoch, __ATOMIC_SEQ_CST) == epoch)
+    {
+        pthread_cond_wait(&signal->cond, &signal->lock);
+    }
+    __atomic_sub_fetch(&signal->waiting, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&signal->lock);
+}
+
+void *spsc_queue_pop_wait(spsc_queue *queue, pipeline_signal *signal, const int *stop)
+{
+    unsigned attempt = 0;
+    for (;;)
+    {
+        unsigned epoch = pipeline_epoch(signal);
+        void *item = spsc_queue_pop(queue);
+        if (item != NULL)
+        {
+            return item;
+        }
+        if (pipeline_stopped(stop))
+        {
+            return NULL;
+        }
+        pipeline_idle(signal, epoch, &attempt);
+    }
+}
+
+void pipeline_stop(int *stop)
+{
+    __atomic_store_n(stop, 1, __ATOMIC_RELEASE);
+}
+
+int pipeline_stopped(const int *stop)
+{
+    return __atomic_load_n(stop, __ATOMIC_ACQUIRE);
+}
+
+// Jedno jadro zostava pre citanie/odosielanie, zvysok sifruje
+int pipeline_worker_count(void)
+{
+    int count = platform_cpu_count() - 1;
+    if (count < 1)
+    {
+        count = 1;
+    }
+    if (count > PIPELINE_MAX_WORKERS)
+    {
+        count = PIPELINE_MAX_WORKERS;
+    }
+    return count;
+}
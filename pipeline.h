@@ -0,0 +1,74 @@
+/*******************************************************************************
+ * Program:    Pipeline prenosu pre zabezpeceny prenos suborov
+ * Subor:      pipeline.h
+ * Autor:      Jozef Kovalcin
+ * Verzia:     1.0.0
+ * Datum:      11-03-2025
+ *
+ * Popis:
+ *     Hlavickovy subor pre pipeline prenosu:
+ *     - Ohranicene fronty bez zamkov (jeden producent, jeden konzument)
+ *     - Cakanie na frontu s postupnym ustupenim (spin, yield, uspanie vlakna)
+ *     - Signal pre prebudenie uspaneho konzumenta
+ *     - Spolocny priznak zastavenia vsetkych stupnov pipeline
+ *
+ * Zavislosti:
+ *     - constants.h (konstanty programu)
+ *     - platform.h (platform-specificke funkcie)
+ ******************************************************************************/
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stddef.h>  // Kniznica pre size_t
+#include <pthread.h> // Kniznica pre vlakna (uspanie necinneho konzumenta)
+
+#include "constants.h" // Definicie konstant pre program
+#include "platform.h"  // Pre funkcie specificke pre operacny system
+
+// Ohranicena fronta ukazovatelov bez zamkov pre jedneho producenta a jedneho konzumenta
+// Producent zapisuje len tail, konzument len head, kazdy je v inom riadku cache
+typedef struct
+{
+    void **slots;                                       // Kruh poloziek (kapacita je mocnina 2)
+    size_t mask;                                        // Kapacita - 1
+    char pad_head[PIPELINE_CACHE_LINE - sizeof(void **) - sizeof(size_t)];
+    size_t head;                                        // Dalsia polozka na vybratie (konzument)
+    char pad_tail[PIPELINE_CACHE_LINE - sizeof(size_t)];
+    size_t tail;                                        // Dalsie volne miesto (producent)
+    char pad_end[PIPELINE_CACHE_LINE - sizeof(size_t)];
+} spsc_queue;
+
+int spsc_queue_init(spsc_queue *queue, size_t capacity); // Alokuje frontu (kapacita sa zaokruhli na mocninu 2)
+void spsc_queue_free(spsc_queue *queue);                 // Uvolni frontu
+int spsc_queue_push(spsc_queue *queue, void *item);      // Vlozi polozku, -1 ak je fronta plna
+void *spsc_queue_pop(spsc_queue *queue);                 // Vyberie polozku, NULL ak je fronta prazdna
+
+// Signal jedneho konzumenta, producent ho oznami po kazdom vlozeni do fronty
+// Konzument si pred kontrolou front zapamata epochu a uspi sa len ak sa odvtedy nezmenila,
+// takze oznamenie medzi kontrolou a uspanim sa nestrati
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    unsigned epoch; // Zvysi sa pri kazdom oznameni
+    int waiting;    // Pocet uspanych konzumentov
+} pipeline_signal;
+
+int pipeline_signal_init(pipeline_signal *signal);
+void pipeline_signal_destroy(pipeline_signal *signal);
+void pipeline_notify(pipeline_signal *signal);         // Oznami novu polozku (prebudi konzumenta)
+unsigned pipeline_epoch(pipeline_signal *signal);      // Epocha pred kontrolou front
+void pipeline_idle(pipeline_signal *signal, unsigned epoch, unsigned *attempt); // Prazdne fronty: spin, yield, uspanie
+
+// Caka na polozku, kym sa pipeline nezastavi (vtedy vrati NULL)
+void *spsc_queue_pop_wait(spsc_queue *queue, pipeline_signal *signal, const int *stop);
+
+// Priznak zastavenia pipeline (zdielany vsetkymi vlaknami pipeline)
+// Po nastaveni treba oznamit signaly vsetkych konzumentov
+void pipeline_stop(int *stop);
+int pipeline_stopped(const int *stop);
+
+int pipeline_worker_count(void); // Pocet vlakien sifrovania klienta (podla poctu jadier)
+
+#endif // PIPELINE_H
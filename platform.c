@@ -9,6 +9,8 @@
  *     Implementacia platformovo-nezavislych operacii:
  *     - Generovanie kryptograficky bezpecnych nahodnych cisel
  *     - Bezpecne nacitanie hesla od uzivatela
+ *     - Monotonny cas pre casove limity spojeni
+ *     - Pocet jadier a pripnutie vlakna na jadro
  *
  * Zavislosti:
  *     - platform.h (deklaracie funkcii)
@@ -19,6 +21,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
+#ifndef _WIN32
+#include <sched.h>
+#endif
 
 #include "platform.h"
 #include "constants.h"
@@ -146,3 +152,109 @@ char *platform_getpass(const char *prompt)
 
     return password; // Vratenie ukazovatela na heslo
 }
+
+// Znizenie priority aktualneho vlakna (pre pracu na pozadi)
+// Na Linuxe sa nastavuje nice hodnota len pre toto vlakno
+void platform_lower_thread_priority(void)
+{
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(__linux__)
+    if (setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 19) != 0)
+    {
+        fprintf(stderr, "Warning: Failed to lower thread priority: %s\n", strerror(errno));
+    }
+#endif
+}
+
+// Monotonny cas v milisekundach, neovplyvnuje ho zmena systemoveho casu
+uint64_t platform_monotonic_ms(void)
+{
+#ifdef _WIN32
+    return (uint64_t)GetTickCount64();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+#endif
+}
+
+#ifdef __linux__
+// Maska jadier, na ktorych moze proces bezat (berie do uvahy taskset a cgroups)
+// Priamo cez syscall, cpu_set_t by vyzadoval _GNU_SOURCE
+#define CPU_MASK_WORDS 16 // Az 1024 jadier
+#define CPU_MASK_BITS (8 * sizeof(unsigned long))
+static int allowed_cpus(unsigned long *mask)
+{
+    memset(mask, 0, CPU_MASK_WORDS * sizeof(unsigned long));
+    return syscall(SYS_sched_getaffinity, 0, CPU_MASK_WORDS * sizeof(unsigned long), mask) > 0 ? 0 : -1;
+}
+#endif
+
+// Pocet jadier, na ktorych moze proces bezat (aspon 1)
+int platform_cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#elif defined(__linux__)
+    unsigned long mask[CPU_MASK_WORDS];
+    int count = 0;
+    if (allowed_cpus(mask) == 0)
+    {
+        for (size_t i = 0; i < CPU_MASK_WORDS; i++)
+        {
+            count += __builtin_popcountl(mask[i]);
+        }
+    }
+    return count > 0 ? count : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+// Pripnutie aktualneho vlakna na index-te dostupne jadro
+// Vlakno potom nemeni jadro a jeho data zostavaju v cache jedneho jadra
+void platform_pin_thread(int index)
+{
+#ifdef _WIN32
+    SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << (index % (8 * sizeof(DWORD_PTR))));
+#elif defined(__linux__)
+    unsigned long mask[CPU_MASK_WORDS];
+    unsigned long pinned[CPU_MASK_WORDS] = {0};
+    if (allowed_cpus(mask) != 0)
+    {
+        return;
+    }
+    index %= platform_cpu_count();
+    for (size_t cpu = 0; cpu < CPU_MASK_WORDS * CPU_MASK_BITS; cpu++)
+    {
+        if ((mask[cpu / CPU_MASK_BITS] >> (cpu % CPU_MASK_BITS)) & 1)
+        {
+            if (index-- == 0)
+            {
+                pinned[cpu / CPU_MASK_BITS] = 1UL << (cpu % CPU_MASK_BITS);
+                break;
+            }
+        }
+    }
+    if (syscall(SYS_sched_setaffinity, 0, sizeof(pinned), pinned) != 0)
+    {
+        fprintf(stderr, "Warning: Failed to pin thread to CPU: %s\n", strerror(errno));
+    }
+#else
+    (void)index; // Ostatne platformy: vlakna rozdeluje planovac
+#endif
+}
+
+// Uvolni jadro inemu vlaknu pripravenemu na beh (cakanie vlakien pipeline)
+void platform_yield(void)
+{
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
@@ -9,6 +9,8 @@
  *     Hlavickovy subor pre platformovo-nezavisle operacie:
  *     - Funkcie pre bezpecne generovanie nahodnych cisel
  *     - Platformovo nezavisle bezpecne nacitanie hesla
+ *     - Nizka priorita pre vlakna na pozadi
+ *     - Monotonny cas pre casove limity
  *
  * Zavislosti:
  *     - Standardne C kniznice
@@ -39,6 +41,7 @@ typedef int socklen_t;
 #else
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
@@ -49,6 +52,20 @@ typedef int socklen_t;
 #include <fcntl.h>
 #include <errno.h>
 #include <string.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#ifndef NO_IO_URING
+#define USE_IO_URING // io_uring backend slucky udalosti, ak ho jadro nepovoli pouzije sa epoll
+#include <sys/mman.h>
+#include <linux/io_uring.h>
+#endif
+#else
+#include <poll.h>
+#endif
 // Typy
 typedef int socket_t;
 #define INVALID_SOCKET_VALUE -1
@@ -58,4 +75,13 @@ typedef int socket_t;
 int platform_generate_random_bytes(uint8_t *buffer, size_t size);
 char *platform_getpass(const char *prompt);
 
+// Vlakna
+void platform_lower_thread_priority(void);
+int platform_cpu_count(void);        // Pocet jadier, na ktorych moze proces bezat
+void platform_pin_thread(int index); // Pripne aktualne vlakno na index-te dostupne jadro
+void platform_yield(void);           // Uvolni jadro inemu vlaknu
+
+// Cas
+uint64_t platform_monotonic_ms(void); // Monotonny cas v milisekundach (casove limity spojeni)
+
 #endif // PLATFORM_H
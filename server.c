@@ -8,6 +8,10 @@
  * Popis:
  *     Implementacia servera pre zabezpeceny prenos suborov. Program zabezpecuje:
  *     - Vytvorenie TCP servera a prijimanie spojeni
+ *     - Obsluhu viacerych klientov naraz (vlakna so sluckou udalosti na polovici jadier)
+ *     - Desifrovanie v zasobe vlakien na zvysnych jadrach a zapis na disk v poradi
+ *       niekolkymi zapisovacmi spolocnymi pre slucky
+ *     - Odvodenie hlavneho kluca (Argon2) vo vlaknach mimo slucky udalosti
  *     - Bezpecnu vymenu klucov s klientom
  *     - Prijimanie a desifrovanie suborov
  *     - Overovanie integrity prijatych dat
@@ -19,25 +23,22 @@
  *     - crypto_utils.h (kryptograficke operacie)
  *     - constants.h (konstanty programu)
  *     - platform.h (platform-specificke funkcie)
+ *     - pipeline.h (fronty pipeline prijmu)
  *******************************************************************************/
 
 // Systemove kniznice
-#include <stdio.h>  // Kniznica pre standardny vstup a vystup (nacitanie zo suborov, vypis na obrazovku)
-#include <stdlib.h> // Kniznica pre vseobecne funkcie (sprava pamate, konverzie, nahodne cisla)
-#include <string.h> // Kniznica pre pracu s retazcami (kopirovanie, porovnavanie, spajanie)
-#include <unistd.h> // Kniznica pre systemove volania UNIX (procesy, subory, sokety)
+#include <stdio.h>   // Kniznica pre standardny vstup a vystup (nacitanie zo suborov, vypis na obrazovku)
+#include <stdlib.h>  // Kniznica pre vseobecne funkcie (sprava pamate, konverzie, nahodne cisla)
+#include <string.h>  // Kniznica pre pracu s retazcami (kopirovanie, porovnavanie, spajanie)
+#include <unistd.h>  // Kniznica pre systemove volania UNIX (procesy, subory, sokety)
+#include <pthread.h> // Kniznica pre vlakna (jedno vlakno servera na jadro)
 
 #include "monocypher.h"   // Pre Monocypher kryptograficke funkcie
 #include "siete.h"        // Pre sietove funkcie
 #include "constants.h"    // Definicie konstant pre program
 #include "crypto_utils.h" // Pre kryptograficke funkcie
 #include "platform.h"     // Pre funkcie specificke pre operacny system
-
-// Globalne premenne pre kryptograficke operacie
-// Tieto premenne sa pouzivaju v celom programe pre desifrovacie operacie
-uint8_t key[KEY_SIZE];     // Hlavny sifrovaci kluc
-uint8_t nonce[NONCE_SIZE]; // Jednorazova hodnota pre kazdy blok
-uint8_t salt[SALT_SIZE];   // Sol pre odvodenie kluca
+#include "pipeline.h"     // Pre fronty pipeline prijmu
 
 #ifdef _WIN32
 // Implementacia getpass() pre Windows platformu
@@ -82,395 +83,1711 @@ char *getpass(const char *prompt)
 }
 #endif
 
-int main()
+// Stavy spojenia, kazdy stav caka na jednu spravu od klienta
+// Spojenie sa posunie dalej az ked je cela sprava v prijimacom bufferi
+typedef enum
 {
-    // Inicializacia sietovych prvkov
-    int server_fd, client_socket;
-    struct sockaddr_in client_addr;
-    int port;
-    char port_str[6]; // Max 5 cislic + null terminator
+    CONN_SALT,           // Sol pre odvodenie hlavneho kluca (klient medzitym zadava heslo)
+    CONN_KEY_DERIVATION, // Caka na vlakno odvodenia hlavneho kluca (complete_key_derivations)
+    CONN_KEY_VALIDATION, // Kontrolny kod hlavneho kluca
+    CONN_SETUP_START,    // Signal SESSION_SETUP_START
+    CONN_PEER_PUBLIC,    // Docasny verejny kluc klienta
+    CONN_SHARED_SECRET,  // Caka na davkovy vypocet X25519 (na konci kola slucky)
+    CONN_SESSION_NONCE,  // Nonce relacie
+    CONN_SESSION_VERIFY, // Kontrolny kod relacneho kluca
+    CONN_FILE_NAME,      // Nazov suboru
+    CONN_TRANSFER_MODE,  // Navrh rezimu prenosu a velkosti bloku
+    CONN_FRAME_SIZE,     // Velkost dalsieho bloku alebo riadiaca sprava
+    CONN_FRAME_DATA,     // Nonce, tag a data bloku
+    CONN_FRAME_CONTROL,  // Riadiaca sprava (rotacia kluca, EOF) caka na odovzdanie okna do pipeline
+    CONN_ROTATION,       // Nonce, signal a kontrolny kod rotacie kluca
+    CONN_DIGEST,         // Zasifrovany kontrolny sucet suboru
+    CONN_CLOSING         // Odosiela sa posledna odpoved, potom sa spojenie zatvori
+} conn_state;
+
+typedef struct server_worker server_worker;
+
+typedef struct connection connection;
+
+// Stav jedneho klienta
+struct connection
+{
+    server_worker *worker;                 // Vlakno, ktore spojenie obsluhuje
+    int socket;                            // Socket klienta
+    int slot;                              // Index v poli spojeni
+    int events;                            // Aktualne sledovane udalosti (EVENT_*)
+    conn_state state;                      // Na ktoru spravu spojenie caka
+    uint64_t deadline;                     // Kedy spojenie vyprsi bez dalsich dat
+    int timeout_ms;                        // Casovy limit aktualneho stavu
+    recv_buffer rb;                        // Prijimaci buffer
+    uint8_t out[CONNECTION_OUT_SIZE];      // Odpovede cakajuce na odoslanie
+    size_t out_len;                        // Pocet bajtov v out
+    uint8_t salt[SALT_SIZE];               // Sol klienta pre vlakno odvodenia kluca
+    uint8_t key[KEY_SIZE];                 // Hlavny kluc (Argon2 z hesla a soli klienta)
+    int kdf_result;                        // Vysledok derive_key_server (vlakno odvodenia)
+    int kdf_pending;                       // Kluc sa odvodzuje, vlakno odvodenia drzi ukazovatel na spojenie
+    connection *next;                      // Dalsie spojenie vo fronte odvodenia, v zozname hotovych alebo dobiehajucich
+    uint8_t ephemeral_secret[KEY_SIZE];    // Docasny tajny kluc
+    uint8_t peer_public[KEY_SIZE];         // Docasny verejny kluc klienta
+    uint8_t shared_secret[KEY_SIZE];       // Spolocny tajny kluc
+    uint8_t session_key[SESSION_KEY_SIZE]; // Kluc pre danu relaciu
+    crypto_aead_ctx stream_ctx;            // Prudovy kontext (TRANSFER_MODE_STREAM)
+    crypto_aead_ctx *stream;               // &stream_ctx alebo NULL v rezime s nonce
+    uint32_t chunk_size;                   // Dohodnuta velkost bloku
+    uint32_t frame_size;                   // Velkost prave prijimaneho bloku
+    size_t window_chunks;                  // Pocet blokov v okne (ohraniceny RECV_WINDOW_BUDGET)
+    chunk_window window;                   // Okno blokov, data ukazuju do prijimacieho buffera (pred odovzdanim do pipeline)
+    char file_name[FILE_NAME_BUFFER_SIZE]; // Nazov suboru od klienta
+    FILE *file;                            // Vystupny subor (NULL pred zaciatkom prenosu)
+    file_digest_ctx digest;                // Kontrolny sucet zapisanych dat
+    uint64_t total_bytes;                  // Celkovy pocet prijatych bajtov
+    uint64_t written_bytes;                // Pocet bajtov zapisanych do suboru (zapisovac)
+    uint64_t block_count;                  // Pocet prijatych blokov
+    uint64_t windows_sent;                 // Okna odovzdane do pipeline (slucka)
+    uint64_t windows_written;              // Okna spracovane zapisovacom (atomicky)
+    int failed;                            // Okno neproslo overenim alebo zapisom (atomicky)
+    int complete;                          // Prenos uspesne dokonceny
+    int recv_pending;                      // Prebieha asynchronne prijatie (io_uring)
+    int send_pending;                      // Prebieha asynchronne odoslanie odpovedi z out (io_uring)
+    int pipeline_wait;                     // Caka na zapisovac (volne okno alebo zapis vsetkych okien), citanie je pozastavene
+    int closed;                            // Spojenie je zatvorene, caka sa na dokoncenie operacii (atomicky)
+};
+
+// Okno blokov v pipeline prijmu
+// Slucka do neho skopiruje prijate ramce a kluc, vlakno desifrovania ho overi
+// a desifruje na mieste, zapisovac ho zapise do suboru a vrati slucke
+typedef struct
+{
+    chunk_window window;           // Vlastna kopia ramcov okna (prijimaci buffer sa medzitym posuva)
+    crypto_aead_ctx stream;        // Prudovy kontext na zaciatku okna (prudovy rezim)
+    uint8_t key[SESSION_KEY_SIZE]; // Relacny kluc okna (rezim s nonce)
+    int stream_mode;               // Okno je v prudovom rezime
+    int failed;                    // Okno neproslo overenim
+    connection *conn;              // Spojenie, do ktoreho suboru okno patri
+} recv_item;
+
+// Vlakno desifrovania, spolocne pre vsetky slucky udalosti
+typedef struct
+{
+    int index;
+    pthread_t thread;
+    pipeline_signal signal; // Slucky oznamia nove okno v niektorej z front vlakna
+} decrypt_worker;
 
-    // Inicializacia Winsock pre Windows platformu
-    initialize_network();
+// Zapisovac suborov, spolocny pre skupinu sluciek udalosti (slucka n patri zapisovacu n % pocet)
+typedef struct
+{
+    int index;
+    pthread_t thread;
+    pipeline_signal signal; // Vlakno desifrovania dokoncilo okno niektorej zo sluciek zapisovaca
+} file_writer;
+
+// Vlakno servera so sluckou udalosti (pripnute na jadro)
+// Ma vlastny pocuvajuci socket, slucku udalosti a spojenia, so zvyskom servera
+// nezdiela nic okrem hesla (len na citanie), preto datova cesta nepotrebuje zamky
+struct server_worker
+{
+    int id;                                                     // Poradove cislo vlakna (aj jadro)
+    int listen_fd;                                              // Pocuvajuci socket (SO_REUSEPORT)
+    pthread_t thread;                                           // Vlakno
+    event_loop *loop;                                           // Slucka udalosti
+    connection *connections[MAX_CLIENT_CONNECTIONS];            // Aktivne spojenia
+    int connection_count;                                       // Pocet aktivnych spojeni
+    uint8_t exchange_secrets[MAX_CLIENT_CONNECTIONS][KEY_SIZE]; // Vstupy davkoveho X25519
+    uint8_t exchange_publics[MAX_CLIENT_CONNECTIONS][KEY_SIZE];
+    uint8_t exchange_shared[MAX_CLIENT_CONNECTIONS][KEY_SIZE];  // Vystupy davkoveho X25519
+    pthread_mutex_t derived_lock;                               // Chrani derived
+    connection *derived;                                        // Spojenia s odvodenym hlavnym klucom (vlakno odvodenia -> slucka)
+
+    // Pipeline prijmu: slucka -> vlakna desifrovania -> zapisovac -> slucka
+    // Okno n ide vlaknu desifrovania n % pocet a zapisovac ich vybera v rovnakom poradi,
+    // takze kazda fronta ma jedneho producenta a jedneho konzumenta a subory sa zapisuju v poradi
+    recv_item *items;                                // Okna v obehu (ohranicuju pamat pipeline)
+    int item_count;                                  // Pocet okien
+    uint64_t dispatched;                             // Pocet okien odovzdanych vlaknam desifrovania
+    spsc_queue free_items;                           // Zapisovac -> slucka (volne okna)
+    spsc_queue decrypt_work[PIPELINE_MAX_WORKERS];   // Slucka -> vlakno desifrovania
+    spsc_queue decrypt_done[PIPELINE_MAX_WORKERS];   // Vlakno desifrovania -> zapisovac
+    int pipeline_waiting;                            // Pocet spojeni cakajucich na zapisovac (pipeline_wait)
+    connection *draining;                            // Zatvorene spojenia s oknami v pipeline
+    file_writer *writer;                             // Zapisovac okien slucky
+    uint64_t written;                                // Pocet okien slucky spracovanych zapisovacom (len zapisovac)
+};
+
+// Zasoba vlakien desifrovania, zdielaju ju vsetky slucky udalosti
+// Okna jedneho spojenia sa tak desifruju na viacerych jadrach naraz
+static struct
+{
+    decrypt_worker workers[PIPELINE_MAX_WORKERS];
+    int count;              // Pocet vlakien desifrovania
+    int started;            // Pocet spustenych vlakien
+    server_worker **loops;  // Slucky udalosti (producenti okien)
+    int loop_count;
+    int stop;               // Zastavenie pipeline pri ukonceni servera
+} decrypt_pool;
+
+// Zapisovace suborov, zapis caka hlavne na disk, preto ich staci par pre vsetky slucky
+static struct
+{
+    file_writer writers[PIPELINE_MAX_WRITERS];
+    int count;   // Pocet zapisovacov
+    int started; // Pocet spustenych zapisovacov
+} writer_pool;
+
+// Vlakna odvodenia hlavneho kluca, spolocne pre vsetky slucky udalosti
+// Argon2 trva stovky milisekund, v slucke by na ten cas zastavil vsetky jej spojenia
+static struct
+{
+    pthread_t threads[KEY_DERIVATION_WORKERS];
+    int started;           // Pocet spustenych vlakien
+    pthread_mutex_t lock;  // Chrani frontu a stop
+    pthread_cond_t cond;   // Nove spojenie vo fronte alebo zastavenie
+    connection *head;      // Spojenia cakajuce na odvodenie (v poradi prijatia soli)
+    connection *tail;
+    int stop;              // Zastavenie vlakien po vyprazdneni fronty
+} key_derivation = {.lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER};
+
+static char server_password[PASSWORD_BUFFER_SIZE]; // Heslo zadane pri starte servera
+
+// Nastavi stav spojenia a jeho casovy limit
+static void conn_set_state(connection *conn, conn_state state, int timeout_ms)
+{
+    conn->state = state;
+    conn->timeout_ms = timeout_ms;
+    conn->deadline = platform_monotonic_ms() + (uint64_t)timeout_ms;
+}
 
-    // Ziadanie cisla portu od uzivatela
-    printf(PORT_PROMPT);
-    if (fgets(port_str, sizeof(port_str), stdin) == NULL)
+// Pri io_uring sa data prijimaju asynchronne priamo do buffera, na EVENT_READ sa neceka
+// Spojenie cakajuce na zapisovac necita (spatny tlak od disku a vlakien desifrovania)
+static int conn_read_events(connection *conn)
+{
+    return event_loop_async(conn->worker->loop) || conn->pipeline_wait ? 0 : EVENT_READ;
+}
+
+// Zmena sledovanych udalosti socketu (epoll/poll), pri io_uring sa socket nesleduje
+static void conn_watch(connection *conn)
+{
+    if (event_loop_async(conn->worker->loop))
     {
-        fprintf(stderr, ERR_PORT_READ);
-        cleanup_network();
-        return -1;
+        return;
     }
-
-    // Konverzia portu na integer a validacia
-    char *endptr;
-    long port_long = strtol(port_str, &endptr, 10);
-    if (endptr == port_str || *endptr != '\n' || port_long < 1 || port_long > 65535)
+    int events = conn_read_events(conn) | (conn->out_len > 0 ? EVENT_WRITE : 0);
+    if (events != conn->events)
     {
-        fprintf(stderr, ERR_PORT_INVALID);
-        cleanup_network();
-        return -1;
+        event_loop_modify(conn->worker->loop, conn->socket, events, conn);
+        conn->events = events;
     }
-    port = (int)port_long;
+}
 
-    // Vytvorenie a konfiguracia servera
-    if ((server_fd = setup_server(port)) < 0)
+// Spojenie pocka na zapisovac, slucka ho znovu spracuje po jeho prebudeni (resume_connections)
+static void conn_wait_pipeline(connection *conn)
+{
+    if (!conn->pipeline_wait)
     {
-        fprintf(stderr, ERR_SOCKET_SETUP, strerror(errno));
-        cleanup_network();
-        return -1;
+        conn->pipeline_wait = 1;
+        conn->worker->pipeline_waiting++;
+        conn_watch(conn);
     }
+}
 
-    printf(LOG_SERVER_START, port);
+// Zapisovac spracoval vsetky okna spojenia
+// Az potom je kontrolny sucet a pocet zapisanych bajtov uplny a spojenie sa moze uvolnit
+static int conn_drained(connection *conn)
+{
+    return __atomic_load_n(&conn->windows_written, __ATOMIC_ACQUIRE) == conn->windows_sent;
+}
 
-    if ((client_socket = accept_client_connection(server_fd, &client_addr)) < 0)
+// Uvolnenie spracovanych sprav z prijimacieho buffera
+// Nesmie sa posuvat, kym v nom su drzane ramce alebo do neho pise jadro
+static void conn_release(connection *conn)
+{
+    if (conn->window.count == 0 && !conn->recv_pending)
     {
-        fprintf(stderr, ERR_CLIENT_ACCEPT, strerror(errno));
-        cleanup_sockets(client_socket, server_fd);
-        return -1;
+        recv_buffer_release(&conn->rb);
     }
+}
 
-    // Inicializacia bezpecneho spojenia
-    if (send_ready_signal(client_socket) < 0)
+// Asynchronne prijatie do volneho miesta prijimacieho buffera (io_uring)
+// Ak je buffer plny, prijatie sa nastavi az po odovzdani drzanych ramcov do pipeline
+static int conn_arm_recv(connection *conn)
+{
+    recv_buffer *rb = &conn->rb;
+    if (!event_loop_async(conn->worker->loop) || conn->closed || conn->recv_pending)
     {
-        fprintf(stderr, ERR_HANDSHAKE);
-        cleanup_sockets(client_socket, server_fd);
-        return -1;
+        return 0;
     }
-
-    // Prijatie soli od klienta
-    uint8_t salt[SALT_SIZE];
-    if (receive_salt(client_socket, salt) < 0)
+    conn_release(conn);
+    if (rb->end == rb->capacity || conn->pipeline_wait)
     {
-        fprintf(stderr, ERR_SALT_RECEIVE);
-        cleanup_sockets(client_socket, server_fd);
-        return -1;
+        return 0;
     }
-
-    // Nacitanie hesla od uzivatela a odvodenie hlavneho kluca pomocou Argon2
-    // Heslo sa pouzije na generovanie kluca, ktory sa pouzije na sifrovanie dat
-    char *password = platform_getpass(PASSWORD_PROMPT);
-    if (derive_key_server(password, salt, key, salt) != 0)
+    if (event_loop_recv(conn->worker->loop, conn->socket, rb->data + rb->end, rb->capacity - rb->end, conn) < 0)
     {
-        fprintf(stderr, ERR_KEY_DERIVATION);
-        cleanup_sockets(client_socket, server_fd);
         return -1;
     }
+    conn->recv_pending = 1;
+    return 0;
+}
 
-    // Prijatie a overenie validacie kluca od klienta
-    uint8_t client_key_validation[VALIDATION_SIZE];
-    uint8_t server_key_validation[VALIDATION_SIZE];
+// Odosle cakajuce odpovede, zvysok sa dokonci pri udalosti EVENT_WRITE
+// Pri io_uring sa odpovede odoslu cez kruh spolu s prijatiami v dalsom kole slucky,
+// odpovede pridane pocas odosielania sa poslu po jeho dokonceni (conn_sent)
+static int conn_flush(connection *conn)
+{
+    if (event_loop_async(conn->worker->loop))
+    {
+        if (conn->out_len == 0 || conn->send_pending)
+        {
+            return 0;
+        }
+        if (event_loop_send(conn->worker->loop, conn->socket, conn->out, conn->out_len, conn) < 0)
+        {
+            return -1;
+        }
+        conn->send_pending = 1;
+        return 0;
+    }
 
-    if (recv_all(client_socket, client_key_validation, VALIDATION_SIZE) != VALIDATION_SIZE)
+    while (conn->out_len > 0)
     {
-        fprintf(stderr, ERR_KEY_VALIDATION_RECEIVE);
-        cleanup_sockets(client_socket, server_fd);
-        return -1;
+        ssize_t sent = send(conn->socket, (const char *)conn->out, conn->out_len, SEND_FLAGS);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent < 0 && SOCKET_WOULD_BLOCK())
+        {
+            break;
+        }
+        if (sent <= 0)
+        {
+            return -1;
+        }
+        memmove(conn->out, conn->out + sent, conn->out_len - (size_t)sent);
+        conn->out_len -= (size_t)sent;
     }
+    conn_watch(conn);
+    return 0;
+}
 
-    generate_key_validation(server_key_validation, key);
-    if (memcmp(client_key_validation, server_key_validation, VALIDATION_SIZE) != 0)
+// Zaradi odpoved na odoslanie a skusi ju hned poslat
+static int conn_send(connection *conn, const void *data, size_t size)
+{
+    if (size > sizeof(conn->out) - conn->out_len)
     {
-        fprintf(stderr, ERR_MASTER_KEY_MISMATCH);
-        cleanup_sockets(client_socket, server_fd);
         return -1;
     }
+    memcpy(conn->out + conn->out_len, data, size);
+    conn->out_len += size;
+    return conn_flush(conn);
+}
 
-    printf(MSG_MASTER_KEY_MATCH);
+// Odosle riadiacu hodnotu (ako send_chunk_size_reliable)
+static int conn_send_u32(connection *conn, uint32_t value)
+{
+    uint32_t net_value = htonl(value);
+    return conn_send(conn, &net_value, sizeof(net_value));
+}
 
-    // Premenne pre vymenu klucov
-    uint8_t ephemeral_secret[KEY_SIZE];    // Docasny tajny kluc
-    uint8_t ephemeral_public[KEY_SIZE];    // Docasny verejny kluc
-    uint8_t peer_public[KEY_SIZE];         // Verejny kluc od servera
-    uint8_t shared_secret[KEY_SIZE];       // Spolocny tajny kluc
-    uint8_t session_key[SESSION_KEY_SIZE]; // Kluc pre danu relaciu
-    uint8_t session_nonce[NONCE_SIZE];     // Nonce pre danu relaciu
+// Nove spojenie: posle READY a caka na sol
+static void conn_open(server_worker *worker, int socket)
+{
+    if (worker->connection_count >= MAX_CLIENT_CONNECTIONS)
+    {
+        fprintf(stderr, ERR_CONNECTION_LIMIT);
+        cleanup_socket(socket);
+        return;
+    }
 
-    // Odoslanie potvrdenia kluca klientovi
-    if (send_key_acknowledgment(client_socket) < 0)
+    connection *conn = calloc(1, sizeof(connection));
+    if (conn == NULL || recv_buffer_init(&conn->rb, socket, RECV_SLAB_SIZE) < 0)
     {
-        fprintf(stderr, ERR_KEY_ACK);
-        cleanup_sockets(client_socket, server_fd);
-        return -1;
+        free(conn);
+        cleanup_socket(socket);
+        return;
+    }
+    SET_NONBLOCKING(socket);
+    conn->worker = worker;
+    conn->socket = socket;
+    conn->events = conn_read_events(conn);
+    if (event_loop_add(worker->loop, socket, conn->events, conn) < 0)
+    {
+        recv_buffer_free(&conn->rb);
+        free(conn);
+        cleanup_socket(socket);
+        return;
     }
+    conn->slot = worker->connection_count;
+    worker->connections[worker->connection_count++] = conn;
 
-    // Cakanie na inicializaciu relacie
-    uint32_t setup_status;
-    if (receive_chunk_size_reliable(client_socket, &setup_status) < 0 ||
-        setup_status != SESSION_SETUP_START)
+    // Klient po READY zadava heslo, preto dlhsi limit
+    conn_set_state(conn, CONN_SALT, PASSWORD_WAIT_TIMEOUT_MS);
+    if (conn_send(conn, MAGIC_READY, SIGNAL_SIZE) < 0 || conn_arm_recv(conn) < 0)
     {
-        fprintf(stderr, ERR_SESSION_SETUP);
-        cleanup_sockets(client_socket, server_fd);
-        return -1;
+        fprintf(stderr, ERR_READY_SIGNAL);
     }
+}
 
-    printf(LOG_SESSION_START);
+// Uvolnenie spojenia a bezpecne vymazanie vsetkych jeho klucov a dat
+static void conn_free(connection *conn)
+{
+    if (conn->file != NULL)
+    {
+        fclose(conn->file);
+        file_digest_wipe(&conn->digest); // Pri preruseni prenosu sa sucet nedokoncil
+    }
+    chunk_window_free(&conn->window);
+    recv_buffer_free(&conn->rb);
+    secure_wipe(conn, sizeof(connection));
+    free(conn);
+}
 
-    // Generovanie docasneho klucoveho paru (verejny a tajny kluc)
-    // Tieto kluce sa pouziju na zabezpecenie forward secrecy
-    generate_ephemeral_keypair(ephemeral_public, ephemeral_secret);
+// Zatvorene spojenie sa uvolni, az ked nan neodkazuje ziadna prebiehajuca operacia
+// (asynchronne prijatie, odoslanie alebo vlakno odvodenia kluca)
+// Okna v pipeline odkazuju na subor a kontrolny sucet spojenia, kym ich zapisovac nespracuje,
+// spojenie caka v zozname dobiehajucich (free_drained)
+static void conn_try_free(connection *conn)
+{
+    if (!conn->closed || conn->recv_pending || conn->send_pending || conn->kdf_pending)
+    {
+        return;
+    }
+    if (!conn_drained(conn))
+    {
+        conn->next = conn->worker->draining;
+        conn->worker->draining = conn;
+        return;
+    }
+    conn_free(conn);
+}
 
-    // Nastavenie casovaceho limitu pre vymenu klucov
-    set_socket_timeout(client_socket, KEY_EXCHANGE_TIMEOUT_MS);
+// Zatvorenie spojenia
+// Prebiehajuce asynchronne prijatie a odoslanie drzia ukazovatel na spojenie,
+// pamat sa preto uvolni az po ich dokonceni (conn_complete, conn_sent)
+static void conn_close(connection *conn)
+{
+    if (conn->file != NULL && !conn->complete)
+    {
+        fprintf(stderr, ERR_TRANSFER_INTERRUPTED);
+    }
+    server_worker *worker = conn->worker;
+    event_loop_remove(worker->loop, conn->socket);
+    if (conn->recv_pending || conn->send_pending)
+    {
+        event_loop_cancel(worker->loop, conn);
+    }
+    cleanup_socket(conn->socket);
 
-    if (send_all(client_socket, ephemeral_public, KEY_SIZE) != KEY_SIZE ||
-        recv_all(client_socket, peer_public, KEY_SIZE) != KEY_SIZE)
+    worker->connection_count--;
+    worker->connections[conn->slot] = worker->connections[worker->connection_count];
+    worker->connections[conn->slot]->slot = conn->slot;
+    if (conn->pipeline_wait)
     {
-        fprintf(stderr, ERR_KEY_EXCHANGE);
-        cleanup_sockets(client_socket, server_fd);
-        return -1;
+        conn->pipeline_wait = 0;
+        worker->pipeline_waiting--;
     }
 
-    // Vypocet spolocneho tajneho kluca pomocou Diffie-Hellman
-    // Tento kluc sa pouzije na zabezpecenie komunikacie medzi klientom a serverom
-    compute_shared_secret(shared_secret, ephemeral_secret, peer_public);
+    __atomic_store_n(&conn->closed, 1, __ATOMIC_RELEASE); // Vlakno odvodenia zatvorene spojenie preskoci
+    conn_try_free(conn);
+}
 
-    // Prijatie session nonce od klienta
-    if (recv_all(client_socket, session_nonce, NONCE_SIZE) != NONCE_SIZE)
+// Zaradenie spojenia do fronty odvodenia hlavneho kluca
+static void key_derivation_submit(connection *conn)
+{
+    conn->kdf_pending = 1;
+    conn->next = NULL;
+    pthread_mutex_lock(&key_derivation.lock);
+    if (key_derivation.tail != NULL)
     {
-        fprintf(stderr, ERR_SESSION_NONCE);
-        cleanup_sockets(client_socket, server_fd);
-        return -1;
+        key_derivation.tail->next = conn;
+    }
+    else
+    {
+        key_derivation.head = conn;
     }
+    key_derivation.tail = conn;
+    pthread_cond_signal(&key_derivation.cond);
+    pthread_mutex_unlock(&key_derivation.lock);
+}
 
-    // Nastavenie relacneho kluca
-    setup_session(session_key, key, shared_secret, session_nonce);
+// Odovzdanie okna blokov do pipeline (desifrovanie vo vlaknach, zapis v poradi)
+// Ramce sa skopiruju do volneho okna, prijimaci buffer sa potom moze hned posunut
+// Kluc a prudovy kontext urcuje slucka: okno dostane kopiu kontextu a slucka ho posunie
+// o pocet blokov, takze rotacia kluca nemusi cakat na desifrovanie predchadzajucich okien
+// Ak nie je volne okno, spojenie pocka na zapisovac a medzitym necita (spatny tlak)
+// Vracia 1 ak je okno odovzdane (alebo prazdne), 0 ak treba pockat, -1 pri chybe
+static int conn_flush_window(connection *conn)
+{
+    chunk_window *window = &conn->window;
+    if (window->count == 0)
+    {
+        return 1;
+    }
+    if (__atomic_load_n(&conn->failed, __ATOMIC_ACQUIRE))
+    {
+        fprintf(stderr, ERR_CHUNK_PROCESS);
+        return -1;
+    }
 
-    // Overenie session key
-    uint8_t session_verify[32];
+    server_worker *worker = conn->worker;
+    recv_item *item = spsc_queue_pop(&worker->free_items);
+    if (item == NULL)
+    {
+        conn_wait_pipeline(conn);
+        return 0;
+    }
 
-    if (recv_all(client_socket, session_verify, sizeof(session_verify)) != sizeof(session_verify))
+    // Okno sa alokuje az pri prvom pouziti, podla bloku a poctu blokov spojenia
+    int result = 0;
+    if (item->window.chunk_size < conn->chunk_size || item->window.capacity < window->count)
     {
-        fprintf(stderr, ERR_SESSION_VERIF_RECEIVE_C);
-        cleanup_sockets(client_socket, server_fd);
-        return -1;
+        chunk_window_free(&item->window);
+        if (chunk_window_init(&item->window, conn->chunk_size, conn->window_chunks) < 0)
+        {
+            // Prazdne okno aj tak prejde pipeline, zapisovac ho vrati medzi volne
+            __atomic_store_n(&conn->failed, 1, __ATOMIC_RELEASE);
+            result = -1;
+        }
     }
-    // Vytvorenie kontrolneho kodu pre overenie kluca
-    if (!verify_session_verification(session_verify, session_key))
+
+    chunk_window *copy = &item->window;
+    copy->count = result == 0 ? window->count : 0;
+    for (size_t i = 0; i < copy->count; i++)
     {
-        fprintf(stderr, ERR_SESSION_VERIF_MISMATCH);
-        cleanup_sockets(client_socket, server_fd);
-        return -1;
+        memcpy(copy->data[i], window->data[i], window->sizes[i]);
+        memcpy(copy->nonces[i], window->nonces[i], NONCE_SIZE);
+        memcpy(copy->tags[i], window->tags[i], TAG_SIZE);
+        copy->sizes[i] = window->sizes[i];
+        conn->total_bytes += window->sizes[i];
+        conn->block_count++;
     }
-    // Pošli svoj HMAC klientovi
-    generate_session_verification(session_verify, session_key);
-    if (send_all(client_socket, session_verify, sizeof(session_verify)) != sizeof(session_verify))
+
+    item->conn = conn;
+    item->failed = 0;
+    item->stream_mode = conn->stream != NULL;
+    memcpy(item->key, conn->session_key, SESSION_KEY_SIZE);
+    if (conn->stream != NULL)
     {
-        fprintf(stderr, ERR_KEY_SESSION_VERIF);
-        cleanup_sockets(client_socket, server_fd);
-        return -1;
+        item->stream = *conn->stream;
+        aead_stream_skip(conn->stream, window->count);
     }
+    window->count = 0;
+    conn->windows_sent++;
 
-    // Bezpecne vymazanie citlivych dat
-    secure_wipe(ephemeral_secret, KEY_SIZE);
-    secure_wipe(shared_secret, KEY_SIZE);
+    // Fronty maju miesto pre vsetky okna slucky, vlozenie nezlyha
+    decrypt_worker *decryptor = &decrypt_pool.workers[worker->dispatched++ % decrypt_pool.count];
+    spsc_queue_push(&worker->decrypt_work[decryptor->index], item);
+    pipeline_notify(&decryptor->signal);
 
-    // Potvrdenie nastavenia relacie
-    if (send_chunk_size_reliable(client_socket, SESSION_SETUP_DONE) < 0)
+    if (result < 0)
     {
-        fprintf(stderr, ERR_SESSION_CONFIRM);
-        cleanup_sockets(client_socket, server_fd);
+        fprintf(stderr, ERR_CHUNK_PROCESS);
         return -1;
     }
+    return 1;
+}
 
-    printf(LOG_SESSION_COMPLETE);
+// Zaciatok prenosu: prudovy kontext, okno blokov a vystupny subor
+static int conn_start_transfer(connection *conn, uint32_t transfer_mode, const uint8_t *stream_nonce)
+{
+    printf(LOG_TRANSFER_MODE, transfer_mode == TRANSFER_MODE_STREAM ? "stream" : "nonce per chunk");
+    printf(LOG_CHUNK_SIZE, (unsigned)conn->chunk_size);
 
-    // Nastavenie casovaceho limitu pre prijem nazvu suboru
-    set_socket_timeout(client_socket, WAIT_FILE_NAME);
+    // Prudovy rezim: jeden kontext AEAD az do dalsej rotacie kluca
+    if (transfer_mode == TRANSFER_MODE_STREAM)
+    {
+        crypto_aead_init_x(&conn->stream_ctx, conn->session_key, stream_nonce);
+        conn->stream = &conn->stream_ctx;
+    }
 
-    char file_name[FILE_NAME_BUFFER_SIZE];
-    if (receive_file_name(client_socket, file_name, sizeof(file_name)) < 0)
+    // Okno drzi najviac RECV_WINDOW_BUDGET bajtov dat, pri velkych blokoch ma menej blokov
+    // Tym je ohranicena pamat prijimacieho buffera aj okien v pipeline
+    conn->window_chunks = RECV_WINDOW_BUDGET / conn->chunk_size;
+    if (conn->window_chunks < 1)
     {
-        fprintf(stderr, ERR_FILENAME_RECEIVE, strerror(errno));
-        cleanup_sockets(client_socket, server_fd);
-        return -1;
+        conn->window_chunks = 1;
+    }
+    if (conn->window_chunks > AEAD_WINDOW_CHUNKS)
+    {
+        conn->window_chunks = AEAD_WINDOW_CHUNKS;
     }
 
-    // Resetovanie casovaceho limitu na mensiu hodnotu pre prenos dat
-    set_socket_timeout(client_socket, SOCKET_TIMEOUT_MS);
+    // Prijimaci buffer pojme cele okno ramcov a jeden usek citania
+    // Data blokov v okne ukazuju priamo do neho, kym sa okno neskopiruje do pipeline
+    size_t frame_size = sizeof(uint32_t) + NONCE_SIZE + TAG_SIZE + conn->chunk_size;
+    if (conn->recv_pending ||
+        recv_buffer_resize(&conn->rb, conn->window_chunks * frame_size + RECV_SLAB_SIZE) < 0)
+    {
+        return -1;
+    }
+    chunk_window_init(&conn->window, 0, 0);
 
-    // Spracovanie novo prijateho suboru
     // Vytvorenie noveho nazvu suboru pridanim predpony 'received_'
     char new_file_name[NEW_FILE_NAME_BUFFER_SIZE];
-    snprintf(new_file_name, sizeof(new_file_name), "%s%s", FILE_PREFIX, file_name);
-
-    // Otvorenie noveho suboru pre binarny zapis
-    // Kontrola uspesnosti vytvorenia suboru
-    FILE *file = fopen(new_file_name, FILE_MODE_WRITE);
-    if (!file)
+    snprintf(new_file_name, sizeof(new_file_name), "%s%s", FILE_PREFIX, conn->file_name);
+    conn->file = fopen(new_file_name, FILE_MODE_WRITE);
+    if (!conn->file)
     {
         fprintf(stderr, ERR_FILE_CREATE, new_file_name, strerror(errno));
-        cleanup_sockets(client_socket, server_fd);
         return -1;
     }
+    file_digest_init(&conn->digest);
+    printf(LOG_TRANSFER_START);
+    return 0;
+}
 
-    // Inicializacia premennych pre sledovanie prenosu
-    uint64_t total_bytes = 0;  // Celkovy pocet prijatych bajtov
-    int transfer_complete = 0; // Stav prenosu (0 = prebieha, 1 = uspesne dokonceny, -1 = chyba)
+// Spracovanie jednej spravy podla stavu spojenia
+// Vracia 1 ak sa spojenie posunulo, 0 ak caka na dalsie data, -1 pri chybe
+static int conn_step(connection *conn)
+{
+    recv_buffer *rb = &conn->rb;
+    uint8_t *p;
+    int r;
 
-    printf(LOG_TRANSFER_START);
+    // Bez drzanych ramcov sa zvysok posledneho citania presunie na zaciatok buffera
+    conn_release(conn);
 
-    // Buffers pre prenos dat
-    // ciphertext: Zasifrovane data z klienta
-    // plaintext: Desifrovane data pre zapis
-    // tag: Autentizacny tag pre overenie integrity
-    uint8_t ciphertext[TRANSFER_BUFFER_SIZE]; // Buffer pre zasifrovane data
-    uint8_t plaintext[TRANSFER_BUFFER_SIZE];  // Buffer pre desifrovane data
-    uint8_t tag[TAG_SIZE];                    // Buffer pre autentizacny tag
+    switch (conn->state)
+    {
+    case CONN_SALT:
+        // Hlavny kluc z hesla a soli klienta (Argon2) odvodi vlakno odvodenia,
+        // slucka medzitym obsluhuje ostatne spojenia
+        if (!recv_buffer_read(rb, conn->salt, SALT_SIZE))
+        {
+            return 0;
+        }
+        conn_set_state(conn, CONN_KEY_DERIVATION, KEY_DERIVATION_TIMEOUT_MS);
+        key_derivation_submit(conn);
+        return 0;
 
-    // Prenos suboru s rotaciou klucov
-    uint64_t block_count = 0;
-    uint8_t buffer[TRANSFER_BUFFER_SIZE];
-    uint8_t previous_key[KEY_SIZE];
+    case CONN_KEY_DERIVATION:
+        return 0;
 
-    // Premenna pre sledovanie postupu
-    uint64_t last_progress_update = 0;
+    case CONN_KEY_VALIDATION:
+    {
+        uint8_t server_key_validation[VALIDATION_SIZE];
+        if ((p = recv_buffer_take(rb, VALIDATION_SIZE)) == NULL)
+        {
+            return 0;
+        }
+        generate_key_validation(server_key_validation, conn->key);
+        if (memcmp(p, server_key_validation, VALIDATION_SIZE) != 0)
+        {
+            fprintf(stderr, ERR_MASTER_KEY_MISMATCH);
+            return -1;
+        }
+        printf(MSG_MASTER_KEY_MATCH);
+        if (conn_send(conn, MAGIC_KEYOK, SIGNAL_SIZE) < 0)
+        {
+            fprintf(stderr, ERR_KEY_ACK);
+            return -1;
+        }
+        conn_set_state(conn, CONN_SETUP_START, KEY_EXCHANGE_TIMEOUT_MS);
+        return 1;
+    }
 
-    // Hlavny cyklus prenosu dat
-    while (!transfer_complete)
+    case CONN_SETUP_START:
     {
-        uint32_t chunk_size;
-        if (receive_chunk_size_reliable(client_socket, &chunk_size) < 0)
+        uint32_t setup_status;
+        if ((r = recv_buffer_chunk_size(rb, &setup_status, 0)) == 0)
         {
-            fprintf(stderr, ERR_CHUNK_SIZE);
-            transfer_complete = -1;
-            break;
+            return 0;
+        }
+        if (r < 0 || setup_status != SESSION_SETUP_START)
+        {
+            fprintf(stderr, ERR_SESSION_SETUP);
+            return -1;
         }
+        printf(LOG_SESSION_START);
 
-        // Spracovanie markera rotacie kluca
-        if (chunk_size == KEY_ROTATION_MARKER)
+        // Docasny par klucov zo zasoby (forward secrecy)
+        uint8_t ephemeral_public[KEY_SIZE];
+        take_ephemeral_keypair(ephemeral_public, conn->ephemeral_secret);
+        if (conn_send(conn, ephemeral_public, KEY_SIZE) < 0)
         {
-            printf(MSG_KEY_ROTATION, (unsigned long long)block_count);
+            fprintf(stderr, ERR_KEY_EXCHANGE);
+            return -1;
+        }
+        conn_set_state(conn, CONN_PEER_PUBLIC, KEY_EXCHANGE_TIMEOUT_MS);
+        return 1;
+    }
 
-            if (send_chunk_size_reliable(client_socket, KEY_ROTATION_ACK) < 0)
-            {
-                fprintf(stderr, ERR_KEY_ROTATION_ACK);
-                transfer_complete = -1;
-                break;
-            }
+    case CONN_PEER_PUBLIC:
+        if (!recv_buffer_read(rb, conn->peer_public, KEY_SIZE))
+        {
+            return 0;
+        }
+        // Spolocny kluc sa vypocita na konci kola slucky spolu s ostatnymi spojeniami
+        conn_set_state(conn, CONN_SHARED_SECRET, KEY_EXCHANGE_TIMEOUT_MS);
+        return 0;
 
-            // Prijatie nonce pre rotaciu kluca
-            uint8_t rotation_nonce[NONCE_SIZE];
-            if (recv_all(client_socket, rotation_nonce, NONCE_SIZE) != NONCE_SIZE)
-            {
-                fprintf(stderr, ERR_SESSION_NONCE);
-                transfer_complete = -1;
-                break;
-            }
+    case CONN_SHARED_SECRET:
+        return 0;
 
-            // Validacia rotacie kluca
-            uint32_t signal;
-            if (receive_chunk_size_reliable(client_socket, &signal) < 0 ||
-                signal != KEY_ROTATION_VALIDATE)
-            {
-                fprintf(stderr, ERR_KEY_VALIDATE_SIGNAL);
-                transfer_complete = -1;
-                break;
-            }
+    case CONN_SESSION_NONCE:
+        if ((p = recv_buffer_take(rb, NONCE_SIZE)) == NULL)
+        {
+            return 0;
+        }
+        setup_session(conn->session_key, conn->key, conn->shared_secret, p);
+        secure_wipe(conn->ephemeral_secret, KEY_SIZE);
+        secure_wipe(conn->shared_secret, KEY_SIZE);
+        conn_set_state(conn, CONN_SESSION_VERIFY, KEY_EXCHANGE_TIMEOUT_MS);
+        return 1;
 
-            memcpy(previous_key, session_key, KEY_SIZE);
-            rotate_key(session_key, previous_key, rotation_nonce);
+    case CONN_SESSION_VERIFY:
+    {
+        uint8_t session_verify[32];
+        if ((p = recv_buffer_take(rb, sizeof(session_verify))) == NULL)
+        {
+            return 0;
+        }
+        if (!verify_session_verification(p, conn->session_key))
+        {
+            fprintf(stderr, ERR_SESSION_VERIF_MISMATCH);
+            return -1;
+        }
+        generate_session_verification(session_verify, conn->session_key);
+        if (conn_send(conn, session_verify, sizeof(session_verify)) < 0)
+        {
+            fprintf(stderr, ERR_KEY_SESSION_VERIF);
+            return -1;
+        }
+        if (conn_send_u32(conn, SESSION_SETUP_DONE) < 0)
+        {
+            fprintf(stderr, ERR_SESSION_CONFIRM);
+            return -1;
+        }
+        printf(LOG_SESSION_COMPLETE);
+        conn_set_state(conn, CONN_FILE_NAME, WAIT_FILE_NAME);
+        return 1;
+    }
 
-            // Vypis novy relacny kluc
-            printf("New session key: ");
-            for (int i = 0; i < KEY_SIZE; i++)
-            {
-                printf("%02x", session_key[i]);
-            }
-            printf("\n");
-            
-            // Kontrola validacie kluca
-            uint8_t client_validation[VALIDATION_SIZE];
-            uint8_t our_validation[VALIDATION_SIZE];
+    case CONN_FILE_NAME:
+        if ((r = recv_buffer_file_name(rb, conn->file_name, sizeof(conn->file_name))) == 0)
+        {
+            return 0;
+        }
+        if (r < 0)
+        {
+            fprintf(stderr, ERR_FILENAME_RECEIVE, "name too long");
+            return -1;
+        }
+        conn_set_state(conn, CONN_TRANSFER_MODE, SOCKET_TIMEOUT_MS);
+        return 1;
 
-            if (recv_all(client_socket, client_validation, VALIDATION_SIZE) != VALIDATION_SIZE)
-            {
-                fprintf(stderr, ERR_KEY_VALIDATE_RECEIVE);
-                transfer_complete = -1;
-                break;
-            }
+    case CONN_TRANSFER_MODE:
+    {
+        uint32_t transfer_mode;
+        uint8_t stream_nonce[NONCE_SIZE];
+        if ((r = recv_buffer_transfer_mode(rb, &transfer_mode, &conn->chunk_size, stream_nonce)) == 0)
+        {
+            return 0;
+        }
+        if (r < 0 || conn_send_u32(conn, transfer_mode) < 0 || conn_send_u32(conn, conn->chunk_size) < 0)
+        {
+            fprintf(stderr, ERR_TRANSFER_MODE);
+            return -1;
+        }
+        if (conn_start_transfer(conn, transfer_mode, stream_nonce) < 0)
+        {
+            return -1;
+        }
+        conn_set_state(conn, CONN_FRAME_SIZE, SOCKET_TIMEOUT_MS);
+        return 1;
+    }
 
-            generate_key_validation(our_validation, session_key);
-            if (memcmp(client_validation, our_validation, VALIDATION_SIZE) != 0)
-            {
-                fprintf(stderr, ERR_KEY_VALIDATE_MISMATCH);
-                transfer_complete = -1;
-                break;
-            }
+    case CONN_FRAME_SIZE:
+    {
+        // Plne okno sa odovzda do pipeline skor, ako sa prijme dalsi blok
+        uint32_t chunk_size;
+        if (conn->window.count == conn->window_chunks && (r = conn_flush_window(conn)) <= 0)
+        {
+            return r;
+        }
+        if ((r = recv_buffer_chunk_size(rb, &chunk_size, conn->chunk_size)) == 0)
+        {
+            return 0;
+        }
+        if (r < 0 || (chunk_size >= CONTROL_MESSAGE_MIN && chunk_size != KEY_ROTATION_MARKER))
+        {
+            fprintf(stderr, ERR_CHUNK_SIZE);
+            return -1;
+        }
 
-            secure_wipe(previous_key, KEY_SIZE);
+        // Datovy blok sa len prijme do okna, do pipeline ide az cele okno naraz
+        conn->frame_size = chunk_size;
+        conn->state = (chunk_size != KEY_ROTATION_MARKER && chunk_size != 0) ? CONN_FRAME_DATA : CONN_FRAME_CONTROL;
+        return 1;
+    }
 
-            if (send_chunk_size_reliable(client_socket, KEY_ROTATION_READY) < 0)
+    case CONN_FRAME_CONTROL:
+    {
+        // Riadiaca sprava: najprv sa odovzdaju prijate bloky (este so starym klucom)
+        if ((r = conn_flush_window(conn)) <= 0)
+        {
+            return r;
+        }
+        if (conn->frame_size == KEY_ROTATION_MARKER)
+        {
+            printf(MSG_KEY_ROTATION, (unsigned long long)conn->block_count);
+            if (conn_send_u32(conn, KEY_ROTATION_ACK) < 0)
             {
-                fprintf(stderr, ERR_KEY_ROTATION_READY);
-                transfer_complete = -1;
-                break;
+                fprintf(stderr, ERR_KEY_ROTATION_ACK);
+                return -1;
             }
-
-            wait();
-            continue;
+            conn->state = CONN_ROTATION;
+            return 1;
         }
 
         // Spracovanie markera konca suboru (EOF)
-        if (chunk_size == 0)
+        printf(LOG_TRANSFER_COMPLETE);
+        conn->state = CONN_DIGEST;
+        return 1;
+    }
+
+    case CONN_FRAME_DATA:
+    {
+        chunk_window *window = &conn->window;
+        size_t slot = window->count;
+        if ((r = recv_buffer_encrypted_chunk(rb, conn->stream ? NULL : window->nonces[slot],
+                                             window->tags[slot], &window->data[slot], conn->frame_size)) == 0)
         {
-            printf("\n");
-            printf(LOG_TRANSFER_COMPLETE);
-            if (send_transfer_ack(client_socket) == 0)
+            return 0;
+        }
+        if (r < 0 && rb->start > 0)
+        {
+            // Ramec sa zmesti az po posunuti buffera: drzane bloky sa odovzdaju hned
+            // a pri io_uring sa caka na dokoncenie prebiehajuceho prijatia (conn_release)
+            if ((r = conn_flush_window(conn)) <= 0)
             {
-                transfer_complete = 1;
+                return r;
             }
-            break;
+            if (conn->recv_pending)
+            {
+                return 0;
+            }
+            conn_release(conn);
+            return 1;
         }
-
-        // Spracovanie bloku dat a aktualizacia postupu
-        if (receive_encrypted_chunk(client_socket, nonce, tag, ciphertext, chunk_size) < 0 ||
-            crypto_aead_unlock(plaintext, tag, session_key, nonce, NULL, 0, ciphertext, chunk_size) != 0 ||
-            fwrite(plaintext, 1, chunk_size, file) != chunk_size)
+        if (r < 0)
         {
             fprintf(stderr, ERR_CHUNK_PROCESS);
-            break;
+            return -1;
+        }
+        window->sizes[slot] = conn->frame_size;
+        window->count++;
+        conn->state = CONN_FRAME_SIZE;
+        return 1;
+    }
+
+    case CONN_ROTATION:
+    {
+        // Klient posle nonce, signal VALIDATE a kontrolny kod noveho kluca naraz
+        uint8_t rotation_nonce[NONCE_SIZE];
+        uint8_t client_validation[VALIDATION_SIZE];
+        uint8_t our_validation[VALIDATION_SIZE];
+        uint8_t previous_key[KEY_SIZE];
+        uint32_t signal;
+        if (rb->end - rb->start < NONCE_SIZE + sizeof(uint32_t) + VALIDATION_SIZE)
+        {
+            return 0;
         }
+        recv_buffer_read(rb, rotation_nonce, NONCE_SIZE);
+        if (recv_buffer_chunk_size(rb, &signal, 0) < 0 || signal != KEY_ROTATION_VALIDATE)
+        {
+            fprintf(stderr, ERR_KEY_VALIDATE_SIGNAL);
+            return -1;
+        }
+        recv_buffer_read(rb, client_validation, VALIDATION_SIZE);
 
-        total_bytes += chunk_size;
-        block_count++;
+        memcpy(previous_key, conn->session_key, KEY_SIZE);
+        rotate_key(conn->session_key, previous_key, rotation_nonce);
+        secure_wipe(previous_key, KEY_SIZE);
 
-        // Aktualizacia postupu
-        if (total_bytes - last_progress_update >= PROGRESS_UPDATE_INTERVAL)
+        // Prudovy kontext pokracuje s novym klucom a rotacnym nonce
+        if (conn->stream != NULL)
         {
-            printf(LOG_PROGRESS_FORMAT, "Received", (float)total_bytes / PROGRESS_UPDATE_INTERVAL);
-            fflush(stdout);
-            last_progress_update = total_bytes;
+            crypto_aead_init_x(conn->stream, conn->session_key, rotation_nonce);
         }
-    }
 
-    // Finalna sprava o stave prenosu
-    if (transfer_complete == 1)
-    {
-        printf(LOG_SUCCESS_FORMAT, "received", (float)total_bytes / PROGRESS_UPDATE_INTERVAL);
-    }
-    else
-    {
-        fprintf(stderr, ERR_TRANSFER_INTERRUPTED);
+        generate_key_validation(our_validation, conn->session_key);
+        if (memcmp(client_validation, our_validation, VALIDATION_SIZE) != 0)
+        {
+            fprintf(stderr, ERR_KEY_VALIDATE_MISMATCH);
+            return -1;
+        }
+        if (conn_send_u32(conn, KEY_ROTATION_READY) < 0)
+        {
+            fprintf(stderr, ERR_KEY_ROTATION_READY);
+            return -1;
+        }
+        conn->state = CONN_FRAME_SIZE;
+        return 1;
     }
 
-    // Ukoncenie a cistenie
-    // - Zatvorenie vystupneho suboru
-    // - Uvolnenie sietovych prostriedkov
-    // - Navrat s kodom podla uspesnosti prenosu
-    if (file != NULL)
+    case CONN_DIGEST:
     {
-        fclose(file);
-    }
-    cleanup_sockets(client_socket, server_fd);
-    cleanup_network();
-
-    // Bezpecne vymazanie citlivych dat
-    secure_wipe(key, KEY_SIZE);
-    secure_wipe(session_key, KEY_SIZE);
-    secure_wipe(buffer, TRANSFER_BUFFER_SIZE);
-    secure_wipe(plaintext, TRANSFER_BUFFER_SIZE);
-    secure_wipe(tag, TAG_SIZE);
-
-    return (transfer_complete == 1) ? 0 : -1;
+        // Overenie kontrolneho suctu celeho suboru pred potvrdenim prenosu
+        // Klient posiela svoj sucet zasifrovany hned za EOF markerom
+        // Sucet sa overi az ked su vsetky okna desifrovane a zapisane
+        uint8_t nonce[NONCE_SIZE];
+        uint8_t tag[TAG_SIZE];
+        uint8_t *digest_frame;
+        if (!conn_drained(conn))
+        {
+            conn_wait_pipeline(conn);
+            return 0;
+        }
+        if ((r = recv_buffer_encrypted_chunk(rb, conn->stream ? NULL : nonce, tag,
+                                             &digest_frame, FILE_DIGEST_SIZE)) == 0)
+        {
+            return 0;
+        }
+        if (__atomic_load_n(&conn->failed, __ATOMIC_ACQUIRE))
+        {
+            fprintf(stderr, ERR_CHUNK_PROCESS);
+            return -1;
+        }
+        if (conn->written_bytes != conn->total_bytes)
+        {
+            fprintf(stderr, ERR_FILE_WRITE);
+            return -1;
+        }
+
+        uint8_t file_digest[FILE_DIGEST_SIZE];
+        uint8_t client_digest[FILE_DIGEST_SIZE];
+        file_digest_final(&conn->digest, file_digest);
+        print_hex(LOG_FILE_DIGEST, file_digest, FILE_DIGEST_SIZE);
+
+        int digest_ok = r > 0;
+        if (digest_ok && conn->stream != NULL)
+        {
+            digest_ok = crypto_aead_read(conn->stream, client_digest, tag, NULL, 0, digest_frame, FILE_DIGEST_SIZE) == 0;
+        }
+        else if (digest_ok)
+        {
+            digest_ok = crypto_aead_unlock(client_digest, tag, conn->session_key, nonce, NULL, 0, digest_frame, FILE_DIGEST_SIZE) == 0;
+        }
+
+        int result = -1;
+        if (!digest_ok)
+        {
+            fprintf(stderr, ERR_FILE_DIGEST_RECEIVE);
+        }
+        else if (crypto_verify64(file_digest, client_digest) != 0)
+        {
+            fprintf(stderr, ERR_FILE_DIGEST_MISMATCH);
+        }
+        else
+        {
+            printf(MSG_ACK_SENDING, 1, 1);
+            if (conn_send(conn, MAGIC_TACK, ACK_SIZE) == 0)
+            {
+                conn->complete = 1;
+                printf(LOG_SUCCESS_FORMAT, "received", (float)conn->total_bytes / PROGRESS_UPDATE_INTERVAL);
+                conn_set_state(conn, CONN_CLOSING, SOCKET_TIMEOUT_MS);
+                result = 1;
+            }
+        }
+        secure_wipe(file_digest, FILE_DIGEST_SIZE);
+        secure_wipe(client_digest, FILE_DIGEST_SIZE);
+        return result;
+    }
+
+    case CONN_CLOSING:
+        return 0;
+    }
+    return -1;
+}
+
+// Spracuje vsetky kompletne spravy v bufferi, pri chybe spojenie zatvori
+// Vracia -1 ak bolo spojenie zatvorene
+static int conn_process(connection *conn)
+{
+    int r;
+    while ((r = conn_step(conn)) > 0)
+    {
+    }
+    if (r < 0 || (conn->state == CONN_CLOSING && conn->out_len == 0))
+    {
+        conn_close(conn);
+        return -1;
+    }
+    return 0;
+}
+
+// Dokoncene asynchronne prijatie spojenia (io_uring)
+static void conn_complete(connection *conn, int result)
+{
+    conn->recv_pending = 0;
+
+    // Zatvorene spojenie sa uvolni po poslednej operacii
+    if (conn->closed)
+    {
+        conn_try_free(conn);
+        return;
+    }
+    if (result <= 0)
+    {
+        conn_close(conn); // Koniec spojenia alebo chyba prijatia
+        return;
+    }
+    conn->rb.end += (size_t)result;
+    conn->deadline = platform_monotonic_ms() + (uint64_t)conn->timeout_ms;
+
+    if (conn_process(conn) < 0)
+    {
+        return;
+    }
+    if (conn_arm_recv(conn) < 0)
+    {
+        conn_close(conn);
+    }
+}
+
+// Dokoncene asynchronne odoslanie odpovedi (io_uring)
+static void conn_sent(connection *conn, int result)
+{
+    conn->send_pending = 0;
+    if (conn->closed)
+    {
+        conn_try_free(conn);
+        return;
+    }
+    if (result <= 0)
+    {
+        conn_close(conn);
+        return;
+    }
+    memmove(conn->out, conn->out + result, conn->out_len - (size_t)result);
+    conn->out_len -= (size_t)result;
+
+    // Po poslednej odpovedi (potvrdenie prenosu) sa spojenie zatvori
+    if (conn_flush(conn) < 0 || (conn->state == CONN_CLOSING && conn->out_len == 0))
+    {
+        conn_close(conn);
+    }
+}
+
+// Udalost na sockete klienta
+static void conn_handle_event(connection *conn, int events, int result)
+{
+    if (events & EVENT_RECV_DONE)
+    {
+        conn_complete(conn, result);
+        return;
+    }
+    if (events & EVENT_SEND_DONE)
+    {
+        conn_sent(conn, result);
+        return;
+    }
+    if ((events & EVENT_WRITE) && conn_flush(conn) < 0)
+    {
+        conn_close(conn);
+        return;
+    }
+    // Pri io_uring chybu socketu ohlasi prebiehajuce prijatie
+    if ((events & (EVENT_READ | EVENT_ERROR)) && !event_loop_async(conn->worker->loop))
+    {
+        // Pred citanim sa uvolni miesto po spracovanych spravach
+        conn_release(conn);
+        int closed = recv_buffer_fill(&conn->rb) < 0;
+        conn->deadline = platform_monotonic_ms() + (uint64_t)conn->timeout_ms;
+
+        // Aj po ukonceni spojenia sa spracuju uz prijate spravy
+        if (conn_process(conn) < 0)
+        {
+            return;
+        }
+        if (closed)
+        {
+            conn_close(conn);
+            return;
+        }
+    }
+    if (conn->state == CONN_CLOSING && conn->out_len == 0)
+    {
+        conn_close(conn);
+    }
+}
+
+// Vlakno odvodenia: vypocita hlavny kluc spojenia a odovzda ho jeho slucke
+// Slucku prebudi, aby spojenie pokracovalo bez cakania na dalsie data
+static void *key_derivation_run(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&key_derivation.lock);
+    for (;;)
+    {
+        connection *conn = key_derivation.head;
+        if (conn == NULL)
+        {
+            if (key_derivation.stop)
+            {
+                break;
+            }
+            pthread_cond_wait(&key_derivation.cond, &key_derivation.lock);
+            continue;
+        }
+        key_derivation.head = conn->next;
+        if (key_derivation.head == NULL)
+        {
+            key_derivation.tail = NULL;
+        }
+        pthread_mutex_unlock(&key_derivation.lock);
+
+        // Spojenie zatvorene pocas cakania vo fronte (napr. casovy limit) kluc nepotrebuje
+        // derive_key_server heslo po pouziti vymaze, preto dostane kopiu
+        conn->kdf_result = -1;
+        if (!__atomic_load_n(&conn->closed, __ATOMIC_ACQUIRE))
+        {
+            char password[PASSWORD_BUFFER_SIZE];
+            uint8_t salt[SALT_SIZE];
+            memcpy(password, server_password, sizeof(password));
+            conn->kdf_result = derive_key_server(password, conn->salt, conn->key, salt);
+            secure_wipe(password, sizeof(password));
+        }
+
+        server_worker *worker = conn->worker;
+        pthread_mutex_lock(&worker->derived_lock);
+        conn->next = worker->derived;
+        worker->derived = conn;
+        pthread_mutex_unlock(&worker->derived_lock);
+        event_loop_wake(worker->loop);
+
+        pthread_mutex_lock(&key_derivation.lock);
+    }
+    pthread_mutex_unlock(&key_derivation.lock);
+    return NULL;
+}
+
+static int key_derivation_start(void)
+{
+    for (; key_derivation.started < KEY_DERIVATION_WORKERS; key_derivation.started++)
+    {
+        if (pthread_create(&key_derivation.threads[key_derivation.started], NULL, key_derivation_run, NULL) != 0)
+        {
+            fprintf(stderr, ERR_KEY_DERIVATION_THREAD);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Zastavenie vlakien odvodenia, spojenia vo fronte su uz zatvorene a preskocia sa
+static void key_derivation_stop(void)
+{
+    pthread_mutex_lock(&key_derivation.lock);
+    key_derivation.stop = 1;
+    pthread_cond_broadcast(&key_derivation.cond);
+    pthread_mutex_unlock(&key_derivation.lock);
+    for (int i = 0; i < key_derivation.started; i++)
+    {
+        pthread_join(key_derivation.threads[i], NULL);
+    }
+}
+
+// Spojenia, ktorym vlakno odvodenia dokoncilo hlavny kluc
+// Kontrolny kod kluca mohol prist este pocas odvodenia, spracuje sa hned
+static void complete_key_derivations(server_worker *worker)
+{
+    pthread_mutex_lock(&worker->derived_lock);
+    connection *conn = worker->derived;
+    worker->derived = NULL;
+    pthread_mutex_unlock(&worker->derived_lock);
+
+    while (conn != NULL)
+    {
+        connection *next = conn->next;
+        conn->kdf_pending = 0;
+        if (conn->closed)
+        {
+            conn_try_free(conn);
+        }
+        else if (conn->kdf_result != 0)
+        {
+            fprintf(stderr, ERR_KEY_DERIVATION);
+            conn_close(conn);
+        }
+        else
+        {
+            conn_set_state(conn, CONN_KEY_VALIDATION, SOCKET_TIMEOUT_MS);
+            if (conn_process(conn) == 0 && conn_arm_recv(conn) < 0)
+            {
+                conn_close(conn);
+            }
+        }
+        conn = next;
+    }
+}
+
+// Davkovy vypocet X25519 pre vsetky spojenia, ktore v tomto kole prijali verejny kluc
+// Po 4 sa pocitaju naraz v SIMD linkach (compute_shared_secrets)
+static void complete_key_exchanges(server_worker *worker)
+{
+    connection *pending[MAX_CLIENT_CONNECTIONS];
+    size_t count = 0;
+
+    for (int i = 0; i < worker->connection_count; i++)
+    {
+        connection *conn = worker->connections[i];
+        if (conn->state == CONN_SHARED_SECRET)
+        {
+            pending[count] = conn;
+            memcpy(worker->exchange_secrets[count], conn->ephemeral_secret, KEY_SIZE);
+            memcpy(worker->exchange_publics[count], conn->peer_public, KEY_SIZE);
+            count++;
+        }
+    }
+    if (count == 0)
+    {
+        return;
+    }
+
+    compute_shared_secrets(&worker->exchange_shared[0][0], &worker->exchange_secrets[0][0],
+                           &worker->exchange_publics[0][0], count);
+    for (size_t i = 0; i < count; i++)
+    {
+        memcpy(pending[i]->shared_secret, worker->exchange_shared[i], KEY_SIZE);
+        conn_set_state(pending[i], CONN_SESSION_NONCE, KEY_EXCHANGE_TIMEOUT_MS);
+    }
+    secure_wipe(worker->exchange_secrets, count * KEY_SIZE);
+    secure_wipe(worker->exchange_shared, count * KEY_SIZE);
+
+    // Nonce relacie mohol prist spolu s verejnym klucom
+    // (pri io_uring zostava prijatie nastavene, buffer sa medzitym neposuva)
+    for (size_t i = 0; i < count; i++)
+    {
+        conn_process(pending[i]);
+    }
+}
+
+// Zapisovac vratil okna: spojenia cakajuce na pipeline pokracuju
+// Od konca pola, zatvorene spojenie sa nahradi poslednym (uz spracovanym)
+static void resume_connections(server_worker *worker)
+{
+    for (int i = worker->connection_count - 1; i >= 0 && worker->pipeline_waiting > 0; i--)
+    {
+        connection *conn = worker->connections[i];
+        if (!conn->pipeline_wait)
+        {
+            continue;
+        }
+        conn->pipeline_wait = 0;
+        worker->pipeline_waiting--;
+        conn->deadline = platform_monotonic_ms() + (uint64_t)conn->timeout_ms;
+        if (conn_process(conn) < 0)
+        {
+            continue;
+        }
+        conn_watch(conn);
+        if (conn_arm_recv(conn) < 0)
+        {
+            conn_close(conn);
+        }
+    }
+}
+
+// Uvolnenie zatvorenych spojeni, ktorych okna uz zapisovac spracoval
+static void free_drained(server_worker *worker)
+{
+    connection **link = &worker->draining;
+    while (*link != NULL)
+    {
+        connection *conn = *link;
+        if (conn_drained(conn))
+        {
+            *link = conn->next;
+            conn_free(conn);
+        }
+        else
+        {
+            link = &conn->next;
+        }
+    }
+}
+
+// Zatvorenie spojeni, ktore prekrocili casovy limit
+static void expire_connections(server_worker *worker)
+{
+    uint64_t now = platform_monotonic_ms();
+    for (int i = worker->connection_count - 1; i >= 0; i--)
+    {
+        // Spojenie cakajuce na zapisovac nevyprsi, pomaly disk nie je chyba klienta
+        if (now > worker->connections[i]->deadline && !worker->connections[i]->pipeline_wait)
+        {
+            fprintf(stderr, ERR_CONNECTION_TIMEOUT);
+            conn_close(worker->connections[i]);
+        }
+    }
+}
+
+// Prijatie vsetkych cakajucich spojeni
+// Bez SO_REUSEPORT zdielaju vlakna jeden socket, accept potom moze vratit
+// EWOULDBLOCK, ak spojenie prevzalo ine vlakno
+static void accept_connections(server_worker *worker)
+{
+    struct sockaddr_in client_addr;
+    int client_socket;
+    while ((client_socket = accept_client_connection(worker->listen_fd, &client_addr)) >= 0)
+    {
+        conn_open(worker, client_socket);
+    }
+}
+
+// Slucka udalosti jedneho vlakna servera
+// Handshake aj prenos kazdeho klienta je stavovy automat nad neblokujucim socketom
+static void *worker_run(void *arg)
+{
+    server_worker *worker = arg;
+    platform_pin_thread(worker->id);
+
+    net_event events[EVENT_BATCH_SIZE];
+    for (;;)
+    {
+        int count = event_loop_wait(worker->loop, events, EVENT_BATCH_SIZE, EVENT_LOOP_TICK_MS);
+        if (count < 0)
+        {
+            fprintf(stderr, ERR_EVENT_LOOP);
+            break;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            if (events[i].ptr == NULL)
+            {
+                accept_connections(worker);
+            }
+            else
+            {
+                conn_handle_event(events[i].ptr, events[i].events, events[i].result);
+            }
+        }
+        complete_key_derivations(worker);
+        complete_key_exchanges(worker);
+        resume_connections(worker);
+        free_drained(worker);
+        expire_connections(worker);
+    }
+
+    // Zapisovac este dokonci okna zatvorenych spojeni, az potom sa uvolnia
+    while (worker->connection_count > 0)
+    {
+        conn_close(worker->connections[0]);
+    }
+    while (worker->draining != NULL)
+    {
+        event_loop_wait(worker->loop, events, EVENT_BATCH_SIZE, EVENT_LOOP_TICK_MS);
+        free_drained(worker);
+    }
+    return NULL;
+}
+
+// Vlakno desifrovania: berie okna zo svojich front vo vsetkych sluckach udalosti
+// Overi a desifruje okno na mieste a preda ho zapisovacovi slucky, ktora ho poslala
+static void *decrypt_run(void *arg)
+{
+    decrypt_worker *self = arg;
+    unsigned attempt = 0;
+    int next = 0;
+
+    for (;;)
+    {
+        unsigned epoch = pipeline_epoch(&self->signal);
+        recv_item *item = NULL;
+        for (int n = 0; n < decrypt_pool.loop_count && item == NULL; n++)
+        {
+            item = spsc_queue_pop(&decrypt_pool.loops[next]->decrypt_work[self->index]);
+            next = (next + 1) % decrypt_pool.loop_count;
+        }
+        if (item == NULL)
+        {
+            if (pipeline_stopped(&decrypt_pool.stop))
+            {
+                break;
+            }
+            pipeline_idle(&self->signal, epoch, &attempt);
+            continue;
+        }
+        attempt = 0;
+
+        item->failed = chunk_window_unlock(&item->window, item->key,
+                                           item->stream_mode ? &item->stream : NULL) != 0;
+
+        server_worker *owner = item->conn->worker;
+        spsc_queue_push(&owner->decrypt_done[self->index], item);
+        pipeline_notify(&owner->writer->signal);
+    }
+    return NULL;
+}
+
+// Zapis desifrovaneho okna do suboru spojenia a jeho vratenie slucke
+// Zapisovac jediny meni subor, kontrolny sucet a pocet zapisanych bajtov spojenia, kym su jeho okna v pipeline
+static void writer_write(server_worker *worker, recv_item *item)
+{
+    // Po chybe sa dalsie okna spojenia uz nezapisuju, slucka spojenie zatvori
+    connection *conn = item->conn;
+    if (item->failed)
+    {
+        __atomic_store_n(&conn->failed, 1, __ATOMIC_RELEASE);
+    }
+    chunk_window *window = &item->window;
+    for (size_t i = 0; i < window->count && !__atomic_load_n(&conn->failed, __ATOMIC_ACQUIRE); i++)
+    {
+        if (fwrite(window->data[i], 1, window->sizes[i], conn->file) != window->sizes[i])
+        {
+            __atomic_store_n(&conn->failed, 1, __ATOMIC_RELEASE);
+            break;
+        }
+        file_digest_update(&conn->digest, window->data[i], window->sizes[i]);
+        conn->written_bytes += window->sizes[i];
+    }
+
+    // Okno sa vrati slucke, fronta ma miesto pre vsetky okna
+    // Slucka sa prebudi, aby pokracovali spojenia cakajuce na volne okno alebo na zapis
+    __atomic_store_n(&conn->windows_written, conn->windows_written + 1, __ATOMIC_RELEASE);
+    spsc_queue_push(&worker->free_items, item);
+    event_loop_wake(worker->loop);
+}
+
+// Zapisovac: zapisuje okna svojich sluciek do suborov v poradi, v akom ich slucka poslala
+// Okno n slucky caka vo fronte vlakna desifrovania n % pocet, slucky sa striedaju,
+// takze pomaly disk jedneho spojenia nezdrzi okna, ktore su uz desifrovane v inej slucke
+static void *writer_run(void *arg)
+{
+    file_writer *self = arg;
+    unsigned attempt = 0;
+
+    for (;;)
+    {
+        unsigned epoch = pipeline_epoch(&self->signal);
+        int progress = 0;
+        for (int n = self->index; n < decrypt_pool.loop_count; n += writer_pool.count)
+        {
+            server_worker *worker = decrypt_pool.loops[n];
+            recv_item *item;
+            while ((item = spsc_queue_pop(&worker->decrypt_done[worker->written % decrypt_pool.count])) != NULL)
+            {
+                worker->written++;
+                writer_write(worker, item);
+                progress = 1;
+            }
+        }
+        if (progress)
+        {
+            attempt = 0;
+            continue;
+        }
+        if (pipeline_stopped(&decrypt_pool.stop))
+        {
+            break;
+        }
+        pipeline_idle(&self->signal, epoch, &attempt);
+    }
+    return NULL;
+}
+
+// Fronty a okna pipeline prijmu jednej slucky udalosti
+// Pamat okien sa alokuje az pri prvom prenose (conn_flush_window)
+static int worker_pipeline_init(server_worker *worker)
+{
+    worker->item_count = decrypt_pool.count * PIPELINE_WINDOWS_PER_WORKER + 2;
+    if (worker->item_count > PIPELINE_MAX_LOOP_WINDOWS)
+    {
+        worker->item_count = PIPELINE_MAX_LOOP_WINDOWS;
+    }
+    worker->items = calloc(worker->item_count, sizeof(recv_item));
+    if (worker->items == NULL)
+    {
+        fprintf(stderr, ERR_PIPELINE_MEMORY);
+        return -1;
+    }
+    if (spsc_queue_init(&worker->free_items, worker->item_count) < 0)
+    {
+        return -1;
+    }
+    for (int i = 0; i < decrypt_pool.count; i++)
+    {
+        if (spsc_queue_init(&worker->decrypt_work[i], worker->item_count) < 0 ||
+            spsc_queue_init(&worker->decrypt_done[i], worker->item_count) < 0)
+        {
+            return -1;
+        }
+    }
+    for (int i = 0; i < worker->item_count; i++)
+    {
+        spsc_queue_push(&worker->free_items, &worker->items[i]);
+    }
+    return 0;
+}
+
+static void worker_pipeline_free(server_worker *worker)
+{
+    for (int i = 0; i < decrypt_pool.count; i++)
+    {
+        spsc_queue_free(&worker->decrypt_work[i]);
+        spsc_queue_free(&worker->decrypt_done[i]);
+    }
+    spsc_queue_free(&worker->free_items);
+    if (worker->items != NULL)
+    {
+        for (int i = 0; i < worker->item_count; i++)
+        {
+            chunk_window_free(&worker->items[i].window);
+        }
+        secure_wipe(worker->items, worker->item_count * sizeof(recv_item));
+        free(worker->items);
+    }
+}
+
+// Spustenie vlakien desifrovania a zapisovacov pred sluckami udalosti
+static int pipeline_start(server_worker **workers, int worker_count)
+{
+    decrypt_pool.loops = workers;
+    decrypt_pool.loop_count = worker_count;
+    for (int i = 0; i < worker_count; i++)
+    {
+        workers[i]->writer = &writer_pool.writers[i % writer_pool.count];
+    }
+    for (; decrypt_pool.started < decrypt_pool.count; decrypt_pool.started++)
+    {
+        decrypt_worker *decryptor = &decrypt_pool.workers[decrypt_pool.started];
+        if (pthread_create(&decryptor->thread, NULL, decrypt_run, decryptor) != 0)
+        {
+            fprintf(stderr, ERR_PIPELINE_THREAD);
+            return -1;
+        }
+    }
+    for (; writer_pool.started < writer_pool.count; writer_pool.started++)
+    {
+        file_writer *writer = &writer_pool.writers[writer_pool.started];
+        if (pthread_create(&writer->thread, NULL, writer_run, writer) != 0)
+        {
+            fprintf(stderr, ERR_PIPELINE_THREAD);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Zastavenie pipeline po skonceni sluciek udalosti (spojenia su uz zatvorene)
+static void pipeline_shutdown(void)
+{
+    pipeline_stop(&decrypt_pool.stop);
+    for (int i = 0; i < decrypt_pool.count; i++)
+    {
+        pipeline_notify(&decrypt_pool.workers[i].signal);
+    }
+    for (int i = 0; i < writer_pool.count; i++)
+    {
+        pipeline_notify(&writer_pool.writers[i].signal);
+    }
+    for (int i = 0; i < decrypt_pool.started; i++)
+    {
+        pthread_join(decrypt_pool.workers[i].thread, NULL);
+    }
+    for (int i = 0; i < writer_pool.started; i++)
+    {
+        pthread_join(writer_pool.writers[i].thread, NULL);
+    }
+    for (int i = 0; i < decrypt_pool.count; i++)
+    {
+        pipeline_signal_destroy(&decrypt_pool.workers[i].signal);
+    }
+    for (int i = 0; i < writer_pool.count; i++)
+    {
+        pipeline_signal_destroy(&writer_pool.writers[i].signal);
+    }
+}
+
+// Vytvorenie vlakna servera s vlastnym pocuvajucim socketom a sluckou udalosti
+// shared_fd >= 0: platforma nema SO_REUSEPORT, vlakno pouzije spolocny socket
+static server_worker *worker_create(int id, int port, int shared_fd)
+{
+    server_worker *worker = calloc(1, sizeof(server_worker));
+    if (worker == NULL)
+    {
+        return NULL;
+    }
+    worker->id = id;
+    pthread_mutex_init(&worker->derived_lock, NULL);
+    if (worker_pipeline_init(worker) < 0)
+    {
+        worker_pipeline_free(worker);
+        free(worker);
+        return NULL;
+    }
+    worker->listen_fd = shared_fd >= 0 ? shared_fd : setup_server(port, 1);
+    if (worker->listen_fd < 0)
+    {
+        worker_pipeline_free(worker);
+        free(worker);
+        return NULL;
+    }
+    SET_NONBLOCKING(worker->listen_fd);
+
+    worker->loop = event_loop_create();
+    if (worker->loop == NULL || event_loop_add(worker->loop, worker->listen_fd, EVENT_READ, NULL) < 0)
+    {
+        fprintf(stderr, ERR_EVENT_LOOP);
+        if (worker->loop != NULL)
+        {
+            event_loop_destroy(worker->loop);
+        }
+        if (shared_fd < 0)
+        {
+            cleanup_socket(worker->listen_fd);
+        }
+        worker_pipeline_free(worker);
+        free(worker);
+        return NULL;
+    }
+    return worker;
+}
+
+int main()
+{
+    // Inicializacia sietovych prvkov
+    int port;
+    char port_str[6]; // Max 5 cislic + null terminator
+
+    // Server bezi dlho, vypisy sa maju objavit hned aj pri presmerovani do suboru
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    // Inicializacia Winsock pre Windows platformu
+    initialize_network();
+
+    // Ziadanie cisla portu od uzivatela
+    printf(PORT_PROMPT);
+    if (fgets(port_str, sizeof(port_str), stdin) == NULL)
+    {
+        fprintf(stderr, ERR_PORT_READ);
+        cleanup_network();
+        return -1;
+    }
+
+    // Konverzia portu na integer a validacia
+    char *endptr;
+    long port_long = strtol(port_str, &endptr, 10);
+    if (endptr == port_str || *endptr != '\n' || port_long < 1 || port_long > 65535)
+    {
+        fprintf(stderr, ERR_PORT_INVALID);
+        cleanup_network();
+        return -1;
+    }
+    port = (int)port_long;
+
+    // Jadra sa delia medzi slucky udalosti a vlakna desifrovania, aby sa navzajom nepretlacali
+    // Kazda slucka ma vlastny socket na tom istom porte, spojenia medzi sockety
+    // rozdeluje jadro OS (SO_REUSEPORT)
+    int cpu_count = platform_cpu_count();
+    int worker_count = (cpu_count + 1) / 2;
+    if (worker_count > MAX_SERVER_WORKERS)
+    {
+        worker_count = MAX_SERVER_WORKERS;
+    }
+    server_worker *workers[MAX_SERVER_WORKERS] = {NULL};
+    int shared_fd = -1;
+
+    // Zasoba vlakien desifrovania na zvysnych jadrach je spolocna pre vsetky slucky,
+    // zapisovace cakaju hlavne na disk, slucky sa o ne delia
+    decrypt_pool.count = cpu_count - worker_count;
+    if (decrypt_pool.count < 1)
+    {
+        decrypt_pool.count = 1;
+    }
+    if (decrypt_pool.count > PIPELINE_MAX_WORKERS)
+    {
+        decrypt_pool.count = PIPELINE_MAX_WORKERS;
+    }
+    writer_pool.count = worker_count < PIPELINE_MAX_WRITERS ? worker_count : PIPELINE_MAX_WRITERS;
+    for (int i = 0; i < decrypt_pool.count; i++)
+    {
+        decrypt_pool.workers[i].index = i;
+        pipeline_signal_init(&decrypt_pool.workers[i].signal);
+    }
+    for (int i = 0; i < writer_pool.count; i++)
+    {
+        writer_pool.writers[i].index = i;
+        pipeline_signal_init(&writer_pool.writers[i].signal);
+    }
+#ifndef SO_REUSEPORT
+    // Bez SO_REUSEPORT cakaju vsetky vlakna na jednom sockete
+    if ((shared_fd = setup_server(port, 0)) < 0)
+    {
+        fprintf(stderr, ERR_SOCKET_SETUP, strerror(errno));
+        cleanup_network();
+        return -1;
+    }
+#endif
+    for (int i = 0; i < worker_count; i++)
+    {
+        if ((workers[i] = worker_create(i, port, shared_fd)) == NULL)
+        {
+            fprintf(stderr, ERR_SOCKET_SETUP, strerror(errno));
+            cleanup_network();
+            return -1;
+        }
+    }
+
+    // Heslo sa zada raz pri starte, hlavny kluc kazdeho klienta sa z neho odvodi
+    // pomocou Argon2 a soli, ktoru posle klient
+    char *password = platform_getpass(PASSWORD_PROMPT);
+    snprintf(server_password, sizeof(server_password), "%s", password);
+    secure_wipe(password, strlen(password));
+
+    printf(LOG_SERVER_START, port);
+    printf(LOG_CRYPTO_KERNEL, crypto_cpu_kernel());
+    printf(LOG_SERVER_WORKERS, worker_count, shared_fd < 0 ? "SO_REUSEPORT" : "shared socket");
+    printf(LOG_EVENT_BACKEND, event_loop_backend(workers[0]->loop));
+    printf(LOG_PIPELINE, decrypt_pool.count, "decrypt", workers[0]->item_count);
+    printf(LOG_FILE_WRITERS, writer_pool.count);
+
+    // Docasne kluce sa predpocitavaju na pozadi uz pocas cakania na klientov
+    keypair_pool_start();
+
+    // Vlakna pipeline a odvodenia kluca musia bezat skor, ako slucky zacnu odovzdavat okna a soli
+    int started = 0;
+    if (pipeline_start(workers, worker_count) == 0 && key_derivation_start() == 0)
+    {
+        for (int i = 0; i < worker_count; i++)
+        {
+            if (pthread_create(&workers[i]->thread, NULL, worker_run, workers[i]) != 0)
+            {
+                fprintf(stderr, ERR_SERVER_WORKER, i);
+                break;
+            }
+            started++;
+        }
+    }
+
+    // Vlakna bezia, kym ich slucka udalosti nezlyha
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(workers[i]->thread, NULL);
+    }
+    pipeline_shutdown();
+    key_derivation_stop();
+    for (int i = 0; i < worker_count; i++)
+    {
+        complete_key_derivations(workers[i]); // Uvolni zatvorene spojenia vratene vlaknami odvodenia
+        pthread_mutex_destroy(&workers[i]->derived_lock);
+        worker_pipeline_free(workers[i]);
+        event_loop_destroy(workers[i]->loop);
+        if (shared_fd < 0)
+        {
+            cleanup_socket(workers[i]->listen_fd);
+        }
+        free(workers[i]);
+    }
+    if (shared_fd >= 0)
+    {
+        cleanup_socket(shared_fd);
+    }
+
+    cleanup_network();
+    keypair_pool_stop();
+    secure_wipe(server_password, sizeof(server_password));
+    return -1;
 }
@@ -22,9 +22,10 @@
 #include <stdio.h>  // Kniznica pre standardny vstup a vystup (nacitanie zo suborov, vypis na obrazovku)
 #include <stdlib.h> // Kniznica pre vseobecne funkcie (sprava pamate, konverzie, nahodne cisla)
 
-#include "siete.h"     // Pre sietove funkcie
-#include "constants.h" // Add this include for error message constants
-#include "platform.h"  // Pre funkcie specificke pre operacny system
+#include "siete.h"        // Pre sietove funkcie
+#include "constants.h"    // Add this include for error message constants
+#include "platform.h"     // Pre funkcie specificke pre operacny system
+#include "crypto_utils.h" // Pre bezpecne mazanie prijimacieho buffera
 
 // Implementacia funkcii pre spravu socketov
 // Rozdielna implementacia pre Windows a Linux
@@ -82,9 +83,11 @@ void set_timeout_options(int sock)
 
 // Vytvorenie a konfiguracia servera
 // - Vytvori socket
+// - Pri reuse_port zapne SO_REUSEPORT, aby mohlo kazde vlakno servera
+//   pocuvat na tom istom porte s vlastnym socketom (jadro rozdeluje spojenia)
 // - Nastavi adresu a port
 // - Zacne pocuvat na porte
-int setup_server(int port)
+int setup_server(int port, int reuse_port)
 {
     // Server socket, ktory pocuva na urcitej adrese
     int server_fd;
@@ -100,6 +103,18 @@ int setup_server(int port)
         return -1;
     }
 
+#ifdef SO_REUSEPORT
+    int enable = 1;
+    if (reuse_port && setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0)
+    {
+        fprintf(stderr, ERR_REUSEPORT, strerror(errno));
+        cleanup_socket(server_fd);
+        return -1;
+    }
+#else
+    (void)reuse_port; // Bez SO_REUSEPORT zdielaju vlakna jeden socket (pozri server.c)
+#endif
+
     // Nastavenie adresy servera:
     // - sin_family: pouzivame IPv4
     // - sin_addr.s_addr: server bude pocuvat na vsetkych dostupnych adresach
@@ -133,7 +148,11 @@ int accept_client_connection(int server_fd, struct sockaddr_in *client_addr)
 
     if (new_socket < 0)
     {
-        fprintf(stderr, ERR_SOCKET_ACCEPT);
+        // Neblokujuci server: ziadne dalsie cakajuce spojenie nie je chyba
+        if (!SOCKET_WOULD_BLOCK())
+        {
+            fprintf(stderr, ERR_SOCKET_ACCEPT);
+        }
         return -1;
     }
 
@@ -338,7 +357,8 @@ int receive_file_name(int socket, char *file_name, size_t max_len)
     size_t total_received = 0;
     while (total_received < max_len)
     {
-        ssize_t received = recv(socket, file_name + total_received, max_len - total_received, 0);
+        // Po jednom bajte, aby sa neprecitali data nasledujuceho bloku
+        ssize_t received = recv(socket, file_name + total_received, 1, 0);
         if (received <= 0)
         {
             return -1;
@@ -360,7 +380,9 @@ int send_chunk_size_reliable(int socket, uint32_t size)
 }
 
 // Prijme velkost datoveho bloku a prevedie ju do lokalneho poradia bytov
-int receive_chunk_size_reliable(int socket, uint32_t *size)
+// Riadiace spravy (>= CONTROL_MESSAGE_MIN) prejdu vzdy, velkost nad max_size je chyba
+// max_size = 0: ocakava sa len riadiaca sprava (alebo 0 ako EOF)
+int receive_chunk_size_reliable(int socket, uint32_t *size, uint32_t max_size)
 {
     uint32_t net_size;
     if (recv_all(socket, &net_size, sizeof(net_size)) != sizeof(net_size))
@@ -368,6 +390,10 @@ int receive_chunk_size_reliable(int socket, uint32_t *size)
         return -1;
     }
     *size = ntohl(net_size);
+    if (*size > max_size && *size < CONTROL_MESSAGE_MIN)
+    {
+        return -1; // Blok vacsi nez dohodnuta velkost
+    }
     return 0;
 }
 
@@ -393,6 +419,51 @@ ssize_t send_all(int sock, const void *buf, size_t size)
     return size;
 }
 
+// Pomocna funkcia na odoslanie viacerych usekov pamate (gather) jednym volanim
+// - Pri ciastocnom odoslani sa posunie v poli iov a pokracuje
+// - Garantuje odoslanie vsetkych usekov alebo chybu
+int send_all_vec(int sock, net_iovec *iov, int iov_count)
+{
+    while (iov_count > 0)
+    {
+#ifdef _WIN32
+        DWORD sent_bytes = 0;
+        if (WSASend(sock, iov, (DWORD)iov_count, &sent_bytes, 0, NULL, NULL) == SOCKET_ERROR)
+        {
+            return -1; // Chyba
+        }
+        size_t sent = sent_bytes;
+#else
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)iov_count;
+        ssize_t result = sendmsg(sock, &msg, SEND_FLAGS);
+        if (result < 0 && errno == EINTR)
+        {
+            continue; // Prerusenie, skusi znova
+        }
+        if (result <= 0)
+        {
+            return -1; // Chyba
+        }
+        size_t sent = (size_t)result;
+#endif
+        // Preskocenie uplne odoslanych usekov a posun v ciastocne odoslanom
+        while (iov_count > 0 && sent >= NET_IOVEC_LEN(*iov))
+        {
+            sent -= NET_IOVEC_LEN(*iov);
+            iov++;
+            iov_count--;
+        }
+        if (iov_count > 0 && sent > 0)
+        {
+            NET_IOVEC_ADVANCE(*iov, sent);
+        }
+    }
+    return 0;
+}
+
 // Pomocna funkcia na spolahlivy prijem vsetkych dat
 // - Garantuje prijem vsetkych dat alebo chybu
 ssize_t recv_all(int sock, void *buf, size_t size)
@@ -416,29 +487,1007 @@ ssize_t recv_all(int sock, void *buf, size_t size)
 }
 
 // Posle zasifrovany blok dat spolu s noncom a tagom
+// V prudovom rezime je nonce implicitny (NULL) a neposiela sa
+// data su buffer, ktory bol zasifrovany na mieste (ziadna kopia do ineho buffera)
 int send_encrypted_chunk(int socket, const uint8_t *nonce, const uint8_t *tag,
                          const uint8_t *data, size_t data_len)
 {
-    if (send_all(socket, nonce, NONCE_SIZE) != NONCE_SIZE ||
-        send_all(socket, tag, TAG_SIZE) != TAG_SIZE ||
-        send_all(socket, data, data_len) != (ssize_t)data_len)
+    net_iovec iov[3];
+    int iov_count = 0;
+    if (nonce != NULL)
     {
-        return -1;
+        NET_IOVEC_SET(iov[iov_count], nonce, NONCE_SIZE);
+        iov_count++;
+    }
+    NET_IOVEC_SET(iov[iov_count], tag, TAG_SIZE);
+    iov_count++;
+    NET_IOVEC_SET(iov[iov_count], data, data_len);
+    iov_count++;
+    return send_all_vec(socket, iov, iov_count);
+}
+
+// Posle celu postupnost ramcov: velkost bloku, nonce, tag a zasifrovane data
+// - Jedno systemove volanie na SEND_COALESCE_FRAMES ramcov namiesto styroch na ramec
+// - nonces: NONCE_SIZE bajtov na ramec, v prudovom rezime NULL (nonce sa neposiela)
+// - tags: TAG_SIZE bajtov na ramec
+int send_encrypted_frames(int socket, const uint8_t *nonces, const uint8_t *tags,
+                          uint8_t *const *data, const size_t *sizes, size_t count)
+{
+    uint32_t headers[SEND_COALESCE_FRAMES];
+    net_iovec iov[SEND_COALESCE_FRAMES * 4];
+
+    for (size_t first = 0; first < count; first += SEND_COALESCE_FRAMES)
+    {
+        size_t frames = count - first;
+        if (frames > SEND_COALESCE_FRAMES)
+        {
+            frames = SEND_COALESCE_FRAMES;
+        }
+
+        int iov_count = 0;
+        for (size_t i = 0; i < frames; i++)
+        {
+            size_t frame = first + i;
+            headers[i] = htonl((uint32_t)sizes[frame]);
+            NET_IOVEC_SET(iov[iov_count], &headers[i], sizeof(headers[i]));
+            iov_count++;
+            if (nonces != NULL)
+            {
+                NET_IOVEC_SET(iov[iov_count], nonces + frame * NONCE_SIZE, NONCE_SIZE);
+                iov_count++;
+            }
+            NET_IOVEC_SET(iov[iov_count], tags + frame * TAG_SIZE, TAG_SIZE);
+            iov_count++;
+            NET_IOVEC_SET(iov[iov_count], data[frame], sizes[frame]);
+            iov_count++;
+        }
+
+        if (send_all_vec(socket, iov, iov_count) < 0)
+        {
+            return -1;
+        }
     }
     return 0;
 }
 
 // Prijme zasifrovany blok dat spolu s noncom a tagom
+// V prudovom rezime je nonce implicitny (NULL) a neprijima sa
+// data sa potom desifruju na mieste, otvoreny text prepise sifrovany
 int receive_encrypted_chunk(int sockfd, uint8_t *nonce, uint8_t *tag,
-                            uint8_t *ciphertext, uint32_t chunk_size)
+                            uint8_t *data, uint32_t chunk_size)
 {
-    if (recv_all(sockfd, nonce, NONCE_SIZE) != NONCE_SIZE ||
+    if ((nonce != NULL && recv_all(sockfd, nonce, NONCE_SIZE) != NONCE_SIZE) ||
         recv_all(sockfd, tag, TAG_SIZE) != TAG_SIZE ||
-        recv_all(sockfd, ciphertext, chunk_size) != (ssize_t)chunk_size)
+        recv_all(sockfd, data, chunk_size) != (ssize_t)chunk_size)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+// Alokacia prijimacieho buffera pre socket
+// capacity musi pojat vsetky ramce drzane naraz (okno blokov) a jeden usek citania
+int recv_buffer_init(recv_buffer *rb, int socket, size_t capacity)
+{
+    rb->socket = socket;
+    rb->data = malloc(capacity);
+    rb->capacity = capacity;
+    rb->start = 0;
+    rb->end = 0;
+    if (rb->data == NULL)
+    {
+        fprintf(stderr, ERR_RECV_BUFFER_MEMORY);
+        return -1;
+    }
+    return 0;
+}
+
+// Zmena velkosti buffera (napr. po dohode velkosti bloku)
+// Vola sa bez drzanych ramcov, nespracovane bajty sa prenesu, stara pamat sa vymaze
+int recv_buffer_resize(recv_buffer *rb, size_t capacity)
+{
+    recv_buffer_release(rb);
+    if (capacity < rb->end)
+    {
+        return -1;
+    }
+    uint8_t *data = malloc(capacity);
+    if (data == NULL)
+    {
+        fprintf(stderr, ERR_RECV_BUFFER_MEMORY);
+        return -1;
+    }
+    memcpy(data, rb->data, rb->end);
+    secure_wipe(rb->data, rb->capacity);
+    free(rb->data);
+    rb->data = data;
+    rb->capacity = capacity;
+    return 0;
+}
+
+// Bezpecne vymaze buffer (moze obsahovat desifrovane data) a uvolni ho
+void recv_buffer_free(recv_buffer *rb)
+{
+    if (rb->data != NULL)
+    {
+        secure_wipe(rb->data, rb->capacity);
+        free(rb->data);
+        rb->data = NULL;
+    }
+    rb->start = 0;
+    rb->end = 0;
+}
+
+// Uvolni vsetky drzane ramce, nespracovane bajty sa presunu na zaciatok buffera
+// Presuva sa len zvysok posledneho citania, nie cele ramce
+void recv_buffer_release(recv_buffer *rb)
+{
+    if (rb->start > 0)
+    {
+        memmove(rb->data, rb->data + rb->start, rb->end - rb->start);
+        rb->end -= rb->start;
+        rb->start = 0;
+    }
+}
+
+// Precita zo (neblokujuceho) socketu vsetko, co je dostupne a zmesti sa do buffera
+// Kazde recv cita tolko, kolko sa zmesti do buffera (nie len chybajuce bajty)
+// Vracia 0 ak socket nema dalsie data, -1 pri chybe alebo ukonceni spojenia
+// (uz prijate bajty v bufferi ostavaju a daju sa spracovat)
+int recv_buffer_fill(recv_buffer *rb)
+{
+    while (rb->end < rb->capacity)
+    {
+        ssize_t received = recv(rb->socket, (char *)rb->data + rb->end, rb->capacity - rb->end, 0);
+        if (received < 0 && errno == EINTR)
+        {
+            continue; // Prerusenie, skusi znova
+        }
+        if (received < 0 && SOCKET_WOULD_BLOCK())
+        {
+            return 0; // Vsetky dostupne data su precitane
+        }
+        if (received <= 0)
+        {
+            return -1; // Chyba alebo ukoncene spojenie
+        }
+        rb->end += (size_t)received;
+    }
+    return 0;
+}
+
+// Vrati ukazovatel na dalsich size bajtov, ak su uz cele v bufferi (inak NULL, nic sa nespotrebuje)
+uint8_t *recv_buffer_take(recv_buffer *rb, size_t size)
+{
+    if (rb->end - rb->start < size)
+    {
+        return NULL;
+    }
+    uint8_t *p = rb->data + rb->start;
+    rb->start += size;
+    return p;
+}
+
+// Skopiruje dalsich size bajtov z buffera (riadiace spravy, nonce pri rotacii)
+// Vracia 1 ak boli data v bufferi, 0 ak treba pockat na dalsie
+int recv_buffer_read(recv_buffer *rb, void *out, size_t size)
+{
+    uint8_t *p = recv_buffer_take(rb, size);
+    if (p == NULL)
+    {
+        return 0;
+    }
+    memcpy(out, p, size);
+    return 1;
+}
+
+// Prijme velkost datoveho bloku z buffera, pravidla ako receive_chunk_size_reliable
+// Vracia 1 ak je velkost prijata, 0 ak treba pockat, -1 ak je blok vacsi nez max_size
+int recv_buffer_chunk_size(recv_buffer *rb, uint32_t *size, uint32_t max_size)
+{
+    uint32_t net_size;
+    if (!recv_buffer_read(rb, &net_size, sizeof(net_size)))
+    {
+        return 0;
+    }
+    *size = ntohl(net_size);
+    if (*size > max_size && *size < CONTROL_MESSAGE_MIN)
+    {
+        return -1; // Blok vacsi nez dohodnuta velkost
+    }
+    return 1;
+}
+
+// Prijme zasifrovany blok z buffera, len ak je uz cely prijaty
+// Nonce a tag sa skopiruju, *data ukazuje priamo do buffera (desifruje sa tam na mieste)
+// Vracia 1 ak je blok prijaty, 0 ak treba pockat, -1 ak sa do buffera nikdy nezmesti
+int recv_buffer_encrypted_chunk(recv_buffer *rb, uint8_t *nonce, uint8_t *tag,
+                                uint8_t **data, uint32_t data_len)
+{
+    size_t frame_len = (nonce != NULL ? NONCE_SIZE : 0) + TAG_SIZE + (size_t)data_len;
+    if (frame_len > rb->capacity - rb->start)
+    {
+        return -1; // Ramec je vacsi nez volne miesto za drzanymi ramcami
+    }
+    if (rb->end - rb->start < frame_len)
+    {
+        return 0;
+    }
+    if (nonce != NULL)
+    {
+        recv_buffer_read(rb, nonce, NONCE_SIZE);
+    }
+    recv_buffer_read(rb, tag, TAG_SIZE);
+    *data = recv_buffer_take(rb, data_len);
+    return 1;
+}
+
+// Prijme nazov suboru ukonceny nulovym znakom (max_len vratane nuly)
+// Vracia 1 ak je nazov prijaty, 0 ak treba pockat, -1 ak chyba ukoncenie v max_len bajtoch
+int recv_buffer_file_name(recv_buffer *rb, char *file_name, size_t max_len)
+{
+    size_t available = rb->end - rb->start;
+    size_t scan = available < max_len ? available : max_len;
+    const uint8_t *end = memchr(rb->data + rb->start, '\0', scan);
+    if (end == NULL)
+    {
+        return available >= max_len ? -1 : 0;
+    }
+    size_t len = (size_t)(end - (rb->data + rb->start)) + 1;
+    recv_buffer_read(rb, file_name, len);
+    return 1;
+}
+
+// Klient navrhne rezim sifrovania prenosu, velkost bloku a posle nonce pre prudovy rezim
+// Server odpovie rezimom a velkostou bloku, ktore pouzije (moze odmietnut prudovy
+// rezim a zmensit blok), vacsi blok nez navrhnuty klient neprijme
+int propose_transfer_mode(int socket, uint32_t *mode, uint32_t *chunk_size,
+                          const uint8_t *stream_nonce)
+{
+    uint32_t chosen;
+    uint32_t chosen_size;
+    if (send_chunk_size_reliable(socket, *mode) < 0 ||
+        send_chunk_size_reliable(socket, *chunk_size) < 0 ||
+        send_all(socket, stream_nonce, NONCE_SIZE) != NONCE_SIZE ||
+        receive_chunk_size_reliable(socket, &chosen, 0) < 0 ||
+        receive_chunk_size_reliable(socket, &chosen_size, *chunk_size) < 0)
+    {
+        return -1;
+    }
+    if ((chosen != TRANSFER_MODE_NONCE && chosen != TRANSFER_MODE_STREAM) ||
+        chosen_size < TRANSFER_BUFFER_SIZE || chosen_size > *chunk_size)
+    {
+        return -1;
+    }
+    *mode = chosen;
+    *chunk_size = chosen_size;
+    return 0;
+}
+
+// Slucka udalosti
+// Linux: io_uring (ak ho jadro povoli), inak epoll, ukazovatel spojenia je priamo v udalosti jadra
+// Ostatne platformy: pole pre poll (WSAPoll na Windows), najviac EVENT_LOOP_SLOTS socketov
+// Okrem spojeni slucka sleduje pocuvajuci socket a deskriptor prebudenia (event_loop_wake)
+#define EVENT_LOOP_SLOTS (MAX_CLIENT_CONNECTIONS + 2)
+#ifdef USE_IO_URING
+// Typ operacie v dolnych bitoch user_data
+// Spojenia su alokovane cez calloc (zarovnanie na 16 bajtov), dolne 4 bity ukazovatela su volne
+#define RING_OP_IGNORE 0 // Zrusenie alebo odstranenie, vysledok sa zahodi
+#define RING_OP_POLL 1   // Pripravenost socketu, slot a generacia v hornych bitoch
+#define RING_OP_RECV 2   // Prijatie do buffera spojenia
+#define RING_OP_SEND 3   // Odoslanie z buffera spojenia
+#define RING_OP_MASK 15
+
+// Socket sledovany cez IORING_OP_POLL_ADD (jednorazovo, po udalosti sa znovu nastavi)
+typedef struct
+{
+    int fd;       // Socket
+    int events;   // EVENT_READ / EVENT_WRITE
+    void *ptr;    // Ukazovatel pre udalosti
+    uint32_t gen; // Generacia, udalosti zo starsej generacie sa zahodia
+    int armed;    // Poll je v jadre
+    int used;     // Slot je obsadeny
+} ring_watch;
+#endif
+
+struct event_loop
+{
+    int wake_fd;      // Prebudenie z inych vlakien (eventfd na Linuxe, inde UDP socket spojeny sam so sebou)
+    int wake_pending; // Prebudenie je ohlasene a slucka ho este neprevzala (atomicky)
+#ifdef __linux__
+    int epoll_fd; // Deskriptor epoll instancie (-1 pri io_uring)
+#ifdef USE_IO_URING
+    int ring_fd;                                         // Deskriptor io_uring (-1 pri epoll)
+    void *sq_ring;                                       // Namapovany kruh odoslani
+    void *cq_ring;                                       // Namapovany kruh dokonceni (moze byt ten isty)
+    size_t sq_ring_size, cq_ring_size;                   // Velkosti mapovani
+    struct io_uring_sqe *sqes;                           // Pole poziadaviek
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;    // Ukazovatele do kruhu odoslani
+    unsigned *cq_head, *cq_tail, *cq_mask;               // Ukazovatele do kruhu dokonceni
+    struct io_uring_cqe *cqes;                           // Pole dokonceni
+    unsigned sq_entries;                                 // Velkost kruhu odoslani
+    unsigned sq_local_tail;                              // Pripravene, este neodoslane poziadavky
+    ring_watch watches[EVENT_LOOP_SLOTS];                // Sledovane sockety
+    int rearm[EVENT_LOOP_SLOTS];                         // Sloty na opatovne nastavenie pollu
+    int rearm_count;                                     // Pocet slotov v rearm
+#endif
+#else
+    struct pollfd fds[EVENT_LOOP_SLOTS]; // Sledovane sockety
+    void *ptrs[EVENT_LOOP_SLOTS];        // Ukazovatele pre kazdy socket
+    int count;                                     // Pocet sledovanych socketov
+#endif
+};
+
+#ifdef USE_IO_URING
+// Vytvorenie io_uring bez liburing (priame systemove volania a mmap kruhov)
+// Vyzaduje IORING_FEAT_EXT_ARG (cakanie s casovym limitom) a IORING_FEAT_NODROP,
+// inak sa slucka vrati k epoll
+static int ring_setup(event_loop *loop)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = 4 * IO_RING_ENTRIES;
+
+    loop->ring_fd = (int)syscall(__NR_io_uring_setup, IO_RING_ENTRIES, &params);
+    if (loop->ring_fd < 0)
+    {
+        return -1;
+    }
+    if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP))
+    {
+        close(loop->ring_fd);
+        loop->ring_fd = -1;
+        return -1;
+    }
+
+    loop->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    loop->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (loop->cq_ring_size > loop->sq_ring_size)
+        {
+            loop->sq_ring_size = loop->cq_ring_size;
+        }
+        loop->cq_ring_size = loop->sq_ring_size;
+    }
+    loop->sq_ring = mmap(NULL, loop->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         loop->ring_fd, IORING_OFF_SQ_RING);
+    loop->cq_ring = (params.features & IORING_FEAT_SINGLE_MMAP)
+                        ? loop->sq_ring
+                        : mmap(NULL, loop->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                               loop->ring_fd, IORING_OFF_CQ_RING);
+    loop->sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, loop->ring_fd, IORING_OFF_SQES);
+    if (loop->sq_ring == MAP_FAILED || loop->cq_ring == MAP_FAILED || loop->sqes == MAP_FAILED)
+    {
+        if (loop->sqes != MAP_FAILED)
+        {
+            munmap(loop->sqes, params.sq_entries * sizeof(struct io_uring_sqe));
+        }
+        if (loop->cq_ring != MAP_FAILED && loop->cq_ring != loop->sq_ring)
+        {
+            munmap(loop->cq_ring, loop->cq_ring_size);
+        }
+        if (loop->sq_ring != MAP_FAILED)
+        {
+            munmap(loop->sq_ring, loop->sq_ring_size);
+        }
+        close(loop->ring_fd);
+        loop->ring_fd = -1;
+        return -1;
+    }
+
+    uint8_t *sq = loop->sq_ring;
+    uint8_t *cq = loop->cq_ring;
+    loop->sq_head = (unsigned *)(sq + params.sq_off.head);
+    loop->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    loop->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    loop->sq_array = (unsigned *)(sq + params.sq_off.array);
+    loop->cq_head = (unsigned *)(cq + params.cq_off.head);
+    loop->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    loop->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    loop->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    loop->sq_entries = params.sq_entries;
+    loop->sq_local_tail = *loop->sq_tail;
+    return 0;
+}
+
+// Odoslanie pripravenych poziadaviek, pri min_complete > 0 aj cakanie na dokoncenia
+static int ring_enter(event_loop *loop, unsigned min_complete, int timeout_ms)
+{
+    // Aj poziadavky, ktore jadro minule neprevzalo (plny kruh dokonceni)
+    unsigned to_submit = loop->sq_local_tail - __atomic_load_n(loop->sq_head, __ATOMIC_ACQUIRE);
+    __atomic_store_n(loop->sq_tail, loop->sq_local_tail, __ATOMIC_RELEASE);
+
+    struct __kernel_timespec ts = {.tv_sec = timeout_ms / 1000, .tv_nsec = (timeout_ms % 1000) * 1000000LL};
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.ts = (uint64_t)(uintptr_t)&ts;
+    unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG : 0;
+
+    int result = (int)syscall(__NR_io_uring_enter, loop->ring_fd, to_submit, min_complete, flags,
+                              min_complete > 0 ? &arg : NULL, min_complete > 0 ? sizeof(arg) : 0);
+    if (result < 0 && (errno == ETIME || errno == EINTR || errno == EBUSY))
+    {
+        return 0; // Vyprsanie limitu alebo plny kruh dokonceni (spracuju sa pri dalsom volani)
+    }
+    return result < 0 ? -1 : 0;
+}
+
+// Volna poziadavka v kruhu odoslani, pri plnom kruhu sa pripravene najprv odoslu
+static struct io_uring_sqe *ring_sqe(event_loop *loop, int op, uint64_t user_data)
+{
+    if (loop->sq_local_tail - __atomic_load_n(loop->sq_head, __ATOMIC_ACQUIRE) >= loop->sq_entries)
+    {
+        ring_enter(loop, 0, 0);
+        if (loop->sq_local_tail - __atomic_load_n(loop->sq_head, __ATOMIC_ACQUIRE) >= loop->sq_entries)
+        {
+            return NULL;
+        }
+    }
+    unsigned index = loop->sq_local_tail & *loop->sq_mask;
+    struct io_uring_sqe *sqe = &loop->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (uint8_t)op;
+    sqe->user_data = user_data;
+    loop->sq_array[index] = index;
+    loop->sq_local_tail++;
+    return sqe;
+}
+
+static uint64_t watch_user_data(event_loop *loop, int slot)
+{
+    return RING_OP_POLL | ((uint64_t)slot << 4) | ((uint64_t)loop->watches[slot].gen << 32);
+}
+
+// Jednorazovy poll na sledovane udalosti socketu
+static int watch_arm(event_loop *loop, int slot)
+{
+    ring_watch *watch = &loop->watches[slot];
+    if (watch->events == 0)
+    {
+        return 0;
+    }
+    struct io_uring_sqe *sqe = ring_sqe(loop, IORING_OP_POLL_ADD, watch_user_data(loop, slot));
+    if (sqe == NULL)
+    {
+        return -1;
+    }
+    sqe->fd = watch->fd;
+    sqe->poll32_events = ((watch->events & EVENT_READ) ? POLLIN : 0) | ((watch->events & EVENT_WRITE) ? POLLOUT : 0);
+    watch->armed = 1;
+    return 0;
+}
+
+// Zrusenie nastaveneho pollu, jeho pripadna udalost sa zahodi (nova generacia)
+static void watch_disarm(event_loop *loop, int slot)
+{
+    ring_watch *watch = &loop->watches[slot];
+    if (watch->armed)
+    {
+        struct io_uring_sqe *sqe = ring_sqe(loop, IORING_OP_POLL_REMOVE, RING_OP_IGNORE);
+        if (sqe != NULL)
+        {
+            sqe->addr = watch_user_data(loop, slot);
+        }
+        watch->armed = 0;
+    }
+    watch->gen++;
+}
+
+static int watch_find(event_loop *loop, int sock)
+{
+    for (int i = 0; i < EVENT_LOOP_SLOTS; i++)
+    {
+        if (loop->watches[i].used && loop->watches[i].fd == sock)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+#endif
+
+// Deskriptor prebudenia slucky
+static int wake_open(event_loop *loop)
+{
+#ifdef __linux__
+    loop->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    return loop->wake_fd < 0 ? -1 : 0;
+#else
+    // Bez eventfd: datagram na vlastnu adresu spravi socket citatelnym (funguje aj s WSAPoll)
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    loop->wake_fd = (int)socket(AF_INET, SOCK_DGRAM, 0);
+    if (loop->wake_fd < 0)
     {
         return -1;
     }
+    if (bind(loop->wake_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        getsockname(loop->wake_fd, (struct sockaddr *)&addr, &addr_len) < 0 ||
+        connect(loop->wake_fd, (struct sockaddr *)&addr, addr_len) < 0)
+    {
+        SOCKET_CLOSE(loop->wake_fd);
+        loop->wake_fd = -1;
+        return -1;
+    }
+    SET_NONBLOCKING(loop->wake_fd);
     return 0;
+#endif
+}
+
+// Prevzatie prebudenia v event_loop_wait
+// Priznak sa zrusi az po vyprazdneni deskriptora, inak by sa dalsie prebudenie mohlo stratit
+static void wake_drain(event_loop *loop)
+{
+#ifdef __linux__
+    uint64_t value;
+    while (read(loop->wake_fd, &value, sizeof(value)) > 0)
+    {
+    }
+#else
+    char value;
+    while (recv(loop->wake_fd, &value, 1, 0) > 0)
+    {
+    }
+#endif
+    __atomic_exchange_n(&loop->wake_pending, 0, __ATOMIC_SEQ_CST);
+}
+
+event_loop *event_loop_create(void)
+{
+    event_loop *loop = calloc(1, sizeof(event_loop));
+    if (loop == NULL)
+    {
+        return NULL;
+    }
+    loop->wake_fd = -1;
+#ifdef __linux__
+    loop->epoll_fd = -1;
+    int ring = 0;
+#ifdef USE_IO_URING
+    ring = ring_setup(loop) == 0;
+#endif
+    if (!ring && (loop->epoll_fd = epoll_create1(0)) < 0)
+    {
+        free(loop);
+        return NULL;
+    }
+#endif
+    // Deskriptor prebudenia sa sleduje ako dalsi socket, jeho ukazovatel je sama slucka
+    if (wake_open(loop) < 0 || event_loop_add(loop, loop->wake_fd, EVENT_READ, loop) < 0)
+    {
+        event_loop_destroy(loop);
+        return NULL;
+    }
+    return loop;
+}
+
+void event_loop_destroy(event_loop *loop)
+{
+    if (loop->wake_fd >= 0)
+    {
+#ifdef __linux__
+        close(loop->wake_fd);
+#else
+        SOCKET_CLOSE(loop->wake_fd);
+#endif
+    }
+#ifdef __linux__
+    if (loop->epoll_fd >= 0)
+    {
+        close(loop->epoll_fd);
+    }
+#ifdef USE_IO_URING
+    if (loop->ring_fd >= 0)
+    {
+        munmap(loop->sqes, loop->sq_entries * sizeof(struct io_uring_sqe));
+        if (loop->cq_ring != loop->sq_ring)
+        {
+            munmap(loop->cq_ring, loop->cq_ring_size);
+        }
+        munmap(loop->sq_ring, loop->sq_ring_size);
+        close(loop->ring_fd);
+    }
+#endif
+#endif
+    free(loop);
+}
+
+// Nazov mechanizmu, ktory slucka pouziva
+const char *event_loop_backend(event_loop *loop)
+{
+#ifdef __linux__
+    return loop->epoll_fd >= 0 ? "epoll" : "io_uring";
+#else
+    (void)loop;
+    return "poll";
+#endif
+}
+
+// Prebudenie slucky z ineho vlakna, event_loop_wait sa vrati aj bez udalosti na socketoch
+// Kym slucka prebudenie neprevezme, dalsie volania nic nezapisuju
+void event_loop_wake(event_loop *loop)
+{
+    if (__atomic_exchange_n(&loop->wake_pending, 1, __ATOMIC_SEQ_CST))
+    {
+        return;
+    }
+#ifdef __linux__
+    uint64_t value = 1;
+    ssize_t written = write(loop->wake_fd, &value, sizeof(value));
+    (void)written; // Plny citac eventfd aj tak slucku prebudi
+#else
+    send(loop->wake_fd, "", 1, 0);
+#endif
+}
+
+// Slucka prijima a odosiela data asynchronne (io_uring)
+// Spojenia potom necakaju na EVENT_READ/EVENT_WRITE, ale na EVENT_RECV_DONE a EVENT_SEND_DONE
+int event_loop_async(event_loop *loop)
+{
+#ifdef USE_IO_URING
+    return loop->ring_fd >= 0;
+#else
+    (void)loop;
+    return 0;
+#endif
+}
+
+#ifdef __linux__
+// Prevod EVENT_* na priznaky epoll
+static uint32_t epoll_flags(int events)
+{
+    return ((events & EVENT_READ) ? EPOLLIN : 0) | ((events & EVENT_WRITE) ? EPOLLOUT : 0);
+}
+#endif
+
+int event_loop_add(event_loop *loop, int sock, int events, void *ptr)
+{
+#ifdef __linux__
+#ifdef USE_IO_URING
+    if (loop->ring_fd >= 0)
+    {
+        for (int i = 0; i < EVENT_LOOP_SLOTS; i++)
+        {
+            if (!loop->watches[i].used)
+            {
+                ring_watch *watch = &loop->watches[i];
+                watch->fd = sock;
+                watch->events = events;
+                watch->ptr = ptr;
+                watch->armed = 0;
+                watch->used = 1;
+                return watch_arm(loop, i);
+            }
+        }
+        return -1;
+    }
+#endif
+    struct epoll_event ev;
+    ev.events = epoll_flags(events);
+    ev.data.ptr = ptr;
+    return epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, sock, &ev);
+#else
+    if (loop->count >= EVENT_LOOP_SLOTS)
+    {
+        return -1;
+    }
+    loop->fds[loop->count].fd = sock;
+    loop->fds[loop->count].events = ((events & EVENT_READ) ? POLLIN : 0) | ((events & EVENT_WRITE) ? POLLOUT : 0);
+    loop->fds[loop->count].revents = 0;
+    loop->ptrs[loop->count] = ptr;
+    loop->count++;
+    return 0;
+#endif
+}
+
+int event_loop_modify(event_loop *loop, int sock, int events, void *ptr)
+{
+#ifdef __linux__
+#ifdef USE_IO_URING
+    if (loop->ring_fd >= 0)
+    {
+        int slot = watch_find(loop, sock);
+        if (slot < 0)
+        {
+            return -1;
+        }
+        watch_disarm(loop, slot);
+        loop->watches[slot].events = events;
+        loop->watches[slot].ptr = ptr;
+        return watch_arm(loop, slot);
+    }
+#endif
+    struct epoll_event ev;
+    ev.events = epoll_flags(events);
+    ev.data.ptr = ptr;
+    return epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, sock, &ev);
+#else
+    for (int i = 0; i < loop->count; i++)
+    {
+        if ((int)loop->fds[i].fd == sock)
+        {
+            loop->fds[i].events = ((events & EVENT_READ) ? POLLIN : 0) | ((events & EVENT_WRITE) ? POLLOUT : 0);
+            loop->ptrs[i] = ptr;
+            return 0;
+        }
+    }
+    return -1;
+#endif
+}
+
+void event_loop_remove(event_loop *loop, int sock)
+{
+#ifdef __linux__
+#ifdef USE_IO_URING
+    if (loop->ring_fd >= 0)
+    {
+        int slot = watch_find(loop, sock);
+        if (slot >= 0)
+        {
+            watch_disarm(loop, slot);
+            loop->watches[slot].used = 0;
+        }
+        return;
+    }
+#endif
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, sock, NULL);
+#else
+    for (int i = 0; i < loop->count; i++)
+    {
+        if ((int)loop->fds[i].fd == sock)
+        {
+            loop->count--;
+            loop->fds[i] = loop->fds[loop->count];
+            loop->ptrs[i] = loop->ptrs[loop->count];
+            return;
+        }
+    }
+#endif
+}
+
+// Asynchronne prijatie najviac size bajtov do buffera (len io_uring)
+// Vysledok pride ako EVENT_RECV_DONE s poctom bajtov (0 = koniec spojenia, < 0 = chyba)
+int event_loop_recv(event_loop *loop, int sock, void *buffer, size_t size, void *ptr)
+{
+#ifdef USE_IO_URING
+    struct io_uring_sqe *sqe = loop->ring_fd >= 0 ? ring_sqe(loop, IORING_OP_RECV, (uintptr_t)ptr | RING_OP_RECV) : NULL;
+    if (sqe == NULL)
+    {
+        return -1;
+    }
+    sqe->fd = sock;
+    sqe->addr = (uintptr_t)buffer;
+    sqe->len = (uint32_t)size;
+    return 0;
+#else
+    (void)loop, (void)sock, (void)buffer, (void)size, (void)ptr;
+    return -1;
+#endif
+}
+
+// Asynchronne odoslanie najviac size bajtov z buffera (len io_uring)
+// Vysledok pride ako EVENT_SEND_DONE s poctom odoslanych bajtov (< 0 = chyba)
+int event_loop_send(event_loop *loop, int sock, const void *buffer, size_t size, void *ptr)
+{
+#ifdef USE_IO_URING
+    struct io_uring_sqe *sqe = loop->ring_fd >= 0 ? ring_sqe(loop, IORING_OP_SEND, (uintptr_t)ptr | RING_OP_SEND) : NULL;
+    if (sqe == NULL)
+    {
+        return -1;
+    }
+    sqe->fd = sock;
+    sqe->addr = (uintptr_t)buffer;
+    sqe->len = (uint32_t)size;
+    sqe->msg_flags = SEND_FLAGS;
+    return 0;
+#else
+    (void)loop, (void)sock, (void)buffer, (void)size, (void)ptr;
+    return -1;
+#endif
+}
+
+// Zrusenie prebiehajuceho prijatia aj odoslania, ich udalosti este pridu (s chybou)
+void event_loop_cancel(event_loop *loop, void *ptr)
+{
+#ifdef USE_IO_URING
+    static const uint64_t ops[] = {RING_OP_RECV, RING_OP_SEND};
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]) && loop->ring_fd >= 0; i++)
+    {
+        struct io_uring_sqe *sqe = ring_sqe(loop, IORING_OP_ASYNC_CANCEL, RING_OP_IGNORE);
+        if (sqe != NULL)
+        {
+            sqe->addr = (uintptr_t)ptr | ops[i];
+        }
+    }
+#else
+    (void)loop, (void)ptr;
+#endif
+}
+
+#ifdef USE_IO_URING
+// Jedno volanie io_uring_enter odosle vsetky pripravene poziadavky (prijatia, odoslania,
+// polly) a pocka na dokoncenia
+static int ring_wait(event_loop *loop, net_event *events, int max_events, int timeout_ms)
+{
+    // Polly, ktore v minulom kole vratili udalost, sa nastavia znova (ako level-triggered epoll)
+    for (int i = 0; i < loop->rearm_count; i++)
+    {
+        int slot = loop->rearm[i];
+        if (loop->watches[slot].used && !loop->watches[slot].armed)
+        {
+            watch_arm(loop, slot);
+        }
+    }
+    loop->rearm_count = 0;
+
+    unsigned head = *loop->cq_head;
+    int ready = head != __atomic_load_n(loop->cq_tail, __ATOMIC_ACQUIRE);
+    if (ring_enter(loop, ready ? 0 : 1, timeout_ms) < 0)
+    {
+        return -1;
+    }
+
+    int count = 0;
+    unsigned tail = __atomic_load_n(loop->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail && count < max_events)
+    {
+        struct io_uring_cqe *cqe = &loop->cqes[head & *loop->cq_mask];
+        uint64_t user_data = cqe->user_data;
+        int result = cqe->res;
+        head++;
+
+        switch (user_data & RING_OP_MASK)
+        {
+        case RING_OP_POLL:
+        {
+            int slot = (int)((user_data >> 4) & 0x0FFFFFFF);
+            ring_watch *watch = &loop->watches[slot];
+            if (!watch->used || watch->gen != (uint32_t)(user_data >> 32))
+            {
+                break; // Udalost pre zruseny alebo zmeneny poll
+            }
+            watch->armed = 0;
+            loop->rearm[loop->rearm_count++] = slot;
+            if (watch->ptr == loop)
+            {
+                wake_drain(loop);
+                break;
+            }
+            events[count].ptr = watch->ptr;
+            events[count].result = 0;
+            events[count].events = result < 0 ? EVENT_ERROR
+                                              : ((result & POLLIN) ? EVENT_READ : 0) |
+                                                    ((result & POLLOUT) ? EVENT_WRITE : 0) |
+                                                    ((result & (POLLERR | POLLHUP)) ? EVENT_ERROR : 0);
+            count++;
+            break;
+        }
+        case RING_OP_RECV:
+        case RING_OP_SEND:
+            events[count].ptr = (void *)(uintptr_t)(user_data & ~(uint64_t)RING_OP_MASK);
+            events[count].events = (user_data & RING_OP_MASK) == RING_OP_RECV ? EVENT_RECV_DONE : EVENT_SEND_DONE;
+            events[count].result = result;
+            count++;
+            break;
+        default:
+            break;
+        }
+    }
+    __atomic_store_n(loop->cq_head, head, __ATOMIC_RELEASE);
+    return count;
+}
+#endif
+
+// Pocka najviac timeout_ms na udalosti, vrati ich pocet (0 pri vyprsani, -1 pri chybe)
+int event_loop_wait(event_loop *loop, net_event *events, int max_events, int timeout_ms)
+{
+#ifdef __linux__
+#ifdef USE_IO_URING
+    if (loop->ring_fd >= 0)
+    {
+        return ring_wait(loop, events, max_events, timeout_ms);
+    }
+#endif
+    struct epoll_event ready[EVENT_BATCH_SIZE];
+    if (max_events > EVENT_BATCH_SIZE)
+    {
+        max_events = EVENT_BATCH_SIZE;
+    }
+    int count = epoll_wait(loop->epoll_fd, ready, max_events, timeout_ms);
+    if (count < 0)
+    {
+        return (errno == EINTR) ? 0 : -1;
+    }
+    int filled = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (ready[i].data.ptr == loop)
+        {
+            wake_drain(loop);
+            continue;
+        }
+        events[filled].ptr = ready[i].data.ptr;
+        events[filled].result = 0;
+        events[filled].events = ((ready[i].events & EPOLLIN) ? EVENT_READ : 0) |
+                                ((ready[i].events & EPOLLOUT) ? EVENT_WRITE : 0) |
+                                ((ready[i].events & (EPOLLERR | EPOLLHUP)) ? EVENT_ERROR : 0);
+        filled++;
+    }
+    return filled;
+#else
+#ifdef _WIN32
+    int result = WSAPoll(loop->fds, (ULONG)loop->count, timeout_ms);
+#else
+    int result = poll(loop->fds, (nfds_t)loop->count, timeout_ms);
+#endif
+    if (result < 0)
+    {
+        return (errno == EINTR) ? 0 : -1;
+    }
+    int count = 0;
+    for (int i = 0; i < loop->count && count < max_events; i++)
+    {
+        short revents = loop->fds[i].revents;
+        if (revents == 0)
+        {
+            continue;
+        }
+        if (loop->ptrs[i] == loop)
+        {
+            wake_drain(loop);
+            continue;
+        }
+        events[count].ptr = loop->ptrs[i];
+        events[count].result = 0;
+        events[count].events = ((revents & POLLIN) ? EVENT_READ : 0) |
+                               ((revents & POLLOUT) ? EVENT_WRITE : 0) |
+                               ((revents & (POLLERR | POLLHUP)) ? EVENT_ERROR : 0);
+        count++;
+    }
+    return count;
+#endif
+}
+
+// Server prijme navrh rezimu z buffera (neznamy navrh = rezim s nonce)
+// Navrhnuta velkost bloku sa oreze na <TRANSFER_BUFFER_SIZE, MAX_TRANSFER_CHUNK_SIZE>
+// Odpoved (rezim a velkost bloku, 2x uint32) odosiela volajuci
+// Vracia 1 ak je navrh prijaty, 0 ak treba pockat, -1 pri neplatnom navrhu
+int recv_buffer_transfer_mode(recv_buffer *rb, uint32_t *mode, uint32_t *chunk_size, uint8_t *stream_nonce)
+{
+    uint32_t proposed = 0;
+    uint32_t proposed_size = 0;
+    if (rb->end - rb->start < 2 * sizeof(uint32_t) + NONCE_SIZE)
+    {
+        return 0;
+    }
+    if (recv_buffer_chunk_size(rb, &proposed, 0) < 0)
+    {
+        return -1; // Namiesto rezimu prisla velkost bloku
+    }
+    if (recv_buffer_chunk_size(rb, &proposed_size, CONTROL_MESSAGE_MIN - 1) != 1 ||
+        proposed_size == 0 || proposed_size >= CONTROL_MESSAGE_MIN)
+    {
+        return -1; // Namiesto velkosti bloku prisla riadiaca sprava alebo EOF
+    }
+    recv_buffer_read(rb, stream_nonce, NONCE_SIZE);
+
+    *mode = (proposed == TRANSFER_MODE_STREAM) ? TRANSFER_MODE_STREAM : TRANSFER_MODE_NONCE;
+    *chunk_size = proposed_size;
+    if (*chunk_size > MAX_TRANSFER_CHUNK_SIZE)
+    {
+        *chunk_size = MAX_TRANSFER_CHUNK_SIZE;
+    }
+    if (*chunk_size < TRANSFER_BUFFER_SIZE)
+    {
+        *chunk_size = TRANSFER_BUFFER_SIZE;
+    }
+    return 1;
 }
 
 // Posle potvrdenie uspesneho prenosu s opakovaniami
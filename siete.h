@@ -80,6 +80,21 @@
 // Prenos dat - Windows
 #define SEND_FLAGS 0                                                        // Ziadne specialne flagy pre Windows
 #define RECV_DATA(sock, data, size) recv((sock), (char *)(data), (size), 0) // Prijatie dat na Windows
+
+// Neblokujuce sockety - Windows
+#define SOCKET_WOULD_BLOCK() (WSAGetLastError() == WSAEWOULDBLOCK) // Operacia by blokovala, treba pockat na udalost
+#define SET_NONBLOCKING(sock)                       \
+    do                                              \
+    {                                               \
+        u_long nonblocking = 1;                     \
+        ioctlsocket((sock), FIONBIO, &nonblocking); \
+    } while (0) // Prepne socket do neblokujuceho rezimu
+
+// Vektorove odosielanie (viac usekov pamate jednym volanim) - Windows
+typedef WSABUF net_iovec;                                                              // Usek dat pre WSASend
+#define NET_IOVEC_SET(v, ptr, size) ((v).buf = (char *)(ptr), (v).len = (ULONG)(size)) // Nastavi usek
+#define NET_IOVEC_LEN(v) ((size_t)(v).len)                                             // Dlzka useku
+#define NET_IOVEC_ADVANCE(v, n) ((v).buf += (n), (v).len -= (ULONG)(n))                // Posun za odoslane bajty
 #else
 // Funkcie pre uvolnenie socketov - UNIX/Linux verzie
 #define SOCKET_CLOSE(sock) close(sock) // Uzatvori socket na UNIX systemoch
@@ -125,6 +140,20 @@
 // Prenos dat - UNIX/Linux
 #define SEND_FLAGS MSG_NOSIGNAL                                  // Zabrani vzniku SIGPIPE signalu pri zavreti spojenia
 #define RECV_DATA(sock, data, size) read((sock), (data), (size)) // Prijatie dat na UNIX systemoch
+
+// Neblokujuce sockety - UNIX/Linux
+#define SOCKET_WOULD_BLOCK() (errno == EAGAIN || errno == EWOULDBLOCK) // Operacia by blokovala, treba pockat na udalost
+#define SET_NONBLOCKING(sock)                                           \
+    do                                                                  \
+    {                                                                   \
+        fcntl((sock), F_SETFL, fcntl((sock), F_GETFL, 0) | O_NONBLOCK); \
+    } while (0) // Prepne socket do neblokujuceho rezimu
+
+// Vektorove odosielanie (viac usekov pamate jednym volanim) - UNIX/Linux
+typedef struct iovec net_iovec;                                                                 // Usek dat pre sendmsg
+#define NET_IOVEC_SET(v, ptr, size) ((v).iov_base = (void *)(ptr), (v).iov_len = (size))        // Nastavi usek
+#define NET_IOVEC_LEN(v) ((v).iov_len)                                                          // Dlzka useku
+#define NET_IOVEC_ADVANCE(v, n) ((v).iov_base = (char *)(v).iov_base + (n), (v).iov_len -= (n)) // Posun za odoslane bajty
 #endif
 
 // Zakladne sietove funkcie
@@ -141,14 +170,15 @@ void set_socket_timeout(int sock, int timeout_ms);   // Nastavenie timeoutu pre
 // Pomocne funkcie pre prenos dat
 ssize_t send_all(int sock, const void *buf, size_t size);
 ssize_t recv_all(int sock, void *buf, size_t size);
+int send_all_vec(int sock, net_iovec *iov, int iov_count); // Posle vsetky useky, iov sa pritom meni
 
 // Pomocne funkcie pre spravu chunkov
 int send_chunk_size_reliable(int socket, uint32_t size);
-int receive_chunk_size_reliable(int socket, uint32_t *size);
+int receive_chunk_size_reliable(int socket, uint32_t *size, uint32_t max_size); // Odmietne blok nad max_size
 
 // Serverove funkcie
 // Funkcie potrebne pre vytvorenie a spravu serverovej casti
-int setup_server(int port);                                                   // Vytvori a nakonfiguruje server socket
+int setup_server(int port, int reuse_port);                                   // Vytvori a nakonfiguruje server socket (reuse_port: SO_REUSEPORT)
 int accept_client_connection(int server_fd, struct sockaddr_in *client_addr); // Prijme spojenie od klienta
 int send_ready_signal(int socket);                                            // Posle signal pripravenosti klientovi
 int receive_salt(int socket, uint8_t *salt);                                  // Prijme kryptograficku sol
@@ -165,13 +195,84 @@ int wait_for_key_acknowledgment(int socket);              // Caka na potvrdenie
 // Zdielane funkcie pre prenos zasifrovanych dat
 int send_file_name(int socket, const char *file_name);                         // Posle nazov suboru
 int receive_file_name(int socket, char *file_name, size_t max_len);            // Prijme nazov suboru
-int send_encrypted_chunk(int socket, const uint8_t *nonce, const uint8_t *tag, // Posle zasifrovany blok
+int send_encrypted_chunk(int socket, const uint8_t *nonce, const uint8_t *tag, // Posle zasifrovany blok (nonce moze byt NULL)
                          const uint8_t *data, size_t data_len);
-int receive_encrypted_chunk(int socket, uint8_t *nonce, uint8_t *tag, // Prijme zasifrovany blok
+int receive_encrypted_chunk(int socket, uint8_t *nonce, uint8_t *tag, // Prijme zasifrovany blok (nonce moze byt NULL)
                             uint8_t *data, uint32_t data_len);
+int send_encrypted_frames(int socket, const uint8_t *nonces, const uint8_t *tags, // Posle ramce (velkost+nonce+tag+data)
+                          uint8_t *const *data, const size_t *sizes, size_t count);
 int send_transfer_ack(int socket);     // Posle potvrdenie o prenose
 int wait_for_transfer_ack(int socket); // Caka na potvrdenie o prenose
 
+// Prijimaci buffer spojenia
+// Cita velke useky (RECV_SLAB_SIZE) jednym volanim recv a ramce rozdeli priamo v nom,
+// data blokov sa desifruju na mieste bez kopirovania
+// Bajty pred start patria drzanym ramcom, ukazovatele na ne plati do recv_buffer_release
+typedef struct
+{
+    int socket;      // Socket spojenia
+    uint8_t *data;   // Pamat buffera
+    size_t capacity; // Velkost buffera
+    size_t start;    // Zaciatok nespracovanych dat
+    size_t end;      // Koniec prijatych dat
+} recv_buffer;
+
+int recv_buffer_init(recv_buffer *rb, int socket, size_t capacity); // Alokuje buffer pre socket
+int recv_buffer_resize(recv_buffer *rb, size_t capacity);           // Zmeni velkost (bez drzanych ramcov)
+void recv_buffer_free(recv_buffer *rb);                             // Vymaze a uvolni buffer
+void recv_buffer_release(recv_buffer *rb);                          // Uvolni drzane ramce (zneplatni ukazovatele)
+int recv_buffer_fill(recv_buffer *rb);                              // Precita dostupne data zo socketu
+
+// Spracovanie prijatych dat: spotrebuju sa len ak je cela sprava v bufferi
+// Vracaju 1 = prijate, 0 = treba pockat na dalsie data, -1 = chyba protokolu
+uint8_t *recv_buffer_take(recv_buffer *rb, size_t size);                        // Ukazovatel na dalsich size bajtov alebo NULL
+int recv_buffer_read(recv_buffer *rb, void *out, size_t size);                  // Skopiruje dalsich size bajtov
+int recv_buffer_chunk_size(recv_buffer *rb, uint32_t *size, uint32_t max_size); // Ako receive_chunk_size_reliable
+int recv_buffer_encrypted_chunk(recv_buffer *rb, uint8_t *nonce, uint8_t *tag,  // Ako receive_encrypted_chunk, data ostanu v bufferi
+                                uint8_t **data, uint32_t data_len);
+int recv_buffer_file_name(recv_buffer *rb, char *file_name, size_t max_len);    // Nazov suboru ukonceny nulou
+int recv_buffer_transfer_mode(recv_buffer *rb, uint32_t *mode, uint32_t *chunk_size, // Server: navrh rezimu a bloku
+                              uint8_t *stream_nonce);
+
+// Slucka udalosti nad neblokujucimi socketmi (io_uring alebo epoll na Linuxe, poll/WSAPoll inde)
+#define EVENT_READ 1  // Socket ma data na citanie (alebo nove spojenie)
+#define EVENT_WRITE 2 // Do socketu sa da znovu zapisovat
+#define EVENT_ERROR 4      // Chyba alebo ukoncenie spojenia
+#define EVENT_RECV_DONE 8  // Dokoncene asynchronne prijatie (io_uring), pocet bajtov v result
+#define EVENT_SEND_DONE 16 // Dokoncene asynchronne odoslanie (io_uring), pocet bajtov v result
+
+typedef struct
+{
+    void *ptr;  // Ukazovatel zadany pri registracii socketu alebo operacie
+    int events; // Kombinacia EVENT_*
+    int result; // Vysledok asynchronnej operacie (< 0 = chyba)
+} net_event;
+
+typedef struct event_loop event_loop;
+
+event_loop *event_loop_create(void);                                                      // Vytvori slucku udalosti
+void event_loop_destroy(event_loop *loop);                                                // Uvolni slucku udalosti
+const char *event_loop_backend(event_loop *loop);                                         // io_uring, epoll alebo poll
+int event_loop_add(event_loop *loop, int sock, int events, void *ptr);                    // Zacne sledovat socket
+int event_loop_modify(event_loop *loop, int sock, int events, void *ptr);                 // Zmeni sledovane udalosti
+void event_loop_remove(event_loop *loop, int sock);                                       // Prestane sledovat socket
+int event_loop_wait(event_loop *loop, net_event *events, int max_events, int timeout_ms); // Pocka na udalosti
+void event_loop_wake(event_loop *loop);                                                   // Prebudi slucku (z ineho vlakna)
+
+// Asynchronne operacie (len io_uring, inak vracaju -1)
+// Poziadavky sa odoslu jadru naraz pri dalsom event_loop_wait, ptr musi byt zarovnany na 16 bajtov
+// a platny az do prislusnej udalosti EVENT_RECV_DONE / EVENT_SEND_DONE
+int event_loop_async(event_loop *loop);                                               // 1 ak su asynchronne operacie dostupne
+int event_loop_recv(event_loop *loop, int sock, void *buffer, size_t size, void *ptr); // Prijatie do buffera
+int event_loop_send(event_loop *loop, int sock, const void *buffer, size_t size,      // Odoslanie z buffera
+                    void *ptr);
+void event_loop_cancel(event_loop *loop, void *ptr);                                  // Zrusi prebiehajuce prijatie a odoslanie
+
+// Dohoda rezimu sifrovania prenosu (TRANSFER_MODE_*)
+// V prudovom rezime sa nonce neposiela s kazdym blokom (nonce = NULL)
+int propose_transfer_mode(int socket, uint32_t *mode, uint32_t *chunk_size, // Klient: navrhne rezim a blok, vrati zvolene
+                          const uint8_t *stream_nonce);
+
 // Funkcie pre synchronizaciu
 int send_session_sync(int socket);     // Posle synchronizacnu spravu
 int wait_for_session_sync(int socket); // Caka na synchronizacnu spravu